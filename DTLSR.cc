@@ -56,12 +56,49 @@ DTLSR::LSA::serialize(oasys::SerializeAction* a)
     a->process("links",   &links_);
 }
 
+//----------------------------------------------------------------------
+void
+DTLSR::LSADelta::serialize(oasys::SerializeAction* a)
+{
+    LSA::serialize(a);
+    a->process("base_seqno", &base_seqno_);
+}
+
 //----------------------------------------------------------------------
 void
 DTLSR::format_lsa_bundle(Bundle* bundle, const LSA* lsa)
+{
+    format_bundle(bundle, MSG_LSA, lsa);
+}
+
+//----------------------------------------------------------------------
+void
+DTLSR::format_lsa_delta_bundle(Bundle* bundle, const LSADelta* lsa)
+{
+    format_bundle(bundle, MSG_LSA_DELTA, lsa);
+}
+
+//----------------------------------------------------------------------
+bool
+DTLSR::parse_lsa_bundle(const Bundle* bundle, LSA* lsa)
+{
+    return parse_bundle(bundle, MSG_LSA, lsa);
+}
+
+//----------------------------------------------------------------------
+bool
+DTLSR::parse_lsa_delta_bundle(const Bundle* bundle, LSADelta* lsa)
+{
+    return parse_bundle(bundle, MSG_LSA_DELTA, lsa);
+}
+
+//----------------------------------------------------------------------
+void
+DTLSR::format_bundle(Bundle* bundle, msg_type_t type,
+                     const oasys::SerializableObject* msg)
 {
     oasys::MarshalSize ms(oasys::Serialize::CONTEXT_NETWORK);
-    if (ms.action(lsa) != 0) {
+    if (ms.action(msg) != 0) {
         log_crit_p("/dtn/route/dtlsr", "error sizing lsa");
         return;
     }
@@ -75,36 +112,37 @@ DTLSR::format_lsa_bundle(Bundle* bundle, const LSA* lsa)
     oasys::ScratchBuffer<u_char*, 256> buf;
     
     oasys::Marshal m(oasys::Serialize::CONTEXT_NETWORK, &buf);
-    if (m.action(lsa) != 0) {
+    if (m.action(msg) != 0) {
         log_crit_p("/dtn/route/dtlsr", "error marshalling lsa");
         return;
     }
 
     bundle->mutable_payload()->set_length(1 + len);
 
-    u_char type = MSG_LSA;
-    bundle->mutable_payload()->write_data(&type,     0, 1);
+    u_char typecode = type;
+    bundle->mutable_payload()->write_data(&typecode, 0, 1);
     bundle->mutable_payload()->write_data(buf.buf(), 1, len);
 }
 
 //----------------------------------------------------------------------
 bool
-DTLSR::parse_lsa_bundle(const Bundle* bundle, LSA* lsa)
+DTLSR::parse_bundle(const Bundle* bundle, msg_type_t type,
+                    oasys::SerializableObject* msg)
 {
     oasys::ScratchBuffer<u_char*, 256> buf;
     size_t len = bundle->payload().length();
     bundle->payload().read_data(0, len, buf.buf(len));
 
-    if (buf.buf()[0] != MSG_LSA) {
+    if (buf.buf()[0] != type) {
         log_warn_p("/dtn/route/dtlsr",
-                   "parse_lsa_bundle: typecode byte %u != MSG_LSA",
-                   buf.buf()[0]);
+                   "parse_bundle: typecode byte %u != %u",
+                   buf.buf()[0], type);
         return false;
     }
     
     oasys::Unmarshal um(oasys::Serialize::CONTEXT_NETWORK,
                         buf.buf() + 1, len - 1);
-    if (um.action(lsa) != 0) {
+    if (um.action(msg) != 0) {
         log_warn_p("/dtn/route/dtlsr",
                    "error unmarshalling lsa vector");
         return false;
@@ -36,6 +36,7 @@ public:
     typedef enum {
         MSG_LSA = 1,
         MSG_EIDA = 2,
+        MSG_LSA_DELTA = 3,
     } msg_type_t;
 
     //----------------------------------------------------------------------
@@ -98,15 +99,53 @@ public:
         LinkStateVec     links_; ///< Vector of link states
     };
 
+    //----------------------------------------------------------------------
+    /// An LSA with only the links that changed since the full LSA
+    /// numbered base_seqno_. Links dropped since then are sent down.
+    class LSADelta : public LSA {
+    public:
+        LSADelta() : base_seqno_(0) {}
+        LSADelta(const oasys::Builder& b) : LSA(b), base_seqno_(0) {}
+        virtual ~LSADelta() {}
+
+        virtual void serialize(oasys::SerializeAction* a);
+
+        u_int64_t        base_seqno_; ///< Seqno of the full LSA the
+                                      ///  changes are relative to
+    };
+
     /**
      * Format the LSA into the given bundle's payload.
      */
     static void format_lsa_bundle(Bundle* bundle, const LSA* lsa);
 
+    /**
+     * Format the delta LSA into the given bundle's payload.
+     */
+    static void format_lsa_delta_bundle(Bundle* bundle, const LSADelta* lsa);
+
     /**
      * Parse an LSA bundle.
      */
     static bool parse_lsa_bundle(const Bundle* bundle, LSA* lsa);
+
+    /**
+     * Parse a delta LSA bundle.
+     */
+    static bool parse_lsa_delta_bundle(const Bundle* bundle, LSADelta* lsa);
+
+protected:
+    /**
+     * Format the typecode byte and the message into the payload.
+     */
+    static void format_bundle(Bundle* bundle, msg_type_t type,
+                              const oasys::SerializableObject* msg);
+
+    /**
+     * Check the typecode byte and parse the message from the payload.
+     */
+    static bool parse_bundle(const Bundle* bundle, msg_type_t type,
+                             oasys::SerializableObject* msg);
 };
 
 } // namespace dtn
@@ -33,8 +33,10 @@ DTLSRConfig::DTLSRConfig()
       uptime_factor_(10.0),
       keep_down_links_(true),
       recompute_delay_(1),
+      max_recompute_delay_(5),
       aging_interval_(5),
       lsa_interval_(3600),
+      delta_lsas_(true),
       min_lsa_interval_(5),
       lsa_lifetime_(24 * 3600)
 {
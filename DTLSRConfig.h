@@ -83,12 +83,19 @@ public:
 
     /**
      * Delay (in seconds) after receiving an LSA when we recompute
-     * the routes. Needed to prevent some flapping.
-     *
-     * XXX/demmer not used
+     * the routes. Needed to prevent some flapping. Each change to
+     * the graph restarts it, so a burst of LSAs costs one
+     * recomputation. Zero recomputes right away.
      */
     u_int recompute_delay_;
 
+    /**
+     * Maximum delay (in seconds) from the first change to the graph
+     * until the routes are recomputed, however often it keeps
+     * changing.
+     */
+    u_int max_recompute_delay_;
+
     /**
      * Interval (in seconds) after which we locally recompute the
      * routes to properly age links that we believe to be down.
@@ -97,10 +104,17 @@ public:
         
     /**
      * Interval (in seconds) at which we proactively send new LSAa.
-     * Default is once per hour.
+     * Default is once per hour. These are always full LSAs.
      */
     u_int lsa_interval_;
 
+    /**
+     * Whether the LSAs sent between the periodic ones only carry the
+     * links changed since the last full LSA. All nodes of the area
+     * must understand them.
+     */
+    bool delta_lsas_;
+
     /**
      * Minimum interval (in seconds) between LSA transmission. Default
      * is once per five seconds.
@@ -189,8 +189,11 @@ DTLSRRouter::DTLSRRouter()
       announce_tag_("dtlsr"),
       announce_eid_("dtn://*/dtlsr?*"),
       current_lsas_("DTLSRRouter::current_lsas"),
-      periodic_lsa_timer_(this),
-      delayed_lsa_timer_(this)
+      lsa_baseline_seqno_(0),
+      periodic_lsa_timer_(this, true),
+      delayed_lsa_timer_(this, false),
+      recompute_timer_(),
+      recompute_pending_(false)
 {
     // override add_nexthop_routes since it just confuses things
     config_.add_nexthop_routes_ = false;
@@ -277,6 +280,7 @@ DTLSRRouter::delete_bundle(const BundleRef& bundle)
     {
         log_crit("deleting bundle id %"PRIbid" while still on current lsas list",
                  bundle->bundleid());
+        forget_current_lsa(bundle.object());
         current_lsas_.erase(bundle);
     }
 }
@@ -289,7 +293,7 @@ DTLSRRouter::handle_link_created(LinkCreatedEvent* e)
     // on the link type.
 
     invalidate_routes();
-    recompute_routes();
+    schedule_recompute();
     TableBasedRouter::handle_link_created(e);
 }
 
@@ -323,6 +327,7 @@ DTLSRRouter::handle_bundle_expired(BundleExpiredEvent* e)
         log_notice("current lsa for %s expired... kicking links",
                    bundle->source().c_str());
         handle_lsa_expired(bundle);
+        forget_current_lsa(bundle);
         current_lsas_.erase(bundle);
     }
     
@@ -358,9 +363,9 @@ DTLSRRouter::handle_contact_up(ContactUpEvent* e)
         edge->mutable_info().params_.state_ = LinkParams::LINK_UP;
     }
 
-    // always calculate the new routing graph now
+    // a link coming up can always give shorter paths
     invalidate_routes();
-    recompute_routes();
+    schedule_recompute();
     
     // schedule a new lsa to include the new link
     schedule_lsa();
@@ -402,9 +407,11 @@ DTLSRRouter::handle_contact_down(ContactDownEvent* e)
         
     edge->mutable_info().params_.state_ = LinkParams::LINK_DOWN;
 
-    // calculate the new routing graph
-    invalidate_routes();
-    recompute_routes();
+    // calculate the new routing graph, unless no route uses the link
+    if (in_route_tree(edge)) {
+        invalidate_routes();
+        schedule_recompute();
+    }
 
     // inform peers
     schedule_lsa();
@@ -498,6 +505,7 @@ void
 DTLSRRouter::remove_edge(RoutingGraph::Edge* edge)
 {
     log_debug("remove_edge %s", edge->info().id_.c_str());
+    route_tree_.erase(edge_key(edge));
     bool ok = graph_.del_edge(local_node_, edge);
     ASSERT(ok);
 }
@@ -537,22 +545,101 @@ DTLSRRouter::is_dynamic_route(RouteEntry* entry)
     return false;
 }
 
+//----------------------------------------------------------------------
+DTLSRRouter::EdgeKey
+DTLSRRouter::edge_key(const RoutingGraph::Edge* edge)
+{
+    return EdgeKey(edge->source()->id(), edge->info().id_);
+}
+
+//----------------------------------------------------------------------
+bool
+DTLSRRouter::in_route_tree(const RoutingGraph::Edge* edge) const
+{
+    return route_tree_.find(edge_key(edge)) != route_tree_.end();
+}
+
 //----------------------------------------------------------------------
 void
-DTLSRRouter::recompute_routes()
+DTLSRRouter::schedule_recompute()
 {
-//     // XXX/demmer make this a parameter
-//     u_int32_t elapsed = last_update_.elapsed_ms() / 1000;
-//     if (elapsed < config()->recompute_delay_) {
-//         log_debug("not recomputing routes since %u ms elapsed since last update",
-//                   elapsed);
-//         return;
-//     }
+    if (config()->recompute_delay_ == 0) {
+        recompute_routes();
+        return;
+    }
+
+    last_change_.get_time();
+    if (! recompute_pending_) {
+        recompute_pending_ = true;
+        first_change_ = last_change_;
+    }
+
+    // the timeout pushes itself back while the changes keep coming
+    if (! recompute_timer_.pending()) {
+        recompute_timer_.schedule_in(config()->recompute_delay_ * 1000);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::RecomputeTimer::timeout(const struct timeval& now)
+{
+    (void)now;
+    BundleDaemon::post(new RecomputeEvent());
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::handle_event(BundleEvent* event)
+{
+    if (dynamic_cast<RecomputeEvent*>(event) != NULL) {
+        recompute_timeout();
+        return;
+    }
 
+    TableBasedRouter::handle_event(event);
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::recompute_timeout()
+{
+    if (! recompute_pending_) {
+        return; // already recomputed
+    }
+
+    u_int32_t quiet_ms   = last_change_.elapsed_ms();
+    u_int32_t waited_ms  = first_change_.elapsed_ms();
+    u_int32_t delay_ms   = config()->recompute_delay_ * 1000;
+    u_int32_t max_ms     = std::max(config()->max_recompute_delay_,
+                                    config()->recompute_delay_) * 1000;
+
+    if (quiet_ms < delay_ms && waited_ms < max_ms) {
+        u_int32_t wait = std::min(delay_ms - quiet_ms, max_ms - waited_ms);
+        log_debug("recompute_timeout: graph changed %u ms ago, "
+                  "waiting %u ms more", quiet_ms, wait);
+        if (! recompute_timer_.pending()) {
+            recompute_timer_.schedule_in(wait);
+        }
+        return;
+    }
+
+    recompute_routes();
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::recompute_routes()
+{
     log_debug("recomputing all routes");
     last_update_.get_time();
+    recompute_pending_ = false;
 
     route_table_->del_matching_entries(is_dynamic_route);
+    route_tree_.clear();
+
+    // the graph doesn't change during the searches below
+    graph_.freeze();
 
     // loop through all the nodes in the graph, finding the right
     // route and re-adding it
@@ -571,13 +658,22 @@ DTLSRRouter::recompute_routes()
         // XXX/demmer this should include more criteria for
         // classification, i.e. the priority class, perhaps the size
         // limit, etc
-        RoutingGraph::Edge* edge = graph_.best_next_hop(local_node_, dest,
-                                                        weight_fn_);
-        if (edge == NULL) {
+        RoutingGraph::EdgeVector path;
+        graph_.shortest_path(local_node_, dest, &path, weight_fn_);
+        if (path.empty()) {
 //            log_warn("no route to destination %s", dest->id().c_str());
             continue;
         }
 
+        // remember all the edges the routes depend on
+        RoutingGraph::EdgeVector::const_iterator e;
+        for (e = path.begin(); e != path.end(); ++e) {
+            route_tree_.insert(edge_key(*e));
+        }
+
+        RoutingGraph::Edge* edge = path.back();
+        ASSERT(edge->source() == local_node_); // sanity
+
         ContactManager* cm = BundleDaemon::instance()->contactmgr();
         LinkRef link = cm->find_link(edge->info().id_.c_str());
         if (link == NULL) {
@@ -637,6 +733,16 @@ DTLSRRouter::Reg::deliver_bundle(Bundle* bundle)
         }
         
         router_->handle_lsa(bundle, &lsa);
+    } else if (type == DTLSR::MSG_LSA_DELTA) {
+        log_info("got delta LSA bundle *%p",bundle);
+        
+        LSADelta lsa;
+        if (!DTLSR::parse_lsa_delta_bundle(bundle, &lsa)) {
+            log_warn("error parsing delta LSA");
+            goto bail;
+        }
+        
+        router_->handle_lsa(bundle, &lsa, true, lsa.base_seqno_);
     } else {
         log_err("unknown message type %d", type);
     }
@@ -648,11 +754,26 @@ bail:
 //----------------------------------------------------------------------
 bool
 DTLSRRouter::update_current_lsa(RoutingGraph::Node* node,
-                                Bundle* bundle, u_int64_t seqno)
+                                Bundle* bundle, u_int64_t seqno,
+                                bool delta)
 {
     bool found_stale_lsa = false;
+    bool late_full = false;
     if (seqno <= node->info().last_lsa_seqno_ &&
-        bundle->creation_ts().seconds_ < node->info().last_lsa_creation_ts_)
+        bundle->creation_ts().seconds_ < node->info().last_lsa_creation_ts_ &&
+        !delta && seqno > node->info().last_full_lsa_seqno_)
+    {
+        // a full LSA that got here after a later delta is still newer
+        // than the full one we have, so it only takes the full slot
+        log_info("update_current_lsa: "
+                 "got full LSA (seqno %"PRIu64" > last full %"PRIu64") "
+                 "after a later delta (seqno %"PRIu64")",
+                 seqno, node->info().last_full_lsa_seqno_,
+                 node->info().last_lsa_seqno_);
+        late_full = true;
+    }
+    else if (seqno <= node->info().last_lsa_seqno_ &&
+             bundle->creation_ts().seconds_ < node->info().last_lsa_creation_ts_)
     {
         log_info("update_current_lsa: "
                  "ignoring stale LSA (seqno %"PRIu64" <= last %"PRIu64", "
@@ -680,39 +801,19 @@ DTLSRRouter::update_current_lsa(RoutingGraph::Node* node,
 
     oasys::ScopeLock l(current_lsas_.lock(),
                        "DTLSRRouter::update_current_lsa");
-    for (BundleList::iterator iter = current_lsas_.begin();
-         iter != current_lsas_.end(); ++iter)
-    {
-        if ((*iter)->source() == node->id()) {
-            // be careful not to let the bundle reference count drop
-            // to zero by keeping a local reference until we can make
-            // sure it's at least in the NotNeededEvent
-            BundleRef stale_lsa("DTLSRRouter::update_current_lsa");
-            stale_lsa = *iter;
-
-            current_lsas_.erase(iter);
 
-            log_debug("cancelling pending transmissions for *%p",
-                      stale_lsa.object());
-
-            stale_lsa->fwdlog()->add_entry(EndpointIDPattern::WILDCARD_EID(),
-                                           ForwardingInfo::FORWARD_ACTION,
-                                           ForwardingInfo::SUPPRESSED);
-            
-            BundleDaemon::post_at_head(
-                new BundleDeleteRequest(stale_lsa.object(),
-                                        BundleProtocol::REASON_NO_ADDTL_INFO));
-            found_stale_lsa = true;
-            
-//             oasys::StringBuffer buf("Stale LSA: ");
-//             bundle->format_verbose(&buf);
-//             log_multiline(oasys::LOG_INFO, buf.c_str());
-            
-            if (node->info().last_lsa_seqno_ == 0) {
-                NOTREACHED;
-            }
-            break;
-        }
+    // a full LSA replaces both current ones of the source, a delta
+    // only the previous delta, and a late full LSA only the full one
+    CurrentLSA* current = &current_lsa_index_[node->id()];
+    if (current->delta_ != NULL && !late_full) {
+        drop_current_lsa(current->delta_);
+        current->delta_ = NULL;
+        found_stale_lsa = true;
+    }
+    if (!delta && current->full_ != NULL) {
+        drop_current_lsa(current->full_);
+        current->full_ = NULL;
+        found_stale_lsa = true;
     }
 
     if (node->info().last_lsa_seqno_ == 0) {
@@ -727,15 +828,73 @@ DTLSRRouter::update_current_lsa(RoutingGraph::Node* node,
                  node->id().c_str(), node->info().last_lsa_seqno_, seqno);
     }
 
-    node->mutable_info().last_lsa_seqno_ = seqno;
-    node->mutable_info().last_lsa_creation_ts_ = bundle->creation_ts().seconds_;
+    if (! late_full) {
+        node->mutable_info().last_lsa_seqno_ = seqno;
+        node->mutable_info().last_lsa_creation_ts_ =
+            bundle->creation_ts().seconds_;
+    }
     current_lsas_.push_back(bundle);
+    if (delta) {
+        current->delta_ = bundle;
+    } else {
+        node->mutable_info().last_full_lsa_seqno_ = seqno;
+        current->full_ = bundle;
+    }
     return true;
 }
 
 //----------------------------------------------------------------------
 void
-DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa)
+DTLSRRouter::drop_current_lsa(Bundle* lsa)
+{
+    // be careful not to let the bundle reference count drop
+    // to zero by keeping a local reference until we can make
+    // sure it's at least in the NotNeededEvent
+    BundleRef stale_lsa("DTLSRRouter::drop_current_lsa");
+    stale_lsa = lsa;
+
+    current_lsas_.erase(lsa);
+
+    log_debug("cancelling pending transmissions for *%p",
+              stale_lsa.object());
+
+    stale_lsa->fwdlog()->add_entry(EndpointIDPattern::WILDCARD_EID(),
+                                   ForwardingInfo::FORWARD_ACTION,
+                                   ForwardingInfo::SUPPRESSED);
+    
+    BundleDaemon::post_at_head(
+        new BundleDeleteRequest(stale_lsa.object(),
+                                BundleProtocol::REASON_NO_ADDTL_INFO));
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::forget_current_lsa(Bundle* lsa)
+{
+    oasys::ScopeLock l(current_lsas_.lock(),
+                       "DTLSRRouter::forget_current_lsa");
+
+    CurrentLSAIndex::iterator iter =
+        current_lsa_index_.find(lsa->source().str());
+    if (iter == current_lsa_index_.end()) {
+        return;
+    }
+
+    if (iter->second.full_ == lsa) {
+        iter->second.full_ = NULL;
+    }
+    if (iter->second.delta_ == lsa) {
+        iter->second.delta_ = NULL;
+    }
+    if (iter->second.full_ == NULL && iter->second.delta_ == NULL) {
+        current_lsa_index_.erase(iter);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa, bool delta,
+                        u_int64_t base_seqno)
 {
     // First check the LSA bundle destination to see if the sender is
     // in a different area
@@ -759,10 +918,43 @@ DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa)
         a = graph_.add_node(source.str(), NodeInfo());
     }
 
-    if (! update_current_lsa(a, bundle, lsa->seqno_)) {
+    // a delta is applied even without its full LSA, it can only add
+    // to what we know until the next full one comes
+    if (delta && a->info().last_full_lsa_seqno_ != base_seqno) {
+        log_info("handle_lsa: delta LSA from %s against seqno %"PRIu64
+                 ", last full LSA seen %"PRIu64,
+                 source.c_str(), base_seqno, a->info().last_full_lsa_seqno_);
+    }
+
+    if (! update_current_lsa(a, bundle, lsa->seqno_, delta)) {
         return; // stale lsa
     }
 
+    // a full LSA that came after a later delta mustn't undo the
+    // delta, so skip the links the delta carries
+    if (!delta && lsa->seqno_ < a->info().last_lsa_seqno_) {
+        oasys::ScopeLock l(current_lsas_.lock(), "DTLSRRouter::handle_lsa");
+        Bundle* later = current_lsa_index_[a->id()].delta_;
+        LSADelta later_lsa;
+        if (later != NULL && DTLSR::parse_lsa_delta_bundle(later, &later_lsa))
+        {
+            for (LinkStateVec::iterator n = later_lsa.links_.begin();
+                 n != later_lsa.links_.end(); ++n)
+            {
+                for (LinkStateVec::iterator iter = lsa->links_.begin();
+                     iter != lsa->links_.end(); ++iter)
+                {
+                    if (iter->id_ == n->id_) {
+                        log_debug("handle_lsa: link %s is newer in the "
+                                  "delta LSA, skipping it", n->id_.c_str());
+                        lsa->links_.erase(iter);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
     // don't send the LSA back where we got it from
     ForwardingInfo info;
     if (bundle->fwdlog()->get_latest_entry(ForwardingInfo::RECEIVED, &info))
@@ -777,6 +969,11 @@ DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa)
     // XXX/demmer here we should drop all the links that aren't
     // present in the LSA...
 
+    // the routes only change with new nodes or edges, edges on a
+    // current route, or edges that got cheaper
+    bool routes_changed = false;
+    RoutingGraph::SearchInfo search_info(NULL);
+
     // Handle all the link announcements
     for (LinkStateVec::iterator iter = lsa->links_.begin();
          iter != lsa->links_.end(); ++iter)
@@ -803,6 +1000,7 @@ DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa)
             log_debug("handle_lsa: %s adding new dest node %s",
                       source.c_str(), ls->dest_.c_str());
             b = graph_.add_node(ls->dest_.str(), NodeInfo());
+            routes_changed = true;
         }
 
         // try to find and update the edge in the graph, otherwise add it
@@ -817,23 +1015,39 @@ DTLSRRouter::handle_lsa(Bundle* bundle, LSA* lsa)
 
         if (e == NULL) {
             e = graph_.add_edge(a, b, EdgeInfo(ls->id_, ls->params_));
+            routes_changed = true;
             
             log_debug("handle_lsa: added new edge %s from %s -> %s",
                       oasys::InlineFormatter<EdgeInfo>().format(e->info()),
                       a->id().c_str(), b->id().c_str());
+
+            // XXX/demmer fold this into a parameter update method
+            e->mutable_info().last_update_.get_time();
         } else {
+            u_int32_t old_weight = (*weight_fn_)(search_info, e);
+            
             e->mutable_info().params_ = ls->params_;
+
+            // XXX/demmer fold this into a parameter update method
+            e->mutable_info().last_update_.get_time();
+
+            if (in_route_tree(e) ||
+                (*weight_fn_)(search_info, e) < old_weight)
+            {
+                routes_changed = true;
+            }
             
             log_debug("handle_lsa: updated edge %s from %s -> %s",
                       oasys::InlineFormatter<EdgeInfo>().format(e->info()),
                       a->id().c_str(), b->id().c_str());
         }
-
-        // XXX/demmer fold this into a parameter update method
-        e->mutable_info().last_update_.get_time();
     }
 
-    recompute_routes();
+    if (routes_changed) {
+        schedule_recompute();
+    } else {
+        log_debug("handle_lsa: no change to the current routes");
+    }
 }
 
 //----------------------------------------------------------------------
@@ -860,6 +1074,19 @@ DTLSRRouter::handle_lsa_expired(Bundle* bundle)
     */
 }
 
+//----------------------------------------------------------------------
+bool
+DTLSRRouter::same_link_state(const LinkState& a, const LinkState& b)
+{
+    // elapsed_ and the queue stats change at nearly every LSA, so a
+    // delta leaves them out and the next full LSA refreshes them
+    return a.dest_          == b.dest_          &&
+           a.params_.state_ == b.params_.state_ &&
+           a.params_.cost_  == b.params_.cost_  &&
+           a.params_.delay_ == b.params_.delay_ &&
+           a.params_.bw_    == b.params_.bw_;
+}
+
 //----------------------------------------------------------------------
 void
 DTLSRRouter::generate_link_state(LinkState* ls,
@@ -890,7 +1117,7 @@ void
 DTLSRRouter::TransmitLSATimer::timeout(const struct timeval& now)
 {
     (void)now;
-    router_->send_lsa();
+    router_->send_lsa(full_);
     if (interval_ != 0) {
         schedule_in(interval_);
     }
@@ -925,7 +1152,7 @@ DTLSRRouter::schedule_lsa()
 
 //----------------------------------------------------------------------
 void
-DTLSRRouter::send_lsa()
+DTLSRRouter::send_lsa(bool full)
 {
     char tmp[64]; (void)tmp;
     LSA lsa;
@@ -958,6 +1185,58 @@ DTLSRRouter::send_lsa()
     log_debug("send_lsa: generated %zu link states for local node",
               lsa.links_.size());
 
+    // between the full LSAs only send the links that changed since
+    // the last one, or went away
+    LSADelta delta;
+    if (! full && config()->delta_lsas_ && lsa_baseline_seqno_ != 0) {
+        delta.seqno_      = lsa.seqno_;
+        delta.base_seqno_ = lsa_baseline_seqno_;
+
+        std::set<std::string> present;
+        for (LinkStateVec::iterator iter = lsa.links_.begin();
+             iter != lsa.links_.end(); ++iter)
+        {
+            present.insert(iter->id_);
+
+            std::map<std::string, LinkState>::iterator base =
+                lsa_baseline_.find(iter->id_);
+            if (base == lsa_baseline_.end() ||
+                ! same_link_state(base->second, *iter))
+            {
+                delta.links_.push_back(*iter);
+            }
+        }
+
+        for (std::map<std::string, LinkState>::iterator base =
+                 lsa_baseline_.begin(); base != lsa_baseline_.end(); ++base)
+        {
+            if (present.find(base->first) == present.end()) {
+                LinkState gone = base->second;
+                gone.params_.state_ = LinkParams::LINK_DOWN;
+                delta.links_.push_back(gone);
+            }
+        }
+
+        // no point in a delta as big as the full LSA
+        full = (delta.links_.size() >= lsa.links_.size());
+    } else {
+        full = true;
+    }
+
+    if (full) {
+        lsa_baseline_.clear();
+        for (LinkStateVec::iterator iter = lsa.links_.begin();
+             iter != lsa.links_.end(); ++iter)
+        {
+            lsa_baseline_[iter->id_] = *iter;
+        }
+        lsa_baseline_seqno_ = lsa.seqno_;
+    } else {
+        log_debug("send_lsa: %zu of %zu link states changed since "
+                  "full LSA %"PRIu64, delta.links_.size(),
+                  lsa.links_.size(), lsa_baseline_seqno_);
+    }
+
     Bundle* bundle = new TempBundle();
 
     if (config()->area_ != "") {
@@ -974,9 +1253,13 @@ DTLSRRouter::send_lsa()
     bundle->mutable_custodian()->assign(EndpointID::NULL_EID());
     bundle->set_expiration(config()->lsa_lifetime_);
     bundle->set_singleton_dest(false);
-    DTLSR::format_lsa_bundle(bundle, &lsa);
+    if (full) {
+        DTLSR::format_lsa_bundle(bundle, &lsa);
+    } else {
+        DTLSR::format_lsa_delta_bundle(bundle, &delta);
+    }
 
-    update_current_lsa(local_node_, bundle, lsa.seqno_);
+    update_current_lsa(local_node_, bundle, lsa.seqno_, !full);
     
     log_debug("send_lsa: formatted LSA bundle *%p", bundle);
 
@@ -17,6 +17,9 @@
 #ifndef _DTLSR_ROUTER_H_
 #define _DTLSR_ROUTER_H_
 
+#include <map>
+#include <set>
+
 #include "DTLSR.h"
 #include "DTLSRConfig.h"
 
@@ -45,6 +48,9 @@ public:
     bool can_delete_bundle(const BundleRef& bundle);
     void delete_bundle(const BundleRef& bundle);
     /// @}
+
+    /// Virtual from TableBasedRouter, takes out the recompute events
+    void handle_event(BundleEvent* event);
     
     /// @{ Event handlers 
     void handle_bundle_received(BundleReceivedEvent* e);
@@ -69,6 +75,7 @@ protected:
     typedef DTLSR::LinkState LinkState;
     typedef DTLSR::LinkStateVec LinkStateVec;
     typedef DTLSR::LSA LSA;
+    typedef DTLSR::LSADelta LSADelta;
     /// @}
     
     //----------------------------------------------------------------------
@@ -77,10 +84,12 @@ protected:
         NodeInfo()
             : last_lsa_seqno_(0),
               last_lsa_creation_ts_(0),
+              last_full_lsa_seqno_(0),
               last_eida_seqno_(0) {}
         
         u_int64_t last_lsa_seqno_;
         u_int64_t last_lsa_creation_ts_;
+        u_int64_t last_full_lsa_seqno_; ///< baseline of the deltas
         
         u_int64_t last_eida_seqno_;
 
@@ -125,14 +134,35 @@ protected:
     //----------------------------------------------------------------------
     class TransmitLSATimer : public oasys::Timer {
     public:
-        TransmitLSATimer(DTLSRRouter* router)
-            : router_(router), interval_(0) {}
+        TransmitLSATimer(DTLSRRouter* router, bool full)
+            : router_(router), interval_(0), full_(full) {}
         void timeout(const struct timeval& now);
         void set_interval(int interval) { interval_ = interval; }
 
     protected:
         DTLSRRouter* router_;
         int interval_;
+        bool full_;     ///< whether to send a full LSA
+    };
+
+    //----------------------------------------------------------------------
+    /// Timer for the coalesced recomputation. It runs on the timer
+    /// thread, so it only posts a RecomputeEvent and the daemon thread
+    /// does the rest.
+    class RecomputeTimer : public oasys::Timer {
+    public:
+        RecomputeTimer() {}
+        void timeout(const struct timeval& now);
+    };
+
+    //----------------------------------------------------------------------
+    /// Event of the recompute timer. The daemon's event types have no
+    /// router-private one, so it has the type of a link check, which
+    /// the daemon hands to the router untouched; handle_event takes it
+    /// out before the dispatch, so no link check handler ever sees it.
+    class RecomputeEvent : public LinkCheckDeferredEvent {
+    public:
+        RecomputeEvent() : LinkCheckDeferredEvent(NULL) {}
     };
 
     /// @{ Helper functions
@@ -141,10 +171,15 @@ protected:
                              RoutingGraph::Edge* e,
                              const LinkRef& link);
     bool update_current_lsa(RoutingGraph::Node* node,
-                            Bundle* bundle, u_int64_t seqno);
+                            Bundle* bundle, u_int64_t seqno,
+                            bool delta = false);
+    void drop_current_lsa(Bundle* lsa);
+    static bool same_link_state(const LinkState& a, const LinkState& b);
+    void forget_current_lsa(Bundle* lsa);
     void schedule_lsa();
-    void send_lsa();
-    void handle_lsa(Bundle* bundle, LSA* lsa);
+    void send_lsa(bool full = false);
+    void handle_lsa(Bundle* bundle, LSA* lsa, bool delta = false,
+                    u_int64_t base_seqno = 0);
     void handle_lsa_expired(Bundle* bundle);
     void drop_all_links(const EndpointID& source);
     static bool is_dynamic_route(RouteEntry* entry);
@@ -155,6 +190,11 @@ protected:
     bool time_to_age_routes();
     void invalidate_routes();
     void recompute_routes();
+    void schedule_recompute();
+    void recompute_timeout();
+    typedef std::pair<std::string, std::string> EdgeKey;
+    static EdgeKey edge_key(const RoutingGraph::Edge* edge);
+    bool in_route_tree(const RoutingGraph::Edge* edge) const;
     /// @}
 
     //--------------------------------------------------------------------
@@ -176,6 +216,23 @@ protected:
     /// constraint :)
     BundleList current_lsas_;
 
+    /// The current LSAs of a source: its latest full LSA and the
+    /// latest delta against it, both held by current_lsas_
+    struct CurrentLSA {
+        CurrentLSA() : full_(NULL), delta_(NULL) {}
+        Bundle* full_;
+        Bundle* delta_;
+    };
+
+    /// Index of current_lsas_ by source, protected by its lock
+    typedef std::map<std::string, CurrentLSA> CurrentLSAIndex;
+    CurrentLSAIndex current_lsa_index_;
+
+    /// The local link states of the last full LSA, by link name, and
+    /// its seqno. Delta LSAs carry what changed since.
+    std::map<std::string, LinkState> lsa_baseline_;
+    u_int64_t lsa_baseline_seqno_;
+
     /// The registration to receive lsa and eida announcements
     Reg* reg_;
 
@@ -191,6 +248,20 @@ protected:
 
     /// Time of the last update of local graph
     oasys::Time last_update_;
+
+    /// Timer for the coalesced recomputation of the routes
+    RecomputeTimer recompute_timer_;
+
+    /// Whether the graph changed since the routes were computed
+    bool recompute_pending_;
+
+    /// Times of the first and the last change since then
+    oasys::Time first_change_;
+    oasys::Time last_change_;
+
+    /// Edges of the shortest paths the current routes follow, by
+    /// source node and link name, since the graph deletes edges
+    std::set<EdgeKey> route_tree_;
 };
 
 } // namespace dtn
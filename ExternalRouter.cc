@@ -43,16 +43,22 @@
 
 #if defined(XERCES_C_ENABLED) && defined(EXTERNAL_DP_ENABLED)
 
+#include <algorithm>
 #include <memory>
 #include <iostream>
 #include <map>
 #include <vector>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include <string.h>
 #include <time.h>
 #include <netinet/in.h>
 #include <sstream>
 #include <xercesc/framework/MemBufFormatTarget.hpp>
+#include <xercesc/dom/DOM.hpp>
+#include <xercesc/util/XMLString.hpp>
 
 #include "ExternalRouter.h"
 #include "bundling/GbofId.h"
@@ -100,10 +106,294 @@
 
 namespace dtn {
 
+/// Header of a datagram of length prefixed messages: the leading zero
+/// can't start an XML document, then "RM" and the framing version
+static const char FRAME_MAGIC[4] = { '\0', 'R', 'M', 1 };
+
+/// Size of the network order length before each framed message
+static const size_t FRAME_LEN_SIZE = 4;
+
+/// Append the message to a framed datagram
+static void
+append_frame(std::string* datagram, const std::string& message)
+{
+    u_int32_t len = htonl(message.size());
+    datagram->append((const char*)&len, FRAME_LEN_SIZE);
+    datagram->append(message);
+}
+
+/*
+ * Binary encoding of the frequent messages, carried in the frames of a
+ * framed datagram next to the XML ones. A binary message starts with
+ * BINARY_MARK, which no XML document starts with, then:
+ *
+ *   u8 type, u64 sequence_ctr, then for the messages sent the eid and
+ *   eid_ipn strings, for the actions received the server_eid string,
+ *   then the fields of the type in the order of router.xsd
+ *
+ * Integers are in network order, booleans one byte, strings (and the
+ * enumerations, by their router.xsd value) a u32 length then the bytes,
+ * an optional field a presence byte then the field if present.
+ */
+
+/// First byte of a binary message
+static const char BINARY_MARK = '\0';
+
+/// Types of the binary messages
+enum {
+    // sent
+    BIN_BUNDLE_RECEIVED = 1,
+    BIN_BUNDLE_CUSTODY_ACCEPTED,
+    BIN_DATA_TRANSMITTED,
+    BIN_BUNDLE_DELIVERED,
+    BIN_BUNDLE_EXPIRED,
+    BIN_BUNDLE_SEND_CANCELLED,
+    BIN_BUNDLE_INJECTED,
+    BIN_LINK_DELETED,
+    BIN_LINK_AVAILABLE,
+    BIN_LINK_UNAVAILABLE,
+    BIN_BUNDLE_REPORT,
+
+    // received
+    BIN_SEND_BUNDLE_REQUEST = 128,
+    BIN_DELETE_BUNDLE_REQUEST,
+    BIN_BUNDLE_QUERY,
+};
+
+/// Appends the fields of a binary message
+class BinaryWriter {
+public:
+    BinaryWriter(std::string* buf) : buf_(buf) {}
+
+    void u8(u_int8_t v)      { buf_->push_back((char)v); }
+    void boolean(bool v)     { u8(v ? 1 : 0); }
+    void u32(u_int32_t v)    { v = htonl(v); buf_->append((const char*)&v, 4); }
+    void u64(u_int64_t v)    { u32((u_int32_t)(v >> 32)); u32((u_int32_t)v); }
+    void str(const std::string& v) { u32(v.size()); buf_->append(v); }
+
+private:
+    std::string* buf_;
+};
+
+/// Takes the fields of a binary message, ok() turns false as soon as
+/// a field goes past its end
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t len)
+        : data_(data), left_(len), ok_(true) {}
+
+    u_int8_t u8()    { u_int8_t v = 0; take(&v, 1); return v; }
+    bool boolean()   { return u8() != 0; }
+    u_int32_t u32()  { u_int32_t v = 0; take(&v, 4); return ntohl(v); }
+    u_int64_t u64()  { u_int64_t hi = u32(); return (hi << 32) | u32(); }
+
+    std::string str()
+    {
+        u_int32_t len = u32();
+        if (!ok_ || len > left_) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string v(data_, len);
+        data_ += len;
+        left_ -= len;
+        return v;
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    void take(void* v, size_t len)
+    {
+        if (!ok_ || len > left_) {
+            ok_ = false;
+            return;
+        }
+        memcpy(v, data_, len);
+        data_ += len;
+        left_ -= len;
+    }
+
+    const char* data_;
+    size_t      left_;
+    bool        ok_;
+};
+
 using namespace rtrmessage;
 
+/// Start a binary message sent to the external routers
+static void
+put_binary_header(BinaryWriter& w, u_int8_t type, const bpa& message)
+{
+    w.u8(BINARY_MARK);
+    w.u8(type);
+    w.u64(message.sequence_ctr());
+    w.str(message.eid().present() ? message.eid().get() : std::string());
+    w.str(message.eid_ipn().present() ? message.eid_ipn().get() : std::string());
+}
+
+/// Write a bundle of a bundle_report
+static void
+put_binary_bundle(BinaryWriter& w, const bundleType& b)
+{
+    w.str(b.source().uri());
+    w.str(b.dest().uri());
+    w.str(b.custodian().uri());
+    w.str(b.replyto().uri());
+    w.str(b.prevhop().uri());
+    w.u32(b.length());
+    w.str(b.location());
+    w.boolean(b.payload_file().present());
+    if (b.payload_file().present())
+        w.str(b.payload_file().get());
+    w.u64(b.bundleid());
+    w.boolean(b.is_fragment());
+    w.boolean(b.is_admin());
+    w.boolean(b.do_not_fragment());
+    w.str(b.priority());
+    w.boolean(b.custody_requested());
+    w.boolean(b.local_custody());
+    w.boolean(b.singleton_dest());
+    w.boolean(b.custody_rcpt());
+    w.boolean(b.receive_rcpt());
+    w.boolean(b.forward_rcpt());
+    w.boolean(b.delivery_rcpt());
+    w.boolean(b.deletion_rcpt());
+    w.boolean(b.app_acked_rcpt());
+    w.u32(b.creation_ts_seconds());
+    w.u32(b.creation_ts_seqno());
+    w.u32(b.expiration());
+    w.u32(b.orig_length());
+    w.u32(b.frag_offset());
+    w.str(b.owner());
+    w.u64(b.custodyid());
+    w.u64(b.ecos_flags());
+    w.u64(b.ecos_ordinal());
+    w.boolean(b.ecos_flowlabel().present());
+    if (b.ecos_flowlabel().present())
+        w.u64(b.ecos_flowlabel().get());
+}
+
+/**
+ * Encode the message in binary if its type has a binary encoding.
+ * The link events that carry the whole link or contact (opened,
+ * closed, created) and the rare messages stay XML.
+ */
+static bool
+encode_binary(const bpa& message, std::string* out)
+{
+    BinaryWriter w(out);
+
+    if (message.bundle_received_event().present()) {
+        const bundle_received_event& e = message.bundle_received_event().get();
+        put_binary_header(w, BIN_BUNDLE_RECEIVED, message);
+        w.str(e.source());
+        w.str(e.dest());
+        w.str(e.custodian());
+        w.str(e.replyto());
+        w.str(e.prevhop());
+        w.u64(e.local_id());
+        w.str(e.gbofid_str());
+        w.u64(e.custodyid());
+        w.u32(e.expiration());
+        w.u32(e.bytes_received());
+        w.boolean(e.custody_transfer_requested());
+        w.str(e.link_id());
+        w.str(e.priority());
+        w.u32(e.ecos_flags());
+        w.u32(e.ecos_ordinal());
+        w.boolean(e.ecos_flowlabel().present());
+        if (e.ecos_flowlabel().present())
+            w.u32(e.ecos_flowlabel().get());
+        w.boolean(e.num_meta_blocks().present());
+        if (e.num_meta_blocks().present())
+            w.u32(e.num_meta_blocks().get());
+    } else if (message.bundle_custody_accepted_event().present()) {
+        const bundle_custody_accepted_event& e =
+            message.bundle_custody_accepted_event().get();
+        put_binary_header(w, BIN_BUNDLE_CUSTODY_ACCEPTED, message);
+        w.u64(e.local_id());
+        w.u64(e.custodyid());
+        w.str(e.custodian_str());
+        w.str(e.gbofid_str());
+    } else if (message.data_transmitted_event().present()) {
+        const data_transmitted_event& e = message.data_transmitted_event().get();
+        put_binary_header(w, BIN_DATA_TRANSMITTED, message);
+        w.u64(e.local_id());
+        w.str(e.link_id());
+        w.u32(e.bytes_sent());
+        w.u32(e.reliably_sent());
+        w.str(e.gbofid_str());
+    } else if (message.bundle_delivered_event().present()) {
+        const bundle_delivered_event& e = message.bundle_delivered_event().get();
+        put_binary_header(w, BIN_BUNDLE_DELIVERED, message);
+        w.u64(e.local_id());
+        w.str(e.gbofid_str());
+    } else if (message.bundle_expired_event().present()) {
+        const bundle_expired_event& e = message.bundle_expired_event().get();
+        put_binary_header(w, BIN_BUNDLE_EXPIRED, message);
+        w.u64(e.local_id());
+        w.str(e.gbofid_str());
+    } else if (message.bundle_send_cancelled_event().present()) {
+        const bundle_send_cancelled_event& e =
+            message.bundle_send_cancelled_event().get();
+        put_binary_header(w, BIN_BUNDLE_SEND_CANCELLED, message);
+        w.str(e.link_id());
+        w.u64(e.local_id());
+        w.str(e.gbofid_str());
+    } else if (message.bundle_injected_event().present()) {
+        const bundle_injected_event& e = message.bundle_injected_event().get();
+        put_binary_header(w, BIN_BUNDLE_INJECTED, message);
+        w.str(e.request_id());
+        w.u64(e.local_id());
+        w.str(e.gbofid_str());
+    } else if (message.link_deleted_event().present()) {
+        const link_deleted_event& e = message.link_deleted_event().get();
+        put_binary_header(w, BIN_LINK_DELETED, message);
+        w.str(e.link_id());
+        w.str(e.reason());
+    } else if (message.link_available_event().present()) {
+        const link_available_event& e = message.link_available_event().get();
+        put_binary_header(w, BIN_LINK_AVAILABLE, message);
+        w.str(e.link_id());
+        w.str(e.reason());
+    } else if (message.link_unavailable_event().present()) {
+        const link_unavailable_event& e = message.link_unavailable_event().get();
+        put_binary_header(w, BIN_LINK_UNAVAILABLE, message);
+        w.str(e.link_id());
+        w.str(e.reason());
+    } else if (message.bundle_report().present()) {
+        const bundle_report& e = message.bundle_report().get();
+        put_binary_header(w, BIN_BUNDLE_REPORT, message);
+
+        w.u32(e.bundle().size());
+        bundle_report::bundle::const_iterator b;
+        for (b = e.bundle().begin(); b != e.bundle().end(); ++b)
+            put_binary_bundle(w, *b);
+
+        w.u32(e.removed().size());
+        bundle_report::removed::const_iterator r;
+        for (r = e.removed().begin(); r != e.removed().end(); ++r)
+            w.u64(*r);
+
+        w.boolean(e.report_seq().present());
+        if (e.report_seq().present())
+            w.u64(e.report_seq().get());
+        w.boolean(e.since().present());
+        if (e.since().present())
+            w.u64(e.since().get());
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
 ExternalRouter::ExternalRouter()
     : BundleRouter("ExternalRouter", "external"),
+      // the boot time in the upper half, so that a since from a
+      // previous run never matches the journal of this one
+      report_seq_(((u_int64_t) time(NULL)) << 32),
       initialized_(false)
 {
     log_notice("Creating ExternalRouter");
@@ -128,6 +418,9 @@ ExternalRouter::initialize()
 
     send_seq_ctr_ = 0;
 
+    // Start from the configured encoding, before any thread reads it
+    current_encoding_.value = encoding;
+
     // Create the static route table
     route_table_ = new RouteTable("external");
 
@@ -142,7 +435,7 @@ ExternalRouter::initialize()
         external_rtr_shutdown, (void *) 0);
 
     // Start module server thread
-    srv_ = new ModuleServer();
+    srv_ = new ModuleServer(this);
     srv_->start();
 
     initialized_ = true;
@@ -161,6 +454,28 @@ ExternalRouter::shutdown()
     SEND(alert, e)
 }
 
+// Encoding of the messages sent
+ExternalRouter::encoding_t
+ExternalRouter::current_encoding()
+{
+    return (encoding_t) current_encoding_.value;
+}
+
+// Switch to a more compact encoding, never back to a less compact one
+bool
+ExternalRouter::upgrade_encoding(encoding_t enc)
+{
+    u_int32_t cur = current_encoding_.value;
+    while (cur < (u_int32_t) enc) {
+        u_int32_t old = oasys::atomic_cmpxchg32(&current_encoding_,
+                                                cur, enc);
+        if (old == cur)
+            return true;
+        cur = old;
+    }
+    return false;
+}
+
 // Format the given StringBuffer with static routing info
 void
 ExternalRouter::get_routing_state(oasys::StringBuffer* buf)
@@ -213,6 +528,14 @@ ExternalRouter::can_delete_bundle(const BundleRef& bundle)
 
     return true;
 }
+
+void
+ExternalRouter::delete_bundle(const BundleRef& bundle)
+{
+    journal_bundle(bundle->bundleid(), true);
+
+    BundleRouter::delete_bundle(bundle);
+}
  
 bool
 ExternalRouter::accept_custody(Bundle* bundle)
@@ -354,6 +677,8 @@ ExternalRouter::handle_bundle_received(BundleReceivedEvent *event)
                                    ((gen_meta == NULL)? 0 : gen_meta->size());
     e.num_meta_blocks(num_meta_blocks);
 
+    journal_bundle(event->bundleref_->bundleid(), false);
+
     SEND(bundle_received_event, e)
 }
 
@@ -369,6 +694,8 @@ void ExternalRouter::handle_bundle_custody_accepted(BundleCustodyAcceptedEvent*
         event->bundleref_->custodian().c_str(),
         event->bundleref_->gbofid_str().c_str());
 
+    journal_bundle(event->bundleref_->bundleid(), false);
+
     SEND(bundle_custody_accepted_event, e)
 }
 
@@ -383,6 +710,7 @@ ExternalRouter::handle_bundle_transmitted(BundleTransmittedEvent* event)
         event->bytes_sent_,
         event->reliably_sent_,
         event->bundleref_->gbofid_str());
+    journal_bundle(event->bundleref_->bundleid(), false);
     SEND(data_transmitted_event, e)
 }
 
@@ -392,6 +720,7 @@ ExternalRouter::handle_bundle_delivered(BundleDeliveredEvent* event)
     bpa::bundle_delivered_event::type e(
         event->bundleref_->bundleid(),
         event->bundleref_->gbofid_str());
+    journal_bundle(event->bundleref_->bundleid(), false);
     SEND(bundle_delivered_event, e)
 }
 
@@ -401,6 +730,7 @@ ExternalRouter::handle_bundle_expired(BundleExpiredEvent* event)
     bpa::bundle_expired_event::type e(
         event->bundleref_->bundleid(),
         event->bundleref_->gbofid_str());
+    journal_bundle(event->bundleref_->bundleid(), true);
     SEND(bundle_expired_event, e)
 }
 
@@ -411,6 +741,7 @@ ExternalRouter::handle_bundle_cancelled(BundleSendCancelledEvent* event)
         event->link_.object()->name_str(),
         event->bundleref_->bundleid(),
         event->bundleref_->gbofid_str());
+    journal_bundle(event->bundleref_->bundleid(), false);
     SEND(bundle_send_cancelled_event, e)
 }
 
@@ -421,6 +752,7 @@ ExternalRouter::handle_bundle_injected(BundleInjectedEvent* event)
         event->request_id_,
         event->bundleref_->bundleid(),
         event->bundleref_->gbofid_str());
+    journal_bundle(event->bundleref_->bundleid(), false);
     SEND(bundle_injected_event, e)
 }
 
@@ -720,7 +1052,26 @@ ExternalRouter::handle_contact_report(ContactReportEvent* event)
 void
 ExternalRouter::handle_bundle_report(BundleReportEvent *event)
 {
-    (void) event;
+    // a report for anything but an external router's query is a full one
+    u_int64_t since = FULL_REPORT;
+    BundleQueryReportEvent* query = dynamic_cast<BundleQueryReportEvent*>(event);
+    if (query != NULL) {
+        since = query->since_;
+    }
+
+    // a delta needs all the changes after since in the journal
+    if (since != FULL_REPORT && since <= report_seq_ &&
+        (journal_.empty() ? since == report_seq_
+                          : since + 1 >= journal_.front().seq_)) {
+        generate_bundle_report_delta(since);
+        return;
+    }
+
+    if (since != FULL_REPORT) {
+        log_debug("bundle report since %"PRIu64" not in the journal "
+                  "(report_seq %"PRIu64"), sending a full report",
+                  since, report_seq_);
+    }
 
 #ifdef PENDING_BUNDLES_IS_MAP
     generate_bundle_report_from_map();
@@ -729,6 +1080,64 @@ ExternalRouter::handle_bundle_report(BundleReportEvent *event)
 #endif
 }
 
+void
+ExternalRouter::journal_bundle(bundleid_t bundleid, bool removed)
+{
+    JournalEntry entry;
+    entry.seq_ = ++report_seq_;
+    entry.bundleid_ = bundleid;
+    entry.removed_ = removed;
+    journal_.push_back(entry);
+
+    if (journal_.size() > MAX_JOURNAL)
+        journal_.pop_front();
+}
+
+void
+ExternalRouter::generate_bundle_report_delta(u_int64_t since)
+{
+    BundleDaemon *bd = BundleDaemon::instance();
+
+    // the last change of each bundle after since
+    std::map<bundleid_t, bool> changes;
+    if (!journal_.empty()) {
+        size_t first = since + 1 - journal_.front().seq_;
+        for (size_t i = first; i < journal_.size(); ++i)
+            changes[journal_[i].bundleid_] = journal_[i].removed_;
+    }
+
+    log_debug("generate_bundle_report_delta - %zu bundles changed since %"PRIu64,
+              changes.size(), since);
+
+    std::map<bundleid_t, bool>::iterator iter = changes.begin();
+    do {
+        bundle_report report;
+        bundle_report::bundle::container c;
+        bundle_report::removed::container r;
+
+        // 25 bundles per message like the full report
+        for (int ctr = 0; iter != changes.end() && ctr < 25; ++iter, ++ctr) {
+            BundleRef bref("ExternalRouter::generate_bundle_report_delta");
+            if (!iter->second)
+                bref = bd->all_bundles()->find_for_storage(iter->first);
+
+            // the full report only has the pending bundles, the others
+            // (e.g. delivered and waiting to be freed) are gone for the
+            // client
+            if (bref != NULL && bd->pending_bundles()->contains(bref))
+                c.push_back(bundle_report::bundle::type(bref.object()));
+            else
+                r.push_back(iter->first);
+        }
+
+        report.bundle(c);
+        report.removed(r);
+        report.since(since);
+        report.report_seq(report_seq_);
+        SEND(bundle_report, report)
+    } while (iter != changes.end());
+}
+
 #ifdef PENDING_BUNDLES_IS_MAP
 
 void
@@ -749,7 +1158,7 @@ ExternalRouter::generate_bundle_report_from_map()
     bundles->lock()->unlock();
 
     int ctr = 0;
-    while (bref != NULL) {
+    do {
         bundle_report report;
         bundle_report::bundle::container c;
 
@@ -761,10 +1170,11 @@ ExternalRouter::generate_bundle_report_from_map()
         }
 
         report.bundle(c);
+        report.report_seq(report_seq_);
         SEND(bundle_report, report)
 
         ctr = 0;
-    }
+    } while (bref != NULL);
 }
 
 #else
@@ -784,7 +1194,7 @@ ExternalRouter::generate_bundle_report_from_list()
     pending_bundles_t::iterator end = bundles->end();
 
     int ctr = 0;
-    while (i != end) {
+    do {
         bundle_report report;
         bundle_report::bundle::container c;
 
@@ -799,10 +1209,11 @@ ExternalRouter::generate_bundle_report_from_list()
         }
 
         report.bundle(c);
+        report.report_seq(report_seq_);
         SEND(bundle_report, report)
 
         ctr = 0;
-    }
+    } while (i != end);
 }
 
 #endif //PENDING_BUNDLES_IS_MAP
@@ -989,13 +1400,34 @@ ExternalRouter::send(bpa &message, const char* type_str)
 
     message.sequence_ctr(send_seq_ctr_++);
 
+    // the frequent messages skip the XML serialization
+    encoding_t enc = ExternalRouter::current_encoding();
+    if (enc == ENCODING_BINARY) {
+        std::string* event = new std::string();
+        if (encode_binary(message, event)) {
+            srv_->post_to_send(event);
+
+            //dz debug - to determine missed messages
+            if (NULL != type_str) {
+                log_info("%lu - %s", send_seq_ctr_-1, type_str);
+            }
+            return;
+        }
+        delete event;
+    }
+
     if (ExternalRouter::client_validation)
         map[""].schema = ExternalRouter::schema.c_str();
 
+    // the whitespace is only worth it for debugging
+    unsigned long flags = xml_schema::flags::dont_initialize;
+    if (enc != ENCODING_XML)
+        flags |= xml_schema::flags::dont_pretty_print;
+
     try {
-        bpa_(buf, message, map, "UTF-8",
-             xml_schema::flags::dont_initialize);
-        srv_->post_to_send(new std::string((char *)buf.getRawBuffer()));
+        bpa_(buf, message, map, "UTF-8", flags);
+        srv_->post_to_send(new std::string((char *)buf.getRawBuffer(),
+                                           buf.getLen()));
 
         //dz debug - to determine missed messages
         if (NULL != type_str) {
@@ -1035,12 +1467,13 @@ ExternalRouter::reason_to_str(int reason)
     }
 }
 
-ExternalRouter::ModuleServer::ModuleServer()
+ExternalRouter::ModuleServer::ModuleServer(ExternalRouter* router)
     : Thread("/router/external/moduleserver"),
       Logger("ExternalRouter::ModuleServer", "/router/external/moduleserver"),
       parser_(new oasys::XercesXMLUnmarshal(
                   ExternalRouter::server_validation,
-                  ExternalRouter::schema.c_str()))
+                  ExternalRouter::schema.c_str())),
+      router_(router)
 {
     set_logpath("/router/external/moduleserver");
 
@@ -1048,33 +1481,109 @@ ExternalRouter::ModuleServer::ModuleServer()
     Thread::set_flag(Thread::DELETE_ON_EXIT);
 
     last_recv_seq_ctr_ = 0;
-    eventq_ = new oasys::MsgQueue< std::string * >(logpath_);
+    eventq_ = new oasys::MsgQueue< RecvBuffer * >(logpath_);
 
-    receiver_ = new Receiver(this);
-    receiver_->start();
+    receiver_ = NULL;
+    local_ = NULL;
+    if (ExternalRouter::local_socket.empty()) {
+        receiver_ = new Receiver(this);
+        receiver_->start();
+    } else {
+        local_ = new LocalTransport(this);
+        local_->start();
+    }
 
-    sender_ = new Sender();
+    sender_ = new Sender(local_);
     sender_->start();
 }
 
 ExternalRouter::ModuleServer::~ModuleServer()
 {
-    receiver_->set_should_stop();
-    sender_->set_should_stop();
+    if (receiver_ != NULL)
+        receiver_->set_should_stop();
+
+    if (local_ != NULL) {
+        // the sender sends on the local transport's sockets, so it is
+        // joined first and the transport is deleted last
+        sender_->set_should_stop();
+        sender_->join();
+        delete sender_;
+
+        local_->set_should_stop();
+        local_->join();
+        delete local_;
+    } else {
+        sender_->set_should_stop();
+    }
 
     // free all pending events
-    std::string *event;
-    while (eventq_->try_pop(&event))
-        delete event;
+    RecvBuffer *buf;
+    while (eventq_->try_pop(&buf))
+        delete buf;
 
     delete eventq_;
+
+    for (size_t i = 0; i < pool_.size(); ++i)
+        delete pool_[i];
 }
 
-/// Post a string to send 
+ExternalRouter::ModuleServer::RecvBuffer::RecvBuffer()
+    : data_(new char[MAX_UDP_PACKET + 1]),
+      size_(MAX_UDP_PACKET),
+      len_(0)
+{
+}
+
+ExternalRouter::ModuleServer::RecvBuffer::~RecvBuffer()
+{
+    delete [] data_;
+}
+
+/// Grow the buffer for a larger local message
 void
-ExternalRouter::ModuleServer::post(std::string* event)
+ExternalRouter::ModuleServer::RecvBuffer::reserve(size_t len)
 {
-    eventq_->push_back(event);
+    if (len <= size_)
+        return;
+
+    delete [] data_;
+    data_ = new char[len + 1];
+    size_ = len;
+}
+
+/// Take a free receive buffer
+ExternalRouter::ModuleServer::RecvBuffer*
+ExternalRouter::ModuleServer::get_buffer()
+{
+    oasys::ScopeLock l(&pool_lock_, "ModuleServer::get_buffer");
+
+    if (pool_.empty())
+        return new RecvBuffer;
+
+    RecvBuffer* buf = pool_.back();
+    pool_.pop_back();
+    return buf;
+}
+
+/// Return a receive buffer to the pool
+void
+ExternalRouter::ModuleServer::put_buffer(RecvBuffer* buf)
+{
+    // don't hold on to the memory of a large local message
+    if (buf->size_ > MAX_UDP_PACKET) {
+        delete buf;
+        return;
+    }
+
+    oasys::ScopeLock l(&pool_lock_, "ModuleServer::put_buffer");
+    pool_.push_back(buf);
+}
+
+/// Post a datagram to process
+void
+ExternalRouter::ModuleServer::post(RecvBuffer* buf)
+{
+    eventq_->push_back(buf);
 }
 
 /// Post a string to send 
@@ -1108,20 +1617,228 @@ ExternalRouter::ModuleServer::run()
             continue;
         }
 
-        // check for an event
+        // process all the datagrams queued, not one per wake-up
         if (event_poll->revents & POLLIN) {
-            std::string *event;
-            if (eventq_->try_pop(&event)) {
-                ASSERT(event != NULL)
+            RecvBuffer *buf;
+            while (eventq_->try_pop(&buf)) {
+                ASSERT(buf != NULL)
 
-                process_action(event->c_str());
+                process_datagram(buf);
 
-                delete event;
+                put_buffer(buf);
             }    
         }
     }
 }
 
+// Handle a datagram from an external router
+void
+ExternalRouter::ModuleServer::process_datagram(RecvBuffer* buf)
+{
+    char* data = buf->data_;
+    size_t len = buf->len_;
+
+    if (len < sizeof(FRAME_MAGIC) ||
+        memcmp(data, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0) {
+        data[len] = '\0';
+        process_action(data);
+        return;
+    }
+
+    // the external router speaks the framed encoding, so answer in it too
+    if (ExternalRouter::upgrade_encoding(ExternalRouter::ENCODING_FRAMED)) {
+        log_notice("external router sent a framed datagram, "
+                   "switched to the framed encoding");
+    }
+
+    // a batch of length prefixed messages, each one is terminated in
+    // place over the first byte that follows it
+    size_t offset = sizeof(FRAME_MAGIC);
+    while (offset + FRAME_LEN_SIZE <= len) {
+        u_int32_t msg_len;
+        memcpy(&msg_len, data + offset, FRAME_LEN_SIZE);
+        msg_len = ntohl(msg_len);
+        offset += FRAME_LEN_SIZE;
+
+        if (msg_len > len - offset) {
+            log_warn("truncated message in framed datagram: "
+                     "%u bytes, %zu left", msg_len, len - offset);
+            break;
+        }
+
+        char* msg = data + offset;
+        if (msg_len > 0 && msg[0] == BINARY_MARK) {
+            process_binary_action(msg, msg_len);
+        } else {
+            char saved = msg[msg_len];
+            msg[msg_len] = '\0';
+            process_action(msg);
+            msg[msg_len] = saved;
+        }
+
+        offset += msg_len;
+    }
+}
+
+// Check that a message is addressed to this node
+bool
+ExternalRouter::ModuleServer::for_local_node(const std::string& server_eid)
+{
+    if ((0 != BundleDaemon::instance()->local_eid().compare(server_eid)) &&
+        (0 != BundleDaemon::instance()->local_eid_ipn().compare(server_eid)))
+    {
+        log_debug("received message for different server node: %s", server_eid.c_str());
+        return false;
+    }
+
+    log_debug("processing message for server node: %s", server_eid.c_str());
+    return true;
+}
+
+// Check for gaps in the sequence counter of the received messages
+void
+ExternalRouter::ModuleServer::check_seq_ctr(uint64_t seq_ctr)
+{
+    if (seq_ctr != last_recv_seq_ctr_+1) {
+        if (seq_ctr > last_recv_seq_ctr_) {
+            log_err("Possible missed messages - Last SeqCtr: %"PRIu64" Curr SeqCtr: %"PRIu64" - diff: %"PRIu64,
+                    last_recv_seq_ctr_, seq_ctr, (seq_ctr - last_recv_seq_ctr_));
+        } else if (0 != seq_ctr) {
+            log_err("Sequence Counter jumped backwards - Last SeqCtr: %"PRIu64" Curr SeqCtr: %"PRIu64,
+                    last_recv_seq_ctr_, seq_ctr);
+        }
+    }
+    last_recv_seq_ctr_ = seq_ctr;
+}
+
+// Handle a binary message from an external router
+void
+ExternalRouter::ModuleServer::process_binary_action(const char* msg, size_t len)
+{
+    // the external router speaks the binary encoding, so answer in it too
+    if (ExternalRouter::upgrade_encoding(ExternalRouter::ENCODING_BINARY)) {
+        log_notice("external router sent a binary message, "
+                   "switched to the binary encoding");
+    }
+
+    BinaryReader r(msg, len);
+    r.u8(); // BINARY_MARK
+    u_int8_t type = r.u8();
+    uint64_t seq_ctr = r.u64();
+    std::string server_eid = r.str();
+
+    if (!r.ok()) {
+        log_warn("truncated binary message header: %zu bytes", len);
+        return;
+    }
+
+    if (!for_local_node(server_eid))
+        return;
+
+    check_seq_ctr(seq_ctr);
+
+    BundleDaemon *bd = BundleDaemon::instance();
+
+    switch (type) {
+    case BIN_SEND_BUNDLE_REQUEST: {
+        bundleid_t bid = r.u64();
+        std::string link = r.str();
+        std::string fwd_action = r.str();
+        if (!r.ok())
+            break;
+
+        int action = ForwardingInfo::INVALID_ACTION;
+        if (fwd_action == "forward")
+            action = ForwardingInfo::FORWARD_ACTION;
+        else if (fwd_action == "copy")
+            action = ForwardingInfo::COPY_ACTION;
+
+        log_debug("posting BundleSendRequest");
+        BundleRef br = bd->all_bundles()->find_for_storage(bid);
+        if (!bd->pending_bundles()->contains(br)) {
+            br.release();
+        }
+
+        if (br.object()) {
+            BundleDaemon::post(new BundleSendRequest(br, link, action));
+        } else {
+            log_warn("attempt to send nonexistent bundle: %"PRIbid, bid);
+        }
+        return;
+    }
+
+    case BIN_DELETE_BUNDLE_REQUEST: {
+        bundleid_t bid = r.u64();
+        if (!r.ok())
+            break;
+
+        log_debug("posting BundleDeleteRequest");
+        BundleRef br = bd->all_bundles()->find_for_storage(bid);
+        if (!bd->pending_bundles()->contains(br)) {
+            br.release();
+        }
+
+        if (br.object()) {
+            BundleDaemon::post(
+                new BundleDeleteRequest(br,
+                                        BundleProtocol::REASON_NO_ADDTL_INFO));
+        } else {
+            log_warn("attempt to delete nonexistent bundle: %"PRIbid, bid);
+        }
+        return;
+    }
+
+    case BIN_BUNDLE_QUERY: {
+        u_int64_t since = ExternalRouter::FULL_REPORT;
+        if (r.boolean())
+            since = r.u64();
+        if (!r.ok())
+            break;
+
+        log_debug("posting BundleQueryReportEvent");
+        BundleDaemon::post(new ExternalRouter::BundleQueryReportEvent(since));
+        return;
+    }
+
+    default:
+        log_warn("binary message of unknown type %u ignored", type);
+        return;
+    }
+
+    log_warn("truncated binary message of type %u: %zu bytes", type, len);
+}
+
+// The report_seq a bundle_query asks a delta from, in its "since"
+// attribute. bundle_query is an xs:anyType, so the attribute is read
+// from the DOM rather than from the bindings.
+static bool
+bundle_query_since(const xercesc::DOMDocument* doc, u_int64_t* since)
+{
+    XMLCh* any = xercesc::XMLString::transcode("*");
+    XMLCh* tag = xercesc::XMLString::transcode("bundle_query");
+    XMLCh* attr = xercesc::XMLString::transcode("since");
+    bool found = false;
+
+    xercesc::DOMNodeList* nodes = doc->getElementsByTagNameNS(any, tag);
+    if (nodes != NULL && nodes->getLength() > 0) {
+        const xercesc::DOMElement* query =
+            static_cast<const xercesc::DOMElement*>(nodes->item(0));
+        const XMLCh* value = query->getAttribute(attr);
+        if (value != NULL && *value != 0) {
+            char* str = xercesc::XMLString::transcode(value);
+            char* end;
+            *since = strtoull(str, &end, 10);
+            found = (end != str && *end == '\0');
+            xercesc::XMLString::release(&str);
+        }
+    }
+
+    xercesc::XMLString::release(&any);
+    xercesc::XMLString::release(&tag);
+    xercesc::XMLString::release(&attr);
+    return found;
+}
+
 // Handle a message from an external router
 void
 ExternalRouter::ModuleServer::process_action(const char *payload)
@@ -1160,32 +1877,11 @@ ExternalRouter::ModuleServer::process_action(const char *payload)
     if (!instance->server_eid().present()) {
         log_debug("received message without server_eid - probably a loopback: %s", payload);
         return;
-    } else {
-        if ((0 != BundleDaemon::instance()->local_eid().compare(instance->server_eid().get())) &&
-            (0 != BundleDaemon::instance()->local_eid_ipn().compare(instance->server_eid().get())))
-        {
-            log_debug("received message for different server node: %s", instance->server_eid().get().c_str());
-            return;
-        }
-        else {
-            log_debug("processing message for server node: %s", instance->server_eid().get().c_str());
-        }
+    } else if (!for_local_node(instance->server_eid().get())) {
+        return;
     }
 
-
-    uint64_t seq_ctr = instance->sequence_ctr();
-
-    // check for gaps in sequence counter
-    if (seq_ctr != last_recv_seq_ctr_+1) {
-        if (seq_ctr > last_recv_seq_ctr_) {
-            log_err("Possible missed messages - Last SeqCtr: %"PRIu64" Curr SeqCtr: %"PRIu64" - diff: %"PRIu64,
-                    last_recv_seq_ctr_, seq_ctr, (seq_ctr - last_recv_seq_ctr_));
-        } else if (0 != seq_ctr) {
-            log_err("Sequence Counter jumped backwards - Last SeqCtr: %"PRIu64" Curr SeqCtr: %"PRIu64,
-                    last_recv_seq_ctr_, seq_ctr);
-        }
-    }
-    last_recv_seq_ctr_ = seq_ctr; 
+    check_seq_ctr(instance->sequence_ctr());
 
 
     //dz debug
@@ -1747,8 +2443,11 @@ ExternalRouter::ModuleServer::process_action(const char *payload)
         }
     } else if (instance->bundle_query().present()) {
         msg_processed = true;
-        log_debug("posting BundleQueryRequest");
-        BundleDaemon::post(new BundleQueryRequest());
+        u_int64_t since;
+        if (!bundle_query_since(doc, &since))
+            since = ExternalRouter::FULL_REPORT;
+        log_debug("posting BundleQueryReportEvent");
+        BundleDaemon::post(new ExternalRouter::BundleQueryReportEvent(since));
     } else if (instance->contact_query().present()) {
         msg_processed = true;
         log_debug("posting ContactQueryRequest");
@@ -1916,13 +2615,19 @@ ExternalRouter::ModuleServer::Receiver::run()
     sock_poll->events = POLLIN;
     sock_poll->revents = 0;
 
-    char buf[MAX_UDP_PACKET];
-    in_addr_t raddr;
-    u_int16_t rport;
-    int bytes;
+    // datagrams are received straight into pooled buffers, which the
+    // module server processes in place and gives back
+    RecvBuffer* bufs[RECV_BATCH];
+    for (int i = 0; i < RECV_BATCH; ++i)
+        bufs[i] = NULL;
+
+#ifdef MSG_WAITFORONE
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iovs[RECV_BATCH];
+#endif
 
     while (1) {
-        if (should_stop()) return;
+        if (should_stop()) break;
 
         // block waiting...
         int ret = oasys::IO::poll_multiple(pollfds, 1, 10,
@@ -1941,24 +2646,266 @@ ExternalRouter::ModuleServer::Receiver::run()
         }
 
         if (sock_poll->revents & POLLIN) {
-            bytes = recvfrom(buf, MAX_UDP_PACKET, 0, &raddr, &rport);
-            buf[bytes] = '\0';
+#ifdef MSG_WAITFORONE
+            for (int i = 0; i < RECV_BATCH; ++i) {
+                if (bufs[i] == NULL)
+                    bufs[i] = parent_->get_buffer();
+
+                iovs[i].iov_base = bufs[i]->data_;
+                iovs[i].iov_len = MAX_UDP_PACKET;
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int count = recvmmsg(fd(), msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+            for (int i = 0; i < count; ++i) {
+                bufs[i]->len_ = msgs[i].msg_len;
+                parent_->post(bufs[i]);
+                bufs[i] = NULL;
+            }
+#else
+            if (bufs[0] == NULL)
+                bufs[0] = parent_->get_buffer();
+
+            int bytes = ::recv(fd(), bufs[0]->data_, MAX_UDP_PACKET, MSG_DONTWAIT);
+            if (bytes > 0) {
+                bufs[0]->len_ = bytes;
+                parent_->post(bufs[0]);
+                bufs[0] = NULL;
+            }
+#endif
+        }
+    }
+
+    // the module server may be gone already, don't touch its pool
+    for (int i = 0; i < RECV_BATCH; ++i)
+        delete bufs[i];
+}
+
+
+ExternalRouter::ModuleServer::LocalTransport::LocalTransport(ModuleServer* parent)
+    : Thread("/router/external/moduleserver/local", CREATE_JOINABLE),
+      Logger("ExternalRouter::ModuleServer::LocalTransport",
+             "/router/external/moduleserver/local"),
+      parent_(parent),
+      clients_lock_("/router/external/moduleserver/local/lock")
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (ExternalRouter::local_socket.size() >= sizeof(addr.sun_path)) {
+        log_err("local socket path too long: %s",
+                ExternalRouter::local_socket.c_str());
+        listen_fd_ = -1;
+    } else {
+        strcpy(addr.sun_path, ExternalRouter::local_socket.c_str());
+        listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    }
+
+    if (listen_fd_ != -1) {
+        // a socket left behind by a previous run
+        unlink(addr.sun_path);
+
+        if (::bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(listen_fd_, 8) < 0)
+        {
+            log_err("ExternalRouter::ModuleServer::LocalTransport::LocalTransport():  "
+                    "Failed to listen on %s:  %s", addr.sun_path, strerror(errno));
+            close(listen_fd_);
+            listen_fd_ = -1;
+        }
+    }
+
+    // joined and deleted by the module server, after the sender
+}
+
+ExternalRouter::ModuleServer::LocalTransport::~LocalTransport()
+{
+    oasys::ScopeLock l(&clients_lock_, "LocalTransport::~LocalTransport");
+    for (size_t i = 0; i < clients_.size(); ++i)
+        close(clients_[i]);
+    clients_.clear();
+
+    if (listen_fd_ != -1) {
+        close(listen_fd_);
+        unlink(ExternalRouter::local_socket.c_str());
+    }
+}
+
+/// Accept a new external router
+void
+ExternalRouter::ModuleServer::LocalTransport::accept_client()
+{
+    int fd = accept(listen_fd_, NULL, NULL);
+    if (fd < 0) {
+        log_warn("accept failed: %s", strerror(errno));
+        return;
+    }
+
+    // room for a whole batch, and a router that stops reading stalls
+    // the others for a second at most, then send() drops it
+    int bufsize = MAX_BATCH * 4;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    struct timeval timeout = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    oasys::ScopeLock l(&clients_lock_, "LocalTransport::accept_client");
+    clients_.push_back(fd);
+    log_info("external router connected (%zu)", clients_.size());
+}
+
+/// Receive a message straight into a pooled buffer
+bool
+ExternalRouter::ModuleServer::LocalTransport::receive(int fd)
+{
+    // the size of the next message, without taking it
+    ssize_t len = ::recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+    if (len < 0)
+        return (errno == EAGAIN || errno == EINTR);
+    if (len == 0)
+        return false;
+
+    if ((size_t)len > MAX_MESSAGE) {
+        log_warn("dropping a %zd byte message, larger than %zu",
+                 len, MAX_MESSAGE);
+        char discard;
+        ::recv(fd, &discard, 1, MSG_DONTWAIT);
+        return true;
+    }
+
+    RecvBuffer* buf = parent_->get_buffer();
+    buf->reserve(len);
+
+    ssize_t bytes = ::recv(fd, buf->data_, buf->size_, MSG_DONTWAIT);
+    if (bytes <= 0) {
+        parent_->put_buffer(buf);
+        return (bytes < 0 && (errno == EAGAIN || errno == EINTR));
+    }
 
-            parent_->post(new std::string(buf));
+    buf->len_ = bytes;
+    parent_->post(buf);
+    return true;
+}
+
+/// Send a message to every external router
+void
+ExternalRouter::ModuleServer::LocalTransport::send(const std::string& event)
+{
+    oasys::ScopeLock l(&clients_lock_, "LocalTransport::send");
+
+    for (size_t i = 0; i < clients_.size(); ++i) {
+        // one message per send, as with the datagrams
+        if (::send(clients_[i], event.data(), event.size(), MSG_NOSIGNAL) < 0) {
+            // a router that stopped reading (the send timed out) or is
+            // gone would cost every message, so it is dropped: the
+            // shutdown makes the run loop see a hangup and close it
+            log_warn("send of %zu bytes to external router failed: %s, "
+                     "dropping it", event.size(), strerror(errno));
+            ::shutdown(clients_[i], SHUT_RDWR);
         }
     }
 }
 
+// ModuleServer::LocalTransport main loop
+void
+ExternalRouter::ModuleServer::LocalTransport::run()
+{
+    // without a listening socket the thread stays up for the sender,
+    // poll() ignores the negative fd
+    std::vector<struct pollfd> pollfds;
+    std::vector<int> fds;
+
+    while (1) {
+        if (should_stop()) break;
+
+        // the listening socket, then the external routers
+        {
+            oasys::ScopeLock l(&clients_lock_, "LocalTransport::run");
+            fds = clients_;
+        }
+
+        pollfds.resize(fds.size() + 1);
+        pollfds[0].fd = listen_fd_;
+        pollfds[0].events = POLLIN;
+        pollfds[0].revents = 0;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            pollfds[i + 1].fd = fds[i];
+            pollfds[i + 1].events = POLLIN;
+            pollfds[i + 1].revents = 0;
+        }
+
+        // block waiting...
+        int ret = oasys::IO::poll_multiple(&pollfds[0], pollfds.size(), 10);
+
+        if (ret == oasys::IOINTR) {
+            log_debug("local transport interrupted");
+            set_should_stop();
+            continue;
+        }
+
+        if (ret == oasys::IOERROR) {
+            log_debug("local transport error");
+            set_should_stop();
+            continue;
+        }
 
-ExternalRouter::ModuleServer::Sender::Sender()
+        if (pollfds[0].revents & POLLIN)
+            accept_client();
+
+        for (size_t i = 0; i < fds.size(); ++i) {
+            short revents = pollfds[i + 1].revents;
+            if (revents == 0)
+                continue;
+
+            // take all the messages queued before noticing a hangup
+            bool alive = !(revents & (POLLERR | POLLNVAL));
+            if (alive && (revents & POLLIN))
+                alive = receive(fds[i]);
+            else if (revents & POLLHUP)
+                alive = false;
+
+            if (!alive) {
+                oasys::ScopeLock l(&clients_lock_, "LocalTransport::run");
+                std::vector<int>::iterator client =
+                    std::find(clients_.begin(), clients_.end(), fds[i]);
+                if (client != clients_.end())
+                    clients_.erase(client);
+                close(fds[i]);
+                log_info("external router disconnected (%zu)", clients_.size());
+            }
+        }
+    }
+}
+
+ExternalRouter::ModuleServer::Sender::Sender(LocalTransport* local)
     : IOHandlerBase(new oasys::Notifier("/router/external/moduleserver/sndr")),
       Thread("/router/external/moduleserver/sndr"),
+      held_(NULL),
+      local_(local),
+      max_batch_(local != NULL ? LocalTransport::MAX_BATCH : MAX_UDP_PACKET),
       bucket_(logpath(), 50000000, 65535*8)
 {
     set_logpath("/router/external/moduleserver/sndr");
 
     bytes_sent_ = 0;
 
+    // with the local transport the module server joins the sender
+    // before deleting the transport, otherwise it deletes itself
+    if (local_ == NULL)
+        Thread::set_flag(Thread::DELETE_ON_EXIT);
+    else
+        Thread::set_flag(Thread::CREATE_JOINABLE);
+
+    set_logfd(false);
+
+    eventq_ = new oasys::MsgQueue< std::string * >(logpath_);
+
+    // the local transport has its own sockets
+    if (local_ != NULL)
+        return;
+
     // router interface and external routers must be able to bind
     // to the same port
     params_.send_bufsize_ = 1024000;
@@ -1978,13 +2925,6 @@ ExternalRouter::ModuleServer::Sender::Sender()
                    &src_if, sizeof(src_if)) < 0)
         log_err("ExternalRouter::ModuleServer::Server::Server():  "
                 "Failed to set IP_MULTICAST_IF:  %s", strerror(errno));
-
-    // we always delete the thread object when we exit
-    Thread::set_flag(Thread::DELETE_ON_EXIT);
-
-    set_logfd(false);
-
-    eventq_ = new oasys::MsgQueue< std::string * >(logpath_);
 }
 
 ExternalRouter::ModuleServer::Sender::~Sender()
@@ -1995,6 +2935,7 @@ ExternalRouter::ModuleServer::Sender::~Sender()
         delete event;
 
     delete eventq_;
+    delete held_;
 }
 
 /// Post a string to send 
@@ -2004,18 +2945,43 @@ ExternalRouter::ModuleServer::Sender::post(std::string* event)
     eventq_->push_back(event);
 }
 
+/// Coalesce queued messages into a framed datagram
+std::string*
+ExternalRouter::ModuleServer::Sender::batch(std::string* event)
+{
+    std::string* datagram = new std::string(FRAME_MAGIC, sizeof(FRAME_MAGIC));
+
+    while (event != NULL) {
+        append_frame(datagram, *event);
+        delete event;
+        event = NULL;
+
+        if (!eventq_->try_pop(&event))
+            break;
+
+        if (datagram->size() + FRAME_LEN_SIZE + event->size() > max_batch_) {
+            held_ = event;
+            break;
+        }
+    }
+
+    return datagram;
+}
+
 /// ModuleServer Sender main loop
 void
 ExternalRouter::ModuleServer::Sender::run() 
 {
      
-    int rcv_bufsize = 0;
-    int snd_bufsize = 0;
-    socklen_t optlen = sizeof(rcv_bufsize);
-    getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcv_bufsize, &optlen);
-    getsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &snd_bufsize, &optlen);
-    log_always("ExternalRouter::ModuleServer::Sender::run - SocketBuffer sizes rcv/send: %u/%u",
-               rcv_bufsize, snd_bufsize);
+    if (local_ == NULL) {
+        int rcv_bufsize = 0;
+        int snd_bufsize = 0;
+        socklen_t optlen = sizeof(rcv_bufsize);
+        getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcv_bufsize, &optlen);
+        getsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &snd_bufsize, &optlen);
+        log_always("ExternalRouter::ModuleServer::Sender::run - SocketBuffer sizes rcv/send: %u/%u",
+                   rcv_bufsize, snd_bufsize);
+    }
 
     // block on input from the socket and
     // on input from the bundle event list
@@ -2030,54 +2996,67 @@ ExternalRouter::ModuleServer::Sender::run()
     while (1) {
         if (should_stop()) return;
 
-        // block waiting...
-        int ret = oasys::IO::poll_multiple(pollfds, 1, 10,
-            get_notifier());
+        // a message held back from the last batch goes out right away
+        std::string *event = held_;
+        held_ = NULL;
 
-        if (ret == oasys::IOINTR) {
-            log_debug("module server interrupted");
-            set_should_stop();
-            continue;
-        }
+        if (event == NULL) {
+            // block waiting...
+            int ret = oasys::IO::poll_multiple(pollfds, 1, 10,
+                get_notifier());
 
-        if (ret == oasys::IOERROR) {
-            log_debug("module server error");
-            set_should_stop();
-            continue;
+            if (ret == oasys::IOINTR) {
+                log_debug("module server interrupted");
+                set_should_stop();
+                continue;
+            }
+
+            if (ret == oasys::IOERROR) {
+                log_debug("module server error");
+                set_should_stop();
+                continue;
+            }
+
+            // check for an event
+            if (!(event_poll->revents & POLLIN) || !eventq_->try_pop(&event))
+                event = NULL;
         }
 
-        // check for an event
-        if (event_poll->revents & POLLIN) {
-            std::string *event;
-            if (eventq_->try_pop(&event)) {
-                ASSERT(event != NULL)
+        if (event != NULL) {
+            if (ExternalRouter::current_encoding() !=
+                ExternalRouter::ENCODING_XML)
+                event = batch(event);
 
-                if (first_transmit) {
-                    first_transmit = false;
-                    transmit_timer_.get_time();
-                }
+            if (first_transmit) {
+                first_transmit = false;
+                transmit_timer_.get_time();
+            }
 
 //dz debug??                while (!bucket_.try_to_drain(event->size()*8)) {
 //dz debug??                    spin_yield();
 //dz debug??                }
 
+            if (local_ != NULL) {
+                local_->send(*event);
+                bytes_sent_ += event->size();
+            } else {
                 int cc = sendto(const_cast< char * >(event->c_str()),
                     event->size(), 0,
                     ExternalRouter::multicast_addr_,
                     ExternalRouter::server_port);
 
                 bytes_sent_ += cc;
-                if (transmit_timer_.elapsed_ms() >= 1000) {
-                    //dz debug --- < 24Mbps with no rate limiting
-                    bytes_sent_ *= 8;
-                    log_debug("ExternalRouter sent %"PRIu64" bits in %u ms", 
-                             bytes_sent_, transmit_timer_.elapsed_ms());
-                    transmit_timer_.get_time();
-                    bytes_sent_ = 0;
-                }
-
-                delete event;
             }
+            if (transmit_timer_.elapsed_ms() >= 1000) {
+                //dz debug --- < 24Mbps with no rate limiting
+                bytes_sent_ *= 8;
+                log_debug("ExternalRouter sent %"PRIu64" bits in %u ms", 
+                         bytes_sent_, transmit_timer_.elapsed_ms());
+                transmit_timer_.get_time();
+                bytes_sent_ = 0;
+            }
+
+            delete event;
         }
     }
 
@@ -2156,6 +3135,12 @@ bool ExternalRouter::server_validation         = true;
 bool ExternalRouter::client_validation         = false;
 in_addr_t ExternalRouter::multicast_addr_      = htonl(INADDR_ALLRTRS_GROUP);
 in_addr_t ExternalRouter::network_interface_   = htonl(INADDR_LOOPBACK);
+std::string ExternalRouter::local_socket       = "";
+ExternalRouter::encoding_t ExternalRouter::encoding = ExternalRouter::ENCODING_XML;
+oasys::atomic_t ExternalRouter::current_encoding_(ExternalRouter::ENCODING_XML);
+
+const size_t ExternalRouter::ModuleServer::LocalTransport::MAX_MESSAGE;
+const size_t ExternalRouter::ModuleServer::LocalTransport::MAX_BATCH;
 
 } // namespace dtn
 #endif // XERCES_C_ENABLED && EXTERNAL_DP_ENABLED
@@ -46,12 +46,16 @@
 
 #if defined(XERCES_C_ENABLED) && defined(EXTERNAL_DP_ENABLED)
 
+#include <deque>
+
 #include "router-custom.h"
 #include "BundleRouter.h"
 #include "RouteTable.h"
 #include <reg/Registration.h>
 #include <oasys/serialize/XercesXMLSerialize.h>
 #include <oasys/io/UDPClient.h>
+#include <oasys/thread/Atomic.h>
+#include <oasys/thread/Mutex.h>
 #include <oasys/util/Time.h>
 #include <oasys/util/TokenBucket.h>
 
@@ -63,8 +67,10 @@ namespace dtn {
  * ExternalRouter provides a plug-in interface for third-party
  * routing protocol implementations.
  *
- * Events received from BundleDaemon are serialized into
- * XML messages and UDP multicasted to external bundle router processes.
+ * Events received from BundleDaemon are serialized into XML (or, for
+ * the frequent ones, binary) messages and UDP multicasted to external
+ * bundle router processes,
+ * or sent over a local socket to the ones on the same host.
  * XML actions received on the interface are validated, transformed
  * into events, and placed on the global event queue.
  */
@@ -94,6 +100,33 @@ public:
     /// The network interface to use for communication
     static in_addr_t network_interface_;
 
+    /// Path of a local SOCK_SEQPACKET socket for external routers on
+    /// the same host, used instead of UDP multicast when not empty
+    static std::string local_socket;
+
+    /// Encodings of the messages sent to external routers
+    typedef enum {
+        ENCODING_XML,     ///< one pretty printed document per datagram
+        ENCODING_FRAMED,  ///< compact documents, length prefixed and
+                          ///< batched into datagrams up to MAX_UDP_PACKET
+        ENCODING_BINARY,  ///< framed, with the bundle events, the simple
+                          ///< link events and the bundle reports in the
+                          ///< binary encoding (see ExternalRouter.cc)
+    } encoding_t;
+
+    /// Configured encoding of the messages sent, all are always accepted
+    static encoding_t encoding;
+
+    /// Encoding of the messages sent. Starts as the configured value
+    /// and switches to ENCODING_FRAMED as soon as an external router
+    /// sends a framed datagram, to ENCODING_BINARY as soon as it sends
+    /// a binary message. Safe to call from any thread.
+    static encoding_t current_encoding();
+
+    /// Switch to the given encoding if it is more compact than the one
+    /// in use, return whether it was switched
+    static bool upgrade_encoding(encoding_t enc);
+
     ExternalRouter();
     virtual ~ExternalRouter();
 
@@ -125,6 +158,11 @@ public:
      * Hook to ask the router if the bundle can be deleted.
      */
     bool can_delete_bundle(const BundleRef& bundle);
+
+    /**
+     * Hook to tell the router that the bundle should be deleted.
+     */
+    void delete_bundle(const BundleRef& bundle);
     
     /**
      * Format the given StringBuffer with static routing info.
@@ -171,6 +209,23 @@ public:
 
     virtual void send(rtrmessage::bpa &message, const char* type_str);
 
+    /// Value of since in a bundle query that asks for a full report
+    static const u_int64_t FULL_REPORT = (u_int64_t)-1;
+
+    /**
+     * Report event answering a bundle query of an external router,
+     * with the report_seq the query asks a delta from (FULL_REPORT if
+     * none). The module server posts it in place of the
+     * BundleQueryRequest, which the daemon only answers with a plain
+     * BundleReportEvent, so each report gets its own query's since.
+     */
+    class BundleQueryReportEvent : public BundleReportEvent {
+    public:
+        BundleQueryReportEvent(u_int64_t since) : since_(since) {}
+
+        u_int64_t since_;
+    };
+
 protected:
 #ifdef PENDING_BUNDLES_IS_MAP
     virtual void generate_bundle_report_from_map();
@@ -178,6 +233,41 @@ protected:
     virtual void generate_bundle_report_from_list();
 #endif
 
+    /**
+     * Report only the bundles added, changed or removed after the
+     * given report_seq, which has to be covered by the journal
+     */
+    virtual void generate_bundle_report_delta(u_int64_t since);
+
+    /**
+     * Record that a pending bundle was added, changed or removed
+     */
+    void journal_bundle(bundleid_t bundleid, bool removed);
+
+    /// A bundle change, numbered by report_seq
+    struct JournalEntry {
+        u_int64_t  seq_;
+        bundleid_t bundleid_;
+        bool       removed_;
+    };
+
+    /// Changes since the oldest report a client can still ask a delta
+    /// from, oldest first with consecutive seq_ numbers
+    std::deque<JournalEntry> journal_;
+
+    /// Number of the last change, sent as report_seq with the reports.
+    /// The upper 32 bits hold the boot time, the lower ones count the
+    /// changes, so a client that asks a delta after a restart gets a
+    /// full report.
+    u_int64_t report_seq_;
+
+    /// Most changes kept in the journal, older reports get a full report
+    static const size_t MAX_JOURNAL = 100000;
+
+    /// Encoding in use, an encoding_t written by the ModuleServer
+    /// thread and read by the daemon, timer and sender threads
+    static oasys::atomic_t current_encoding_;
+
 protected:
     class ModuleServer;
     class HelloTimer;
@@ -216,13 +306,36 @@ protected:
 class ExternalRouter::ModuleServer : public oasys::Thread,
                                      public oasys::Logger {
 public:
-    ModuleServer();
+    ModuleServer(ExternalRouter* router);
     virtual ~ModuleServer();
 
     /**
-     * Post a string to process from the ExternalRouter counterpart
+     * A datagram received from the external routers. The buffers are
+     * pooled: the receiver takes them with get_buffer() and the module
+     * server gives them back once their messages are processed.
+     */
+    struct RecvBuffer {
+        RecvBuffer();
+        ~RecvBuffer();
+
+        /// Make room for a datagram of the given size
+        void reserve(size_t len);
+
+        char*  data_;  ///< size_ bytes and a terminator
+        size_t size_;
+        size_t len_;
+    };
+
+    /// Take a buffer from the pool, allocating one if it is empty
+    RecvBuffer* get_buffer();
+
+    /// Give a buffer back to the pool
+    void put_buffer(RecvBuffer* buf);
+
+    /**
+     * Post a datagram to process from the ExternalRouter counterpart
      */
-    virtual void post(std::string* event);
+    virtual void post(RecvBuffer* buf);
 
     /**
      * Post a string to send to the ExternalRouter counterpart
@@ -241,8 +354,19 @@ public:
      */
     void process_action(const char *payload);
 
-    /// Message queue for accepting BundleEvents from ExternalRouter
-    oasys::MsgQueue< std::string * > *eventq_;
+    /**
+     * Process the messages of a datagram, in place in the buffer
+     */
+    void process_datagram(RecvBuffer* buf);
+
+    /**
+     * Parse an incoming action in the binary encoding and place it
+     * on the global event queue
+     */
+    void process_binary_action(const char* msg, size_t len);
+
+    /// Message queue for accepting datagrams from the receiver
+    oasys::MsgQueue< RecvBuffer * > *eventq_;
 
     /// Xerces XML validating parser for incoming messages
     oasys::XercesXMLUnmarshal *parser_;
@@ -255,6 +379,9 @@ protected:
         Receiver(ExternalRouter::ModuleServer* parent);
         virtual ~Receiver();
         virtual void run();
+
+        /// Most datagrams taken by a single receive call
+        static const int RECV_BATCH = 32;
     protected:
         /// Pointer to parent
         ExternalRouter::ModuleServer* parent_;
@@ -263,17 +390,71 @@ protected:
         uint64_t last_recv_seq_ctr_;
     };
 
+    /**
+     * Local transport: listens on ExternalRouter::local_socket, receives
+     * the actions of the connected external routers and sends them
+     * every message. Messages aren't bound by MAX_UDP_PACKET.
+     * Joinable: the module server deletes it after the sender.
+     */
+    class LocalTransport : public oasys::Thread,
+                           public oasys::Logger {
+    public:
+        LocalTransport(ExternalRouter::ModuleServer* parent);
+        virtual ~LocalTransport();
+        virtual void run();
+
+        /// Send a message to all the connected external routers
+        void send(const std::string& event);
+
+        /// Largest message accepted from an external router
+        static const size_t MAX_MESSAGE = 16 * 1024 * 1024;
+
+        /// Largest batch of framed messages sent at once
+        static const size_t MAX_BATCH = 256 * 1024;
+    protected:
+        /// Accept a new external router
+        void accept_client();
+
+        /// Receive a message from an external router, false if it is gone
+        bool receive(int fd);
+
+        /// Pointer to parent
+        ExternalRouter::ModuleServer* parent_;
+
+        /// Listening socket
+        int listen_fd_;
+
+        /// Connected external routers, also used by the sender thread
+        oasys::Mutex      clients_lock_;
+        std::vector<int>  clients_;
+    };
+
     class Sender : public oasys::Thread,
                    public oasys::UDPClient {
     public:
-        Sender();
+        Sender(LocalTransport* local);
         virtual ~Sender();
         virtual void run();
         virtual void post(std::string* event);
     protected:
+        /**
+         * Frame the message and as many of the queued ones as fit in a
+         * datagram, the first that doesn't fit is held for the next.
+         */
+        std::string* batch(std::string* event);
+
         /// Message queue for accepting BundleEvents from ExternalRouter
         oasys::MsgQueue< std::string * > *eventq_;
 
+        /// Message that didn't fit in the last batch
+        std::string* held_;
+
+        /// Local transport to send with, NULL for UDP multicast
+        LocalTransport* local_;
+
+        /// Largest framed batch
+        size_t max_batch_;
+
         /// Rate Limiting TokenBucket
         oasys::TokenBucket bucket_;
 
@@ -282,15 +463,28 @@ protected:
     };
 
 private:
+    /// Whether a message for the given server_eid is for this node
+    bool for_local_node(const std::string& server_eid);
+
+    /// Log the gaps in the sequence counter of the received messages
+    void check_seq_ctr(uint64_t seq_ctr);
+
     Link::link_type_t convert_link_type(rtrmessage::linkTypeType type);
     Bundle::priority_values_t convert_priority(rtrmessage::bundlePriorityType);
 
     ForwardingInfo::action_t 
     convert_fwd_action(rtrmessage::bundleForwardActionType);
 
+    /// The router the actions are for
+    ExternalRouter* router_;
+
     /// Sequence Counter for messages receivevd
     uint64_t last_recv_seq_ctr_;
 
+    /// Pool of free receive buffers, shared with the receiver thread
+    oasys::SpinLock           pool_lock_;
+    std::vector<RecvBuffer*>  pool_;
+
     oasys::Time transmit_timer_;
     uint64_t bytes_sent_;
 
@@ -299,6 +493,9 @@ private:
 
     /// Receiver thread
     Receiver* receiver_;
+
+    /// Local transport thread, replaces the receiver when configured
+    LocalTransport* local_;
 };
 
 /**
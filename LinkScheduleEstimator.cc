@@ -22,13 +22,54 @@
 #include<string.h>
 #include<stdlib.h>
 #include<assert.h>
+#include<unistd.h>
+#include<math.h>
+
+#include <algorithm>
+#include <complex>
+
+#include <oasys/thread/Thread.h>
 
 #include "LinkScheduleEstimator.h"
 
 namespace dtn {
 
-// dist holds a temporary distance array for the dynamic programming algorithm
-unsigned int **dist;
+// fewest lags worth handing to a thread of their own
+#define MIN_LAGS_PER_THREAD 64
+
+// shorter logs have their autocorrelation computed at every lag
+#define FFT_MIN_ENTRIES 64
+// most bins the link-up signal is sampled into
+#define FFT_MAX_BINS 4096
+// how many autocorrelation peaks become period candidates
+#define FFT_CANDIDATES 4
+
+/*
+ *  Computes the autocorrelation for every nthreads-th lag starting at
+ *  first, so that estimate_period can spread the lags across cores.
+ */
+class LinkScheduleEstimator::LagWorker : public oasys::Thread {
+public:
+    LagWorker(LinkScheduleEstimator* estimator, Log* log,
+              std::vector<unsigned int>* autoc,
+              unsigned int first, unsigned int stride)
+        : Thread("LinkScheduleEstimator::LagWorker", CREATE_JOINABLE),
+          estimator_(estimator), log_(log), autoc_(autoc),
+          first_(first), stride_(stride) {}
+
+    void run()
+    {
+        for(unsigned int i=first_;i<log_->size();i+=stride_)
+            (*autoc_)[i]=estimator_->autocorrelation(*log_,i,0);
+    }
+
+private:
+    LinkScheduleEstimator* estimator_;
+    Log* log_;
+    std::vector<unsigned int>* autoc_;
+    unsigned int first_;
+    unsigned int stride_;
+};
 
 LinkScheduleEstimator::LinkScheduleEstimator() 
     : Logger("LinkScheduleEstimator", "/dtn/route/linkstate/estimator")
@@ -54,113 +95,89 @@ LinkScheduleEstimator::entry_dist(Log &a, unsigned int a_index, unsigned int a_o
     else return oasys::min(diff, minduration);
 }
 
-/*
- *  Recursive internal function of log_dist.
- */
-unsigned int 
-LinkScheduleEstimator::log_dist_r(Log &a, unsigned int a_index, unsigned int a_offset,
-                                  Log &b, unsigned int b_index, unsigned int b_offset,
-                                  unsigned int warping_window)
-{
-    unsigned int mindist;
-
-    // can't compute values outside the boundaries.
-    //XXX/jakob - why did we get here anyway?
-    // XXX/demmer this is a bogus compariosn
-    //if(a_index<0 || b_index<0) return MAX_DIST;
-
-    // if we've already computed the dist, return it
-    if(dist[a_index][b_index]<MAX_DIST)
-        return dist[a_index][b_index];
-
-    // no use going outside boundaries
-    else if(a_index==0)
-        mindist=log_dist_r(a,a_index,a_offset,
-                           b,b_index-1,b_offset,
-                           warping_window);
-    // no use going outside boundaries
-    else if(b_index==0)
-        mindist=log_dist_r(a,a_index-1,a_offset,
-                           b,b_index,b_offset,
-                           warping_window);
-    // find the minimum cost neighboring cell
-    else {
-        mindist = oasys::min(oasys::min(log_dist_r(a,a_index-1,a_offset,
-                                                   b,b_index-1,b_offset,warping_window),
-                                        log_dist_r(a,a_index-1,a_offset,
-                                                   b,b_index,b_offset,warping_window)),
-                             log_dist_r(a,a_index,a_offset,
-                                        b,b_index-1,b_offset,warping_window));
-    }
-
-    unsigned int entrydist=entry_dist(a,a_index,a_offset,
-                             b,b_index,b_offset,
-                             warping_window);
-
-    dist[a_index][b_index]=entrydist+mindist;
-
-    return dist[a_index][b_index];
-}
-
 /*
  *  determines the distance between logs a and b using dynamic programming.
  *
+ *  The table is filled row by row, keeping only the previous and the
+ *  current row, and only within a band around the (scaled) diagonal
+ *  that is WARPING_WINDOW of the longer log wide (Sakoe-Chiba). Cells
+ *  outside the band count as MAX_DIST.
  */
 unsigned int 
 LinkScheduleEstimator::log_dist(Log &a, unsigned int a_offset,
                                 Log &b, unsigned int b_offset,
                                 unsigned int warping_window, int print_table)
 {
-    /*
-     * Initialize a cost matrix for the DP algorithm
-     */
-    dist=(unsigned int**)malloc(a.size()*sizeof(unsigned int));
-    for(unsigned int i=0;i<a.size();i++)
+    unsigned int n=a.size();
+    unsigned int m=b.size();
+    if(n==0 || m==0)
+        return (MAX_DIST);
+
+    // the band must be wide enough for consecutive rows to overlap
+    unsigned int band=(unsigned int)(oasys::max(n,m)*WARPING_WINDOW)+1;
+    if(n>1)
+        band=oasys::max(band,(m-1)/(n-1)+1);
+
+    std::vector<unsigned int> rows[2];
+    rows[0].assign(m,MAX_DIST);
+    rows[1].assign(m,MAX_DIST);
+    unsigned int lo[2]={0,0};
+    unsigned int hi[2]={0,0};
+
+    for(unsigned int i=0;i<n;i++)
     {
-        dist[i]=(unsigned int*)malloc(b.size()*sizeof(unsigned int));
+        std::vector<unsigned int> &cur=rows[i%2];
+        std::vector<unsigned int> &prev=rows[(i+1)%2];
 
-        for(unsigned int j=0;j<b.size();j++)
-            dist[i][j]=MAX_DIST;
-    }
+        // forget what this row held two rows ago
+        for(unsigned int j=lo[i%2];j<=hi[i%2];j++)
+            cur[j]=MAX_DIST;
 
-    dist[0][0]=entry_dist(a,0,a_offset,b,0,b_offset,warping_window);
+        unsigned int center=(n>1)?(unsigned int)((unsigned long long)i*(m-1)/(n-1)):0;
+        lo[i%2]=(center>band)?center-band:0;
+        hi[i%2]=oasys::min(m-1,center+band);
 
-    /*
-     * Call inner function for progressively larger parts of the array.
-     * Goes from 0,0 to n,n along the diagonal.
-     */
-    unsigned int d;
-    for(unsigned int i=0;i<oasys::min(a.size(),b.size());i++)
-        d=log_dist_r(a,i,a_offset,b,i,b_offset,warping_window);
-
-    // compute the actual distance with a final call
-    d=log_dist_r(a,a.size()-1,a_offset,
-                 b,b.size()-1,b_offset,
-                 warping_window);
+        for(unsigned int j=lo[i%2];j<=hi[i%2];j++)
+        {
+            unsigned int mindist;
+            if(i==0 && j==0)
+                mindist=0;
+            else if(i==0)
+                mindist=cur[j-1];
+            else if(j==0)
+                mindist=prev[j];
+            else
+                mindist=oasys::min(oasys::min(prev[j-1],prev[j]),cur[j-1]);
 
-    if(print_table)
-    {
-        for(unsigned int i=0;i<a.size();i++)
+            if(mindist>=(MAX_DIST))
+                continue;
+
+            cur[j]=mindist+entry_dist(a,i,a_offset,
+                                      b,j,b_offset,
+                                      warping_window);
+        }
+
+        if(print_table)
         {
-            log_debug("%d\t| ",a[a.size()-i-1].start-a_offset);
-            for(unsigned int j=0;j<b.size();j++)
-            {
-                log_debug("%d\t",dist[a.size()-i-1][j]);
-            }
+            log_debug("%d\t| ",a[i].start-a_offset);
+            for(unsigned int j=lo[i%2];j<=hi[i%2];j++)
+                log_debug("%d\t",cur[j]);
             log_debug("\n");
         }
+    }
+
+    if(print_table)
+    {
         log_debug("---------------------------------------------------\n\t ");
-        for(unsigned int i=0;i<b.size();i++)
+        for(unsigned int i=0;i<m;i++)
             log_debug("%d\t| ",b[i].start-b_offset);
         log_debug("\n\t ");
-        for(unsigned int i=0;i<b.size();i++)
+        for(unsigned int i=0;i<m;i++)
             log_debug("%d\t| ",b[i].duration);
         log_debug("\n\n");
     }
 
-    free(dist);
-
-    return d;
+    return rows[(n-1)%2][m-1];
 }
 
 /*
@@ -185,8 +202,8 @@ LinkScheduleEstimator::autocorrelation(Log &log, unsigned int phase, int print_t
 
     unsigned int d = log_dist(log, log[0].start, // a_offset
                      clone, clone[0].start,
-                     (int)((log[log.size()].start+
-                            log[log.size()].duration)*WARPING_WINDOW),
+                     (int)((log[log.size()-1].start+
+                            log[log.size()-1].duration)*WARPING_WINDOW),
                               print_table);
 
 
@@ -254,31 +271,181 @@ LinkScheduleEstimator::Log* LinkScheduleEstimator::generate_samples(Log &schedul
 }
 
 
+/*
+ * In place iterative radix-2 FFT, x.size() must be a power of two.
+ */
+static void
+fft(std::vector<std::complex<double> > &x, bool inverse)
+{
+    unsigned int n=x.size();
+
+    for(unsigned int i=1,j=0;i<n;i++) {
+        unsigned int bit=n>>1;
+        for(;j&bit;bit>>=1)
+            j^=bit;
+        j^=bit;
+        if(i<j)
+            std::swap(x[i],x[j]);
+    }
+
+    for(unsigned int len=2;len<=n;len<<=1) {
+        double angle=2*M_PI/len*(inverse?1:-1);
+        std::complex<double> wlen(cos(angle),sin(angle));
+        for(unsigned int i=0;i<n;i+=len) {
+            std::complex<double> w(1);
+            for(unsigned int j=0;j<len/2;j++) {
+                std::complex<double> u=x[i+j];
+                std::complex<double> v=x[i+j+len/2]*w;
+                x[i+j]=u+v;
+                x[i+j+len/2]=u-v;
+                w*=wlen;
+            }
+        }
+    }
+
+    if(inverse)
+        for(unsigned int i=0;i<n;i++)
+            x[i]/=n;
+}
+
+/*
+ * Cheap pre-pass for estimate_period: sample the log into a link-up
+ * indicator signal, compute its autocorrelation through the FFT and
+ * turn the highest peaks into the log lags (one and two periods on)
+ * that are worth the DTW autocorrelation. Leaves lags empty if the
+ * signal shows no periodicity.
+ */
+void
+LinkScheduleEstimator::fft_candidate_lags(Log &log, std::vector<unsigned int> &lags)
+{
+    lags.clear();
+
+    unsigned int first=log[0].start;
+    unsigned int span=log[log.size()-1].start+log[log.size()-1].duration-first;
+    unsigned int bin=oasys::max(1U,(span+FFT_MAX_BINS/2-1)/(FFT_MAX_BINS/2));
+    unsigned int nbins=span/bin+1;
+
+    // zero padded to twice the signal, for the linear autocorrelation
+    unsigned int n=1;
+    while(n<2*nbins)
+        n<<=1;
+
+    std::vector<double> signal(nbins,0);
+    for(unsigned int i=0;i<log.size();i++) {
+        unsigned int from=(log[i].start-first)/bin;
+        unsigned int to=oasys::min(nbins-1,
+                                   (log[i].start+log[i].duration-first)/bin);
+        for(unsigned int k=from;k<=to;k++)
+            signal[k]=1;
+    }
+
+    double mean=0;
+    for(unsigned int k=0;k<nbins;k++)
+        mean+=signal[k];
+    mean/=nbins;
+
+    std::vector<std::complex<double> > x(n);
+    for(unsigned int k=0;k<nbins;k++)
+        x[k]=signal[k]-mean;
+
+    fft(x,false);
+    for(unsigned int k=0;k<n;k++)
+        x[k]=std::norm(x[k]);
+    fft(x,true);
+
+    // unbiased autocorrelation peaks, at least two periods in the log
+    std::vector<std::pair<double,unsigned int> > peaks;
+    for(unsigned int k=2;k+1<=nbins/2;k++) {
+        double r=x[k].real()/(nbins-k);
+        if(r>0 &&
+           r>x[k-1].real()/(nbins-k+1) &&
+           r>=x[k+1].real()/(nbins-k-1))
+            peaks.push_back(std::make_pair(r,k));
+    }
+    std::sort(peaks.begin(),peaks.end());
+
+    for(unsigned int p=0;p<peaks.size() && p<FFT_CANDIDATES;p++) {
+        unsigned int period=peaks[peaks.size()-1-p].second*bin;
+        log_debug("fft period candidate %d\n",period);
+
+        for(unsigned int mult=1;mult<=2;mult++) {
+            unsigned int date=first+mult*period;
+            if(date>log[log.size()-1].start)
+                continue;
+
+            unsigned int lag=closest_entry_to_date(log,date);
+            if(lag>=1 && lag<log.size() &&
+               std::find(lags.begin(),lags.end(),lag)==lags.end())
+                lags.push_back(lag);
+        }
+    }
+}
+
 /*
  * Calculate the (inverse) autocorrelation function for the log, then
  * look for the deepest valley.  If there second smallest value is
  * 2*period away, we have found our period.
  *
  * This is a pretty simple heuristic, should be possible to do better.
+ *
+ * Long logs only compute it at the lags suggested by the FFT pre-pass,
+ * and at every lag if it finds none. The lags are independent, so a
+ * full pass spreads them across the online processors.
  */
 unsigned int 
 LinkScheduleEstimator::estimate_period(Log &log)
 {
-    int* autoc=(int*)malloc(log.size()*sizeof(int));
-    for(unsigned int i=1;i<log.size();i++) {
-        autoc[i]=autocorrelation(log,i,0);
+    std::vector<unsigned int> autoc(log.size(),MAX_DIST);
+
+    std::vector<unsigned int> lags;
+    if(log.size()>=FFT_MIN_ENTRIES)
+        fft_candidate_lags(log,lags);
+
+    long ncpus=sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int nthreads=(unsigned int)oasys::max(1L,ncpus);
+    nthreads=oasys::min(nthreads,
+                        (unsigned int)(log.size()/MIN_LAGS_PER_THREAD));
+
+    if(!lags.empty()) {
+        for(unsigned int i=0;i<lags.size();i++)
+            autoc[lags[i]]=autocorrelation(log,lags[i],0);
+    } else if(nthreads<=1) {
+        for(unsigned int i=1;i<log.size();i++) {
+            autoc[i]=autocorrelation(log,i,0);
+        }
+    } else {
+        std::vector<LagWorker*> workers;
+        for(unsigned int t=0;t<nthreads;t++) {
+            workers.push_back(new LagWorker(this,&log,&autoc,1+t,nthreads));
+            workers.back()->start();
+        }
+        for(unsigned int t=0;t<nthreads;t++) {
+            workers[t]->join();
+            delete workers[t];
+        }
     }
 
-    // first find the best autocorrelation period
-    unsigned int candidate=1;
-    for(unsigned int i=1;i<log.size();i++)
-        if(autoc[i]<autoc[candidate])
-            candidate=i;
+    // only the lags that were computed can be candidates, the others
+    // are still at MAX_DIST
+    if(lags.empty()) {
+        for(unsigned int i=1;i<log.size();i++)
+            lags.push_back(i);
+    }
 
-    unsigned int candidate2=1;
-    for(unsigned int i=1;i<log.size();i++)
-        if(i!=candidate && autoc[i]<autoc[candidate2])
-            candidate2=i;
+    // first find the best autocorrelation period
+    unsigned int candidate=0;
+    for(unsigned int i=0;i<lags.size();i++)
+        if(candidate==0 || autoc[lags[i]]<autoc[candidate])
+            candidate=lags[i];
+
+    unsigned int candidate2=0;
+    for(unsigned int i=0;i<lags.size();i++)
+        if(lags[i]!=candidate &&
+           (candidate2==0 || autoc[lags[i]]<autoc[candidate2]))
+            candidate2=lags[i];
+
+    if(candidate==0 || candidate2==0)
+        return 0;
 
 
     double should_be_2=log[candidate2].start/(double)log[candidate].start;
@@ -291,14 +458,24 @@ LinkScheduleEstimator::estimate_period(Log &log)
 
 /**
  * return the index of the closest log entry at or before the given date.
+ * The log is sorted by start date, so the first entry after the date is
+ * found by binary search.
  */
 unsigned int 
 LinkScheduleEstimator::seek_to_before_date(Log &log, unsigned int date)
 {
-    for( unsigned int i=0 ; i < log.size() ; i++ )
-        if( log[i].start > date )
-            return (unsigned int)oasys::max(0,(int)i-1);
-    return 0;
+    unsigned int lo=0, hi=log.size();
+    while(lo<hi) {
+        unsigned int mid=lo+(hi-lo)/2;
+        if(log[mid].start > date)
+            hi=mid;
+        else
+            lo=mid+1;
+    }
+
+    if(lo==log.size())
+        return 0;
+    return (unsigned int)oasys::max(0,(int)lo-1);
 }
 
 /**
@@ -405,10 +582,13 @@ LinkScheduleEstimator::extract_schedule(Log &log, unsigned int period_estimate)
         else delete pattern;
     }
 
+    if(!best_pattern)
+        return 0;
+
     log_debug("And the best pattern is (%d): \n",best_pattern_badness);
     print_log(*best_pattern, 1);
 
-    return new Log(*best_pattern);
+    return best_pattern;
 
 /*
       // This part computes an average schedule based on all the
@@ -485,6 +665,10 @@ LinkScheduleEstimator::refine_period(LinkScheduleEstimator::Log &log,
         count2+=count;
     }
 
+    // a single period in the log, nothing to refine
+    if(count2<=0)
+        return period_estimate;
+
     return sum/count2;
 }
 
@@ -497,15 +681,27 @@ LinkScheduleEstimator::find_schedule(LinkScheduleEstimator::Log &log)
     // find a first estimate of the period. If there is a period, this
     // will return a non-zero value.
 
+    if(log.size()<2)
+        return 0;
+
     unsigned int period = estimate_period(log);
 
-    if(period) {
+    // the log has to span at least one period to be fit
+    if(period && period<=log[log.size()-1].start) {
         // now try to fit this period to the full log as closely as possible
         period = refine_period(log, period);
         // and then compute the best schedule for the given log and period
-        return extract_schedule(log, period);
+        if(period && period<=log[log.size()-1].start)
+            return extract_schedule(log, period);
     }
-    else return 0;
+    return 0;
+}
+
+LinkScheduleEstimator::Log* 
+LinkScheduleEstimator::find_schedule(LinkScheduleEstimator::Log* log)
+{
+    LinkScheduleEstimator estimator;
+    return estimator.find_schedule(*log);
 }
 
 
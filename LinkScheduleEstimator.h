@@ -14,6 +14,9 @@
  *    limitations under the License.
  */
 
+#ifndef _LINK_SCHEDULE_ESTIMATOR_H_
+#define _LINK_SCHEDULE_ESTIMATOR_H_
+
 #include <vector>
 #include <oasys/util/IntUtils.h>
 #include <oasys/debug/Log.h>
@@ -56,15 +59,12 @@ public:
 
     LinkScheduleEstimator();
 private:
+    class LagWorker;
+
     unsigned int entry_dist(Log &a, unsigned int a_index, unsigned int a_offset,
                             Log &b, unsigned int b_index, unsigned int b_offset,
                             unsigned int warping_window);
 
-    unsigned int log_dist_r(Log &a, unsigned int a_index, unsigned int a_offset,
-                            Log &b, unsigned int b_index, unsigned int b_offset,
-                            unsigned int warping_window);
-    
-       
     unsigned int log_dist(Log &a, unsigned int a_offset,
                  Log &b, unsigned int b_offset,
                  unsigned int warping_window, int print_table);
@@ -77,6 +77,7 @@ private:
                           unsigned int start_jitter,
                           double duration_jitter);
     
+    void fft_candidate_lags(Log &log, std::vector<unsigned int> &lags);
     unsigned int estimate_period(Log &log);       
     unsigned int seek_to_before_date(Log &log, unsigned int date);                
     unsigned int closest_entry_to_date(Log &log, unsigned int date);
@@ -94,3 +95,5 @@ private:
 
 
 }
+
+#endif /* _LINK_SCHEDULE_ESTIMATOR_H_ */
@@ -22,6 +22,7 @@
 #include <oasys/debug/Formatter.h>
 #include <oasys/debug/Logger.h>
 #include <oasys/util/StringBuffer.h>
+#include <oasys/util/StringUtils.h>
 #include <oasys/util/Time.h>
 
 namespace dtn {
@@ -30,6 +31,12 @@ class Bundle;
 
 /**
  * Data structure to represent a multigraph.
+ *
+ * Nodes are indexed by id and numbered densely from zero, in the
+ * order of the nodes() vector. Between changes to its structure the
+ * graph can be frozen into a compressed sparse row (CSR) copy of its
+ * adjacency, which the shortest path searches then walk instead of
+ * the per-node edge vectors.
  */
 template <typename _NodeInfo, typename _EdgeInfo>
 class MultiGraph : public oasys::Formatter, public oasys::Logger {
@@ -54,7 +61,8 @@ public:
     /// Find a node with the given id
     Node* find_node(const std::string& id) const;
     
-    /// Delete a node and all its edges
+    /// Delete a node and all its edges. The last node takes its place
+    /// (and its index) in the nodes array.
     bool del_node(const std::string& id);
     
     /// Add an edge
@@ -66,6 +74,14 @@ public:
     /// Remove the specified edge from the given node, deleting the
     /// Edge object
     bool del_edge(Node* node, Edge* edge);
+
+    /// Take a CSR snapshot of the edges for the following searches.
+    /// Adding or deleting nodes or edges drops it, edge info changes
+    /// don't.
+    void freeze();
+
+    /// Whether the searches use the CSR snapshot
+    bool frozen() const { return frozen_; }
     
     /// Find the shortest path between two nodes by running Dijkstra's
     /// algorithm, filling in the edge vector with the best path
@@ -120,14 +136,19 @@ public:
     public:
         /// Constructor
         Node(const std::string& id, const _NodeInfo info)
-            : id_(id), info_(info) {}
+            : id_(id), info_(info), index_(0) {}
 
         ~Node();
 
+        /// Remove the edge, use MultiGraph::del_edge so that a frozen
+        /// graph drops its snapshot
         bool del_edge(Edge* edge);
         
         const std::string& id() const { return id_; }
 
+        /// Dense index of the node in the graph's nodes array
+        u_int32_t index() const { return index_; }
+
         const _NodeInfo& info() const { return info_; }
         _NodeInfo& mutable_info() { return info_; }
 
@@ -142,6 +163,7 @@ public:
         
         std::string id_;
         _NodeInfo   info_;
+        u_int32_t   index_;
         
         EdgeVector  out_edges_;
         EdgeVector  in_edges_;
@@ -231,9 +253,36 @@ protected:
     /// Helper function to follow the prev_ links that result from a
     /// Dijkstra search from a to b and build an EdgeVector
     bool get_reverse_path(const Node* a, const Node* b, EdgeVector* path);
+
+    /// Dijkstra search from a to b over the CSR snapshot
+    void csr_shortest_path(const Node* a, const Node* b, EdgeVector* path,
+                           WeightFn* weight_fn, const SearchInfo& info);
+
+    /// Log the hops of a path found from a to b
+    void log_path(const Node* a, const Node* b, const EdgeVector* path);
+
+    /// Drop the CSR snapshot after a change to the graph
+    void thaw() { frozen_ = false; }
     
     /// The vector of all nodes
     NodeVector nodes_;
+
+    /// Index of the nodes by id
+    oasys::StringHashMap<Node*> node_index_;
+
+    /// @{ CSR snapshot: the out edges of node i, and the indexes of
+    /// their destinations, are in [csr_offsets_[i], csr_offsets_[i+1])
+    bool                   frozen_;
+    std::vector<u_int32_t> csr_offsets_;
+    std::vector<u_int32_t> csr_dests_;
+    std::vector<Edge*>     csr_edges_;
+    /// @}
+
+    /// @{ Dijkstra state of the CSR search, indexed by node
+    std::vector<u_int32_t> csr_distance_;
+    std::vector<Edge*>     csr_prev_;
+    std::vector<bool>      csr_done_;
+    /// @}
 };
 
 } // namespace dtn
@@ -14,6 +14,8 @@
  *    limitations under the License.
  */
 
+#include <functional>
+#include <queue>
 #include "MultiGraph.h"
 #include <oasys/util/StringAppender.h>
 #include <oasys/util/UpdatablePriorityQueue.h>
@@ -24,7 +26,8 @@ namespace dtn {
 template <typename _NodeInfo, typename _EdgeInfo>
 inline MultiGraph<_NodeInfo,_EdgeInfo>
 ::MultiGraph()
-    : Logger("MultiGraph", "/dtn/route/graph")
+    : Logger("MultiGraph", "/dtn/route/graph"),
+      frozen_(false)
 {
 }
 
@@ -42,7 +45,15 @@ MultiGraph<_NodeInfo,_EdgeInfo>
 ::add_node(const std::string& id, const _NodeInfo& info)
 {
     Node* n = new Node(id, info);
+    n->index_ = this->nodes_.size();
     this->nodes_.push_back(n);
+
+    // like the linear search did, find_node returns the first one
+    if (! this->node_index_.insert(std::make_pair(id, n)).second) {
+        log_warn("add_node: duplicate node id %s", id.c_str());
+    }
+
+    thaw();
     return n;
 }
 
@@ -52,13 +63,12 @@ inline class MultiGraph<_NodeInfo,_EdgeInfo>::Node*
 MultiGraph<_NodeInfo,_EdgeInfo>
 ::find_node(const std::string& id) const
 {
-    typename NodeVector::const_iterator iter;
-    for (iter = this->nodes_.begin(); iter != this->nodes_.end(); ++iter) {
-        if ((*iter)->id_ == id) {
-            return *iter;
-        }
+    typename oasys::StringHashMap<Node*>::const_iterator iter =
+        this->node_index_.find(id);
+    if (iter == this->node_index_.end()) {
+        return NULL;
     }
-    return NULL;
+    return iter->second;
 }
     
 //----------------------------------------------------------------------
@@ -67,16 +77,25 @@ inline bool
 MultiGraph<_NodeInfo,_EdgeInfo>
 ::del_node(const std::string& id)
 {
-    class NodeVector::iterator iter;
-    for (iter = this->nodes_.begin(); iter != this->nodes_.end(); ++iter) {
-        if ((*iter)->id_ == id) {
-            delete (*iter);
-            this->nodes_.erase(iter);
-            return true;
-        }
+    typename oasys::StringHashMap<Node*>::iterator iter =
+        this->node_index_.find(id);
+    if (iter == this->node_index_.end()) {
+        return false;
     }
 
-    return false;
+    Node* n = iter->second;
+    this->node_index_.erase(iter);
+
+    // move the last node into the hole to keep the indexes dense
+    u_int32_t index = n->index_;
+    ASSERT(this->nodes_[index] == n);
+    this->nodes_[index] = this->nodes_.back();
+    this->nodes_[index]->index_ = index;
+    this->nodes_.pop_back();
+
+    delete n;
+    thaw();
+    return true;
 }
     
 //----------------------------------------------------------------------
@@ -91,6 +110,8 @@ MultiGraph<_NodeInfo,_EdgeInfo>
     }
 
     this->nodes_.clear();
+    this->node_index_.clear();
+    thaw();
 }
     
 //----------------------------------------------------------------------
@@ -102,6 +123,7 @@ MultiGraph<_NodeInfo,_EdgeInfo>
     Edge* e = new Edge(a, b, info);
     a->out_edges_.push_back(e);
     b->in_edges_.push_back(e);
+    thaw();
     return e;
 }
 
@@ -129,9 +151,42 @@ inline bool
 MultiGraph<_NodeInfo,_EdgeInfo>
 ::del_edge(Node* node, Edge* edge)
 {
+    thaw();
     return node->del_edge(edge);
 }
 
+//----------------------------------------------------------------------
+template <typename _NodeInfo, typename _EdgeInfo>
+inline void
+MultiGraph<_NodeInfo,_EdgeInfo>
+::freeze()
+{
+    if (frozen_) {
+        return;
+    }
+
+    size_t num_nodes = this->nodes_.size();
+    csr_offsets_.resize(num_nodes + 1);
+    csr_dests_.clear();
+    csr_edges_.clear();
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const Node* n = this->nodes_[i];
+        ASSERT(n->index_ == i);
+
+        csr_offsets_[i] = csr_edges_.size();
+        for (typename EdgeVector::const_iterator ei = n->out_edges_.begin();
+             ei != n->out_edges_.end(); ++ei)
+        {
+            csr_dests_.push_back((*ei)->dest()->index_);
+            csr_edges_.push_back(*ei);
+        }
+    }
+    csr_offsets_[num_nodes] = csr_edges_.size();
+
+    frozen_ = true;
+}
+
 
 //----------------------------------------------------------------------
 template <typename _NodeInfo, typename _EdgeInfo>
@@ -229,6 +284,11 @@ MultiGraph<_NodeInfo,_EdgeInfo>
 
     // cons up the search info
     SearchInfo info(bundle);
+
+    if (frozen_) {
+        csr_shortest_path(a, b, path, weight_fn, info);
+        return;
+    }
     
     // first clear the existing distances
     for (typename NodeVector::iterator i = this->nodes_.begin();
@@ -335,7 +395,94 @@ MultiGraph<_NodeInfo,_EdgeInfo>
     }
 
     get_reverse_path(a, b, path);
+    log_path(a, b, path);
+}
+
+//----------------------------------------------------------------------
+template <typename _NodeInfo, typename _EdgeInfo>
+inline void
+MultiGraph<_NodeInfo,_EdgeInfo>
+::csr_shortest_path(const Node* a, const Node* b, EdgeVector* path,
+                    WeightFn* weight_fn, const SearchInfo& info)
+{
+    ASSERT(frozen_);
+
+    size_t num_nodes = this->nodes_.size();
+    csr_distance_.assign(num_nodes, 0xffffffff);
+    csr_prev_.assign(num_nodes, NULL);
+    csr_done_.assign(num_nodes, false);
+
+    // (distance, node) pairs, a node is pushed again when its distance
+    // drops and the stale entries are skipped when popped
+    typedef std::pair<u_int32_t, u_int32_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry> > q;
+
+    u_int32_t src = a->index_;
+    u_int32_t dst = b->index_;
     
+    csr_distance_[src] = 0;
+    q.push(QueueEntry(0, src));
+    while (!q.empty()) {
+        u_int32_t cur = q.top().second;
+        q.pop();
+
+        if (csr_done_[cur]) {
+            continue;
+        }
+        csr_done_[cur] = true;
+
+        // safe to bail once we reach the destination
+        if (cur == dst) {
+            break;
+        }
+
+        u_int32_t cur_distance = csr_distance_[cur];
+        for (u_int32_t i = csr_offsets_[cur]; i < csr_offsets_[cur + 1]; ++i)
+        {
+            u_int32_t peer = csr_dests_[i];
+            if (csr_done_[peer]) {
+                continue;
+            }
+
+            u_int32_t weight = (*weight_fn)(info, csr_edges_[i]);
+            if (weight != 0xffffffff &&
+                csr_distance_[peer] > cur_distance + weight)
+            {
+                csr_distance_[peer] = cur_distance + weight;
+                csr_prev_[peer]     = csr_edges_[i];
+                q.push(QueueEntry(csr_distance_[peer], peer));
+            }
+        }
+    }
+    
+    if (csr_distance_[dst] == 0xffffffff) {
+        log_debug("no path found from %s -> %s",
+                  a->id_.c_str(), b->id_.c_str());
+        return; // no path
+    }
+
+    // follow the previous edges back, leaving the distances in the
+    // path's nodes for EdgeVector::debug_format
+    u_int32_t cur = dst;
+    while (cur != src) {
+        Edge* edge = csr_prev_[cur];
+        ASSERT(edge != NULL && edge->dest()->index_ == cur);
+
+        edge->dest()->distance_ = csr_distance_[cur];
+        path->push_back(edge);
+        cur = edge->source()->index_;
+    }
+
+    log_path(a, b, path);
+}
+
+//----------------------------------------------------------------------
+template <typename _NodeInfo, typename _EdgeInfo>
+inline void
+MultiGraph<_NodeInfo,_EdgeInfo>
+::log_path(const Node* a, const Node* b, const EdgeVector* path)
+{
     size_t len = path->size();
     log_debug("found path of length %zu from %s -> %s",
               len, a->id_.c_str(), b->id_.c_str());
@@ -36,16 +36,21 @@ ProphetBundleList::~ProphetBundleList()
 void
 ProphetBundleList::add(const BundleRef& b)
 {
-    ProphetBundle* pb = new ProphetBundle(b);
-    if (!list_.add(pb))
-        delete pb;
+    add(new ProphetBundle(b));
 }
 
 void
 ProphetBundleList::add(const prophet::Bundle* b)
 {
+    // the Repository may evict other bundles while adding this one,
+    // they leave the index through del()
     if (list_.add(b))
+    {
+        // keep the first one added on a duplicate key, as the list
+        // scan used to find
+        index_.insert(Index::value_type(key(b),b));
         return;
+    }
 
     prophet::Bundle* pb = const_cast<prophet::Bundle*>(b);
     delete pb;
@@ -54,20 +59,17 @@ ProphetBundleList::add(const prophet::Bundle* b)
 void
 ProphetBundleList::del(const BundleRef& b)
 {
-    const_iterator i;
-    if (find(b->dest().str(),
-             b->creation_ts().seconds_,
-             b->creation_ts().seqno_, i))
-    {
-        prophet::Bundle* bundle = const_cast<prophet::Bundle*>(*i);
-        list_.del(*i);
-        delete bundle;
-    }
+    const prophet::Bundle* pb = find(b->dest().str(),
+                                     b->creation_ts().seconds_,
+                                     b->creation_ts().seqno_);
+    if (pb != NULL)
+        del(pb);
 }
 
 void
 ProphetBundleList::del(const prophet::Bundle* b)
 {
+    index_del(b);
     prophet::Bundle* bundle = const_cast<prophet::Bundle*>(b);
     list_.del(bundle);
     delete bundle;
@@ -78,9 +80,9 @@ ProphetBundleList::find(const std::string& dst,
                         u_int creation_ts,
                         u_int seqno) const
 {
-    const_iterator i;
-    if (find(dst,creation_ts,seqno,i))
-        return *i;
+    Index::const_iterator i = index_.find(Key(dst,creation_ts,seqno));
+    if (i != index_.end())
+        return i->second;
     return NULL;
 }
 
@@ -89,11 +91,11 @@ ProphetBundleList::find_ref(const prophet::Bundle* b) const
 {
     if (b != NULL)
     {
-        const_iterator i;
-        if (find(b->destination_id(),
-                 b->creation_ts(),
-                 b->sequence_num(),i))
-            return dynamic_cast<const ProphetBundle*>(*i)->ref();
+        const prophet::Bundle* pb = find(b->destination_id(),
+                                         b->creation_ts(),
+                                         b->sequence_num());
+        if (pb != NULL)
+            return dynamic_cast<const ProphetBundle*>(pb)->ref();
     }
     return NULL_BUNDLE;
 }
@@ -101,6 +103,7 @@ ProphetBundleList::find_ref(const prophet::Bundle* b) const
 void
 ProphetBundleList::clear()
 {
+    index_.clear();
     while (!list_.empty())
     {
         prophet::Bundle* b = const_cast<prophet::Bundle*>(
@@ -111,24 +114,13 @@ ProphetBundleList::clear()
     }
 }
 
-bool
-ProphetBundleList::find(const std::string& dst,
-        u_int creation_ts, u_int seqno, const_iterator& i) const
+void
+ProphetBundleList::index_del(const prophet::Bundle* b)
 {
-    i = list_.get_bundles().begin();
-    while (i != list_.get_bundles().end())
-    {
-        if ((*i)->creation_ts() == creation_ts &&
-            (*i)->sequence_num() == seqno &&
-            (*i)->destination_id() == dst) break;
-        i++;
-    }
-
-    if (i == list_.get_bundles().end()) return false;
-
-    return ((*i)->creation_ts() == creation_ts &&
-            (*i)->sequence_num() == seqno &&
-            (*i)->destination_id() == dst);
+    Index::iterator i = index_.find(key(b));
+    // another bundle may own a duplicate key
+    if (i != index_.end() && i->second == b)
+        index_.erase(i);
 }
 
 }; // namespace dtn
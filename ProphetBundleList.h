@@ -17,6 +17,7 @@
 #ifndef _PROPHET_BUNDLE_LIST_H_
 #define _PROPHET_BUNDLE_LIST_H_
 
+#include <map>
 #include "prophet/BundleList.h"
 #include "prophet/Repository.h"
 #include "prophet/BundleCore.h"
@@ -97,14 +98,40 @@ public:
     ///@}
 
 protected:
-    typedef prophet::BundleList::const_iterator const_iterator;
     /**
-     * Utility function for internal find
+     * Primary key of a bundle in the index: the integers are compared
+     * first, so the destination string is compared only on a tie
      */
-    bool find(const std::string& dst, u_int creation_ts,
-            u_int seqno, const_iterator& i) const;
+    struct Key {
+        Key(const std::string& dst, u_int creation_ts, u_int seqno)
+            : creation_ts_(creation_ts), seqno_(seqno), dst_(dst) {}
+
+        bool operator<(const Key& other) const
+        {
+            if (creation_ts_ != other.creation_ts_)
+                return creation_ts_ < other.creation_ts_;
+            if (seqno_ != other.seqno_)
+                return seqno_ < other.seqno_;
+            return dst_ < other.dst_;
+        }
+
+        u_int creation_ts_;
+        u_int seqno_;
+        std::string dst_;
+    };
+    typedef std::map<Key,const prophet::Bundle*> Index;
+
+    /**
+     * Utility functions to keep the index consistent with list_
+     */
+    static Key key(const prophet::Bundle* b)
+    {
+        return Key(b->destination_id(), b->creation_ts(), b->sequence_num());
+    }
+    void index_del(const prophet::Bundle* b);
 
     prophet::Repository list_; ///< collection of ProphetBundle's
+    Index index_; ///< lookup of list_'s members by primary key
     static BundleRef NULL_BUNDLE; ///< pointer to NULL
 
 }; // class ProphetBundleList
@@ -50,7 +50,7 @@ ProphetNodeList::load(const prophet::Node* n)
     // create and insert new object
     ProphetNode* a = new ProphetNode(*n);
     // internally and in ProphetStorage
-    list_.insert(i,a);
+    insert(i,a);
 }
 
 void
@@ -66,16 +66,18 @@ ProphetNodeList::update(const prophet::Node* n)
         // create and insert new object
         ProphetNode* a = new ProphetNode(*n);
         // internally and in ProphetStorage
-        list_.insert(i,a);
+        insert(i,a);
         ProphetStore::instance()->add(a);
     }
     else
     {
         log_debug_p("/dtn/route/nodelist",
                 "update existing node for %s",n->dest_id());
-        // update existing
+        // update existing, with the timestamp the predictability is
+        // aged from, so that the store never holds a predictability
+        // with the timestamp of an older one
         ProphetNode* a = static_cast<ProphetNode*>(*i);
-        a->set_pvalue( n->p_value() );
+        static_cast<prophet::Node&>(*a) = *n;
         ProphetStore::instance()->update(a);
     }
 }
@@ -89,6 +91,7 @@ ProphetNodeList::del(const prophet::Node* n)
     {
         // remove from list and from ProphetStorage
         ProphetNode* a = static_cast<ProphetNode*>(*i);
+        index_.erase(a->dest_id());
         list_.erase(i);
         ProphetStore::instance()->del(a);
         delete a;
@@ -119,6 +122,7 @@ ProphetNodeList::clone(prophet::Table* nodes,
 void
 ProphetNodeList::clear()
 {
+    index_.clear();
     while (!list_.empty())
     {
         delete list_.front();
@@ -129,10 +133,22 @@ ProphetNodeList::clear()
 bool
 ProphetNodeList::find(const std::string& dest_id, iterator& i)
 {
-    i = list_.begin();
-    while (i != list_.end() && (*i)->dest_id() < dest_id)
-        i++;
-    return (i != list_.end() && (*i)->dest_id() == dest_id);
+    // the index has the same order as list_, so the first entry not
+    // less than dest_id is also the insertion point in list_
+    Index::iterator j = index_.lower_bound(dest_id);
+    if (j == index_.end())
+    {
+        i = list_.end();
+        return false;
+    }
+    i = j->second;
+    return (j->first == dest_id);
+}
+
+void
+ProphetNodeList::insert(iterator i, prophet::Node* n)
+{
+    index_[n->dest_id()] = list_.insert(i,n);
 }
 
 }; // namespace dtn
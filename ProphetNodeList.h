@@ -17,6 +17,7 @@
 #ifndef _PROPHET_NODE_LIST_H_
 #define _PROPHET_NODE_LIST_H_
 
+#include <map>
 #include "prophet/Node.h"
 #include "prophet/Table.h"
 #include "storage/ProphetStore.h"
@@ -48,7 +49,8 @@ public:
     void load(const prophet::Node* n);
 
     /**
-     * Update (or add new) node in permanent store
+     * Update (or add new) node in permanent store, with the timestamp
+     * its predictability is aged from
      */
     void update(const prophet::Node* n);
 
@@ -83,12 +85,21 @@ protected:
     typedef List::iterator iterator;
     typedef List::const_iterator const_iterator;
 
+    typedef std::map<std::string,iterator> Index;
+
     /**
-     * Given primary key, locate node in list
+     * Given primary key, locate node in list; if not found, i is the
+     * position where the node has to be inserted to keep list_ sorted
      */
     bool find(const std::string& dest_id, iterator& i);
 
-    List list_; ///< collection of prophet::Node's
+    /**
+     * Insert node into list_ at i and into the index
+     */
+    void insert(iterator i, prophet::Node* n);
+
+    List list_; ///< collection of prophet::Node's, sorted by dest_id
+    Index index_; ///< lookup of list_'s members by dest_id
 
 }; // class ProphetNodeList
 
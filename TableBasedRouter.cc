@@ -291,19 +291,17 @@ TableBasedRouter::handle_bundle_received(BundleReceivedEvent* event)
 void
 TableBasedRouter::remove_from_deferred(const BundleRef& bundle, int actions)
 {
-    ContactManager* cm = BundleDaemon::instance()->contactmgr();
-    oasys::ScopeLock l(cm->lock(), "TableBasedRouter::remove_from_deferred");
+    // only the links whose deferred list holds the bundle, so there's
+    // no need to take the contact manager lock and scan every link
+    std::vector<LinkRef> links;
+    deferred_index_.links(bundle->bundleid(), &links);
 
-    const LinkSet* links = cm->links();
-    LinkSet::const_iterator iter;
-    for (iter = links->begin(); iter != links->end(); ++iter) {
+    std::vector<LinkRef>::const_iterator iter;
+    for (iter = links.begin(); iter != links.end(); ++iter) {
         const LinkRef& link = *iter;
 
-        // a bundle might be deleted immediately after being loaded
-        // from storage, meaning that remove_from_deferred is called
-        // before the deferred list is created (since the link isn't
-        // fully set up yet). so just skip the link if there's no
-        // router info, and therefore no deferred list
+        // the link might have lost its router info in the meantime
+        // (e.g. it has been deleted), and therefore its deferred list
         if (link->router_info() == NULL) {
             continue;
         }
@@ -631,7 +629,7 @@ TableBasedRouter::handle_link_created(LinkCreatedEvent* event)
     ASSERT(link != NULL);
     ASSERT(!link->isdeleted());
 
-    link->set_router_info(new DeferredList(logpath(), link));
+    link->set_router_info(new DeferredList(logpath(), link, &deferred_index_));
                           
     // true=skip changed routes because we are about to call it
     add_nexthop_route(link, true); 
@@ -647,6 +645,10 @@ TableBasedRouter::handle_link_deleted(LinkDeletedEvent* event)
 
     route_table_->del_entries_for_nexthop(link);
 
+    // the index holds references to the link, drop them with the
+    // link's deferred list
+    deferred_index_.del_link(link);
+
     RerouteTimerMap::iterator iter = reroute_timers_.find(link->name_str());
     if (iter != reroute_timers_.end()) {
         log_debug("link %s deleted, cancelling reroute timer", link->name());
@@ -1022,11 +1024,14 @@ TableBasedRouter::recompute_routes()
 
 //----------------------------------------------------------------------
 TableBasedRouter::DeferredList::DeferredList(const char* logpath,
-                                             const LinkRef& link)
+                                             const LinkRef& link,
+                                             DeferredIndex* index)
     : RouterInfo(),
       Logger("%s/deferred/%s", logpath, link->name()),
       list_(link->name_str() + ":deferred"),
-      count_(0)
+      count_(0),
+      link_(link.object()),
+      index_(index)
 {
 }
 
@@ -1078,6 +1083,7 @@ TableBasedRouter::DeferredList::add(const BundleRef&      bundle,
     count_++;
     info_.insert(InfoMap::value_type(bundle->bundleid(), info));
     list_.push_back(bundle);
+    index_->add(bundle->bundleid(), LinkRef(link_, "DeferredList::add"));
 
     return true;
 }
@@ -1090,6 +1096,7 @@ TableBasedRouter::DeferredList::del(const BundleRef& bundle)
  
     size_t n = info_.erase(bundle->bundleid());
     ASSERT(n == 1);
+    index_->del(bundle->bundleid(), LinkRef(link_, "DeferredList::del"));
     
     if (! list_.erase(bundle)) {
         return false;
@@ -1104,6 +1111,76 @@ TableBasedRouter::DeferredList::del(const BundleRef& bundle)
     return true;
 }
 
+//----------------------------------------------------------------------
+void
+TableBasedRouter::DeferredIndex::add(bundleid_t id, const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::add");
+    links_[id].push_back(link);
+}
+
+//----------------------------------------------------------------------
+void
+TableBasedRouter::DeferredIndex::del(bundleid_t id, const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::del");
+
+    LinkMap::iterator iter = links_.find(id);
+    if (iter == links_.end()) {
+        return;
+    }
+
+    std::vector<LinkRef>& v = iter->second;
+    std::vector<LinkRef>::iterator link_iter;
+    for (link_iter = v.begin(); link_iter != v.end(); ++link_iter) {
+        if (link_iter->object() == link.object()) {
+            v.erase(link_iter);
+            break;
+        }
+    }
+
+    if (v.empty()) {
+        links_.erase(iter);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+TableBasedRouter::DeferredIndex::del_link(const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::del_link");
+
+    LinkMap::iterator iter = links_.begin();
+    while (iter != links_.end()) {
+        std::vector<LinkRef>& v = iter->second;
+        std::vector<LinkRef>::iterator link_iter;
+        for (link_iter = v.begin(); link_iter != v.end(); ++link_iter) {
+            if (link_iter->object() == link.object()) {
+                v.erase(link_iter);
+                break;
+            }
+        }
+
+        if (v.empty()) {
+            links_.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+void
+TableBasedRouter::DeferredIndex::links(bundleid_t id, std::vector<LinkRef>* links)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::links");
+
+    LinkMap::const_iterator iter = links_.find(id);
+    if (iter != links_.end()) {
+        *links = iter->second;
+    }
+}
+
 //----------------------------------------------------------------------
 TableBasedRouter::DeferredList*
 TableBasedRouter::deferred_list(const LinkRef& link)
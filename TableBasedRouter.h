@@ -35,6 +35,9 @@
 #ifndef _TABLE_BASED_ROUTER_H_
 #define _TABLE_BASED_ROUTER_H_
 
+#include <map>
+#include <vector>
+#include <oasys/thread/SpinLock.h>
 #include <oasys/util/StringUtils.h>
 
 #include "BundleRouter.h"
@@ -249,11 +252,39 @@ protected:
     typedef oasys::StringMap<RerouteTimer*> RerouteTimerMap;
     RerouteTimerMap reroute_timers_;
 
+    /// Reverse index from a bundle to the links whose deferred list
+    /// holds it, kept up to date by DeferredList::add() and del() so
+    /// that remove_from_deferred() doesn't have to scan every link
+    class DeferredIndex {
+    public:
+        /// Record that the link's deferred list holds the bundle
+        void add(bundleid_t id, const LinkRef& link);
+
+        /// Forget that the link's deferred list holds the bundle
+        void del(bundleid_t id, const LinkRef& link);
+
+        /// Forget all the bundles of the link's deferred list, called
+        /// when the link is deleted so its reference is released
+        void del_link(const LinkRef& link);
+
+        /// Fill in the links whose deferred list holds the bundle
+        void links(bundleid_t id, std::vector<LinkRef>* links);
+
+    protected:
+        typedef std::map<bundleid_t, std::vector<LinkRef> > LinkMap;
+        oasys::SpinLock lock_;
+        LinkMap         links_;
+    };
+
+    /// The index shared by the deferred lists of all the links
+    DeferredIndex deferred_index_;
+
     /// Per-link class used to store deferred transmission bundles
     /// that helps cache route computations
     class DeferredList : public RouterInfo, public oasys::Logger {
     public:
-        DeferredList(const char* logpath, const LinkRef& link);
+        DeferredList(const char* logpath, const LinkRef& link,
+                     DeferredIndex* index);
 
         /// Accessor for the bundle list
         BundleList* list() { return &list_; }
@@ -281,6 +312,8 @@ protected:
         BundleList list_;
         InfoMap    info_;
         size_t     count_;
+        Link*      link_;  ///< not a LinkRef, the link owns this list
+        DeferredIndex* index_;
     };
 
     /// Helper accessor to return the deferred queue for a link
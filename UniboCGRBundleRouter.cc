@@ -46,10 +46,16 @@
 #  include <dtn-config.h>
 #endif
 
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
 #include "UniboCGRBundleRouter.h"
 #include "RouteTable.h"
 #include "bundling/BundleActions.h"
 #include "bundling/BundleDaemon.h"
+#include "bundling/FragmentManager.h"
+#include "bundling/FragmentState.h"
 #include "bundling/TempBundle.h"
 #include "contacts/Contact.h"
 #include "contacts/ContactManager.h"
@@ -72,7 +78,10 @@ UniboCGRBundleRouter::UniboCGRBundleRouter(const char* classname,
                                    const std::string& name)
     : BundleRouter(classname, name),
       reception_cache_(std::string(logpath()) + "/reception_cache",
-                       1024) // XXX/demmer configurable??
+                       1024), // XXX/demmer configurable??
+      cgr_lock_("UniboCGRBundleRouter::cgr_lock"),
+      worker_(NULL),
+      contact_wheel_(NULL)
 {
     route_table_ = new RouteTable(name);
 
@@ -92,6 +101,13 @@ UniboCGRBundleRouter::UniboCGRBundleRouter(const char* classname,
    convert << s;
    convert >> ownNode;
    initialize_contact_graph_routing(ownNode, tv.tv_sec);
+
+    // joined and deleted by shutdown()
+    worker_ = new RoutingWorker(this, MAX_ROUTING_JOBS);
+    worker_->start();
+
+    contact_wheel_ = new ContactWheel(this);
+    contact_wheel_->schedule_in(1000);
 }
 
 //----------------------------------------------------------------------
@@ -104,6 +120,20 @@ UniboCGRBundleRouter::~UniboCGRBundleRouter()
     //Giacomo: dovrei chiamare lo shutdown qua? O anche qua?
 }
 void UniboCGRBundleRouter::shutdown() {
+    if (contact_wheel_ != NULL) {
+        contact_wheel_->stop();
+        contact_wheel_ = NULL;
+    }
+    if (worker_ != NULL) {
+        // the worker uses the route table and UniboCGR until its
+        // current job is done, so wait for it to exit
+        RoutingWorker* worker = worker_;
+        worker_ = NULL;
+        worker->stop();
+        worker->join();
+        delete worker;
+    }
+    oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::shutdown");
     if(route_table_ != NULL) {
         delete route_table_;
         route_table_ = NULL;
@@ -152,6 +182,9 @@ UniboCGRBundleRouter::handle_changed_routes()
 void
 UniboCGRBundleRouter::handle_event(BundleEvent* event)
 {
+    // forward first the bundles routed by the worker, so the event
+    // sees the deferred lists up to date
+    apply_routing_results();
     dispatch_event(event);
 }
 
@@ -310,7 +343,7 @@ UniboCGRBundleRouter::handle_bundle_received(BundleReceivedEvent* event)
     }
     
     if (should_route) {
-        route_bundle(bundle);
+        route_bundle_async(bundle);
     } else {
         BundleDaemon::post_at_head(
             new BundleDeleteRequest(bundle, BundleProtocol::REASON_NO_ADDTL_INFO));
@@ -321,19 +354,17 @@ UniboCGRBundleRouter::handle_bundle_received(BundleReceivedEvent* event)
 void
 UniboCGRBundleRouter::remove_from_deferred(const BundleRef& bundle, int actions)
 {
-    ContactManager* cm = BundleDaemon::instance()->contactmgr();
-    oasys::ScopeLock l(cm->lock(), "UniboCGRBundleRouter::remove_from_deferred");
+    // only the links whose deferred list holds the bundle, so there's
+    // no need to take the contact manager lock and scan every link
+    std::vector<LinkRef> links;
+    deferred_index_.links(bundle->bundleid(), &links);
 
-    const LinkSet* links = cm->links();
-    LinkSet::const_iterator iter;
-    for (iter = links->begin(); iter != links->end(); ++iter) {
+    std::vector<LinkRef>::const_iterator iter;
+    for (iter = links.begin(); iter != links.end(); ++iter) {
         const LinkRef& link = *iter;
 
-        // a bundle might be deleted immediately after being loaded
-        // from storage, meaning that remove_from_deferred is called
-        // before the deferred list is created (since the link isn't
-        // fully set up yet). so just skip the link if there's no
-        // router info, and therefore no deferred list
+        // the link might have lost its router info in the meantime
+        // (e.g. it has been deleted), and therefore its deferred list
         if (link->router_info() == NULL) {
             continue;
         }
@@ -369,6 +400,14 @@ UniboCGRBundleRouter::handle_bundle_transmitted(BundleTransmittedEvent* event)
         // (only applicable to the LTPUDP CLA as of 2014-12-04)
         route_bundle(bundle.object());
     } else {
+        update_throughput(event->contact_->link(), event->bytes_sent_);
+
+        // the volume booked on the contacts has really been used
+        {
+            oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::handle_bundle_transmitted");
+            confirm_bundle_reservation(bundle->bundleid());
+        }
+
         // if the bundle has a deferred single-copy transmission for
         // forwarding on any links, then remove the forwarding log entries
         remove_from_deferred(bundle, ForwardingInfo::FORWARD_ACTION);
@@ -380,6 +419,283 @@ UniboCGRBundleRouter::handle_bundle_transmitted(BundleTransmittedEvent* event)
     check_next_hop(link);
 }
 
+//----------------------------------------------------------------------
+/// Weight of a new sample in the throughput EWMA
+static const double THROUGHPUT_EWMA_WEIGHT = 0.25;
+
+/// Shortest window (ms) over which a throughput sample is taken
+static const long THROUGHPUT_MIN_WINDOW = 1000;
+
+/// Idle gap (ms) after which a new window is started, so the time the
+/// link had nothing to send is not taken as slowness (the window is also
+/// closed as soon as the link queue drains)
+static const long THROUGHPUT_IDLE_GAP = 2000;
+
+/// Minimum interval (s) between two revisions for the same link
+static const time_t THROUGHPUT_REVISION_INTERVAL = 10;
+
+/// Minimum relative change of the estimate that triggers a revision
+static const double THROUGHPUT_REVISION_CHANGE = 0.1;
+
+/// How far ahead (s) the contacts with the neighbor are revised
+static const time_t THROUGHPUT_REVISION_HORIZON = 3600;
+
+//----------------------------------------------------------------------
+static long
+elapsed_ms(const struct timeval& from, const struct timeval& to)
+{
+    return (to.tv_sec - from.tv_sec) * 1000 +
+           (to.tv_usec - from.tv_usec) / 1000;
+}
+
+//----------------------------------------------------------------------
+/// The ipn node number of the link's neighbor, 0 if it isn't an ipn eid
+static unsigned long long
+ipn_neighbor(const LinkRef& link)
+{
+    std::string remote = link->remote_eid().str();
+    if (remote.compare(0, 4, "ipn:") != 0) {
+        return 0;
+    }
+    return strtoull(remote.c_str() + 4, NULL, 10);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::update_throughput(const LinkRef& link, size_t bytes)
+{
+    if (link == NULL) {
+        return;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    ThroughputEstimate& est = throughput_[link->name_str()];
+
+    // the first transmission after an idle period only opens the
+    // window, its bytes were sent before the window start
+    if (est.last_tx_.tv_sec == 0 ||
+        elapsed_ms(est.last_tx_, now) > THROUGHPUT_IDLE_GAP) {
+        est.window_start_ = now;
+        est.window_bytes_ = 0;
+        est.last_tx_ = now;
+        return;
+    }
+
+    est.last_tx_ = now;
+    est.window_bytes_ += bytes;
+
+    // the window only measures the link while it has bundles to send:
+    // once the queue drains the time to the next bundle is offered
+    // load, not throughput, so the window is closed here and the next
+    // transmission opens a new one
+    bool idle = link->queue()->empty() && link->inflight()->empty();
+    if (idle) {
+        est.last_tx_.tv_sec = 0;
+        est.last_tx_.tv_usec = 0;
+    }
+
+    long window = elapsed_ms(est.window_start_, now);
+    if (window < THROUGHPUT_MIN_WINDOW) {
+        if (idle) {
+            est.window_bytes_ = 0;
+        }
+        return;
+    }
+
+    double sample = (double) est.window_bytes_ * 1000.0 / (double) window;
+    est.rate_ = (est.rate_ == 0) ? sample :
+                THROUGHPUT_EWMA_WEIGHT * sample +
+                (1 - THROUGHPUT_EWMA_WEIGHT) * est.rate_;
+    est.window_start_ = now;
+    est.window_bytes_ = 0;
+
+    log_debug("update_throughput %s: sample %.0f bytes/s, estimate %.0f bytes/s",
+              link->name(), sample, est.rate_);
+
+    // rate limit the revisions, each one touches the contacts graph
+    if (now.tv_sec - est.last_revision_ < THROUGHPUT_REVISION_INTERVAL) {
+        return;
+    }
+    if (est.revised_rate_ != 0 &&
+        fabs(est.rate_ - est.revised_rate_) <
+            THROUGHPUT_REVISION_CHANGE * est.revised_rate_) {
+        return;
+    }
+
+    unsigned long long neighbor = ipn_neighbor(link);
+    if (neighbor == 0) {
+        return;
+    }
+
+    int revised;
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::update_throughput");
+        revised = revise_neighbor_xmit_rate(now.tv_sec, neighbor,
+                                            THROUGHPUT_REVISION_HORIZON,
+                                            (long unsigned int) est.rate_);
+    }
+
+    est.last_revision_ = now.tv_sec;
+    est.revised_rate_ = est.rate_;
+
+    log_debug("update_throughput %s: xmitRate of %d contacts to %llu revised to %.0f bytes/s",
+              link->name(), revised, neighbor, est.rate_);
+}
+
+//----------------------------------------------------------------------
+/// Link-up entries needed before a schedule is looked for
+static const size_t LINK_HISTORY_MIN_ENTRIES = 8;
+
+/// New entries after which the schedule is estimated again
+static const size_t LINK_HISTORY_REESTIMATE = 4;
+
+/// Least seconds between two estimates for a neighbor: the estimate
+/// runs on the daemon thread and a flapping link would redo it at
+/// every few link changes
+static const time_t LINK_HISTORY_REESTIMATE_INTERVAL = 600;
+
+/// Entries kept for a neighbor, the oldest ones are dropped
+static const size_t LINK_HISTORY_MAX_ENTRIES = 1024;
+
+/// How far ahead (s) the contacts are predicted
+static const time_t PREDICTION_HORIZON = 86400;
+
+/// Most contacts added to UniboCGR by a single prediction
+static const size_t MAX_PREDICTED_CONTACTS = 64;
+
+/// Confidence of the predicted contacts
+static const float PREDICTED_CONTACT_CONFIDENCE = 0.5;
+
+/// xmitRate (bytes/s) of the predicted contacts if the throughput of
+/// the link hasn't been measured
+static const long unsigned int PREDICTED_XMIT_RATE = 125000;
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::update_link_history(const LinkRef& link, bool up)
+{
+    if (link == NULL || link->remote_eid() == EndpointID::NULL_EID()) {
+        return;
+    }
+
+    time_t now = time(NULL);
+    LinkHistory& hist = link_history_[link->remote_eid().str()];
+
+    if (up) {
+        if (hist.up_since_ == 0) {
+            hist.up_since_ = now;
+        }
+        return;
+    }
+
+    if (hist.up_since_ == 0) {
+        return;
+    }
+
+    if (hist.log_.empty()) {
+        hist.origin_ = hist.up_since_;
+    }
+
+    LinkScheduleEstimator::LogEntry entry;
+    entry.start = (unsigned int) (hist.up_since_ - hist.origin_);
+    entry.duration = (unsigned int) (now - hist.up_since_);
+    hist.log_.push_back(entry);
+    hist.up_since_ = 0;
+    hist.new_entries_++;
+
+    // drop the oldest entry, the estimator wants the log to start at 0
+    if (hist.log_.size() > LINK_HISTORY_MAX_ENTRIES) {
+        hist.log_.erase(hist.log_.begin());
+        unsigned int shift = hist.log_[0].start;
+        for (size_t i = 0; i < hist.log_.size(); ++i) {
+            hist.log_[i].start -= shift;
+        }
+        hist.origin_ += shift;
+    }
+
+    if (hist.log_.size() < LINK_HISTORY_MIN_ENTRIES ||
+        hist.new_entries_ < LINK_HISTORY_REESTIMATE ||
+        now < hist.estimated_at_ + LINK_HISTORY_REESTIMATE_INTERVAL) {
+        return;
+    }
+    hist.new_entries_ = 0;
+    hist.estimated_at_ = now;
+
+    unsigned long long neighbor = ipn_neighbor(link);
+    if (neighbor == 0) {
+        return;
+    }
+
+    LinkScheduleEstimator::Log* schedule =
+        LinkScheduleEstimator::find_schedule(&hist.log_);
+    if (schedule == NULL) {
+        log_debug("update_link_history %s: no periodic schedule in %zu entries",
+                  link->name(), hist.log_.size());
+        return;
+    }
+
+    // the last entry of the schedule is the first one a period later
+    if (schedule->size() < 2 ||
+        (*schedule)[schedule->size() - 1].start <= (*schedule)[0].start) {
+        delete schedule;
+        return;
+    }
+    time_t first  = hist.origin_ + (*schedule)[0].start;
+    time_t period = (*schedule)[schedule->size() - 1].start - (*schedule)[0].start;
+
+    // project the schedule a period at a time, from the period that
+    // holds the end of what was already predicted
+    time_t after = std::max(now, hist.predicted_until_);
+    time_t base  = first;
+    if (after > first) {
+        base += ((after - first) / period) * period;
+    }
+
+    std::vector<LocalContact> contacts;
+    for (; base < now + PREDICTION_HORIZON &&
+             contacts.size() < MAX_PREDICTED_CONTACTS; base += period)
+    {
+        for (size_t i = 0; i + 1 < schedule->size() &&
+                 contacts.size() < MAX_PREDICTED_CONTACTS; ++i)
+        {
+            LocalContact contact;
+            contact.neighbor = neighbor;
+            contact.fromTime = base + ((*schedule)[i].start - (*schedule)[0].start);
+            contact.toTime   = contact.fromTime + (*schedule)[i].duration;
+            if (contact.fromTime < after || contact.toTime <= contact.fromTime ||
+                contact.fromTime >= now + PREDICTION_HORIZON) {
+                continue;
+            }
+            contacts.push_back(contact);
+        }
+    }
+    delete schedule;
+
+    if (contacts.empty()) {
+        return;
+    }
+    hist.predicted_until_ = contacts.back().toTime;
+
+    long unsigned int xmit_rate = PREDICTED_XMIT_RATE;
+    ThroughputMap::iterator iter = throughput_.find(link->name_str());
+    if (iter != throughput_.end() && iter->second.rate_ > 0) {
+        xmit_rate = (long unsigned int) iter->second.rate_;
+    }
+
+    int added;
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::update_link_history");
+        added = add_predicted_contacts(now, neighbor, contacts.size(), &contacts[0],
+                                       xmit_rate, PREDICTED_CONTACT_CONFIDENCE);
+    }
+
+    log_debug("update_link_history %s: period %u s, %d of %zu predicted contacts "
+              "to %llu added", link->name(), (u_int) period, added,
+              contacts.size(), neighbor);
+}
+
 //----------------------------------------------------------------------
 bool
 UniboCGRBundleRouter::can_delete_bundle(const BundleRef& bundle)
@@ -426,6 +742,13 @@ UniboCGRBundleRouter::delete_bundle(const BundleRef& bundle)
 
     remove_from_deferred(bundle, ForwardingInfo::ANY_ACTION);
 
+    // give back the volume still booked for the bundle (e.g. expired
+    // while in the deferred list)
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::delete_bundle");
+        credit_bundle_reservation(bundle->bundleid());
+    }
+
     Session* session = get_session_for_bundle(bundle.object());
     if (session)
     {
@@ -449,6 +772,13 @@ UniboCGRBundleRouter::handle_bundle_cancelled(BundleSendCancelledEvent* event)
     Bundle* bundle = event->bundleref_.object();
     log_debug("handle bundle cancelled: *%p", bundle);
 
+    // the bundle won't use the volume booked for it, route_bundle
+    // books it again on the new routes
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::handle_bundle_cancelled");
+        credit_bundle_reservation(bundle->bundleid());
+    }
+
     // if the bundle has expired, we don't want to reroute it.
     // XXX/demmer this might warrant a more general handling instead?
     if (!bundle->expired()) {
@@ -542,6 +872,8 @@ UniboCGRBundleRouter::handle_contact_up(ContactUpEvent* event)
     add_nexthop_route(link);
     check_next_hop(link);
 
+    update_link_history(link, true);
+
     // check if there's a pending reroute timer on the link, and if
     // so, cancel it.
     // 
@@ -568,6 +900,8 @@ UniboCGRBundleRouter::handle_contact_down(ContactDownEvent* event)
     ASSERT(link != NULL);
     ASSERT(!link->isdeleted());
 
+    update_link_history(link, false);
+
     // if there are any bundles queued on the link when it goes down,
     // schedule a timer to cancel those transmissions and reroute the
     // bundles in case the link takes too long to come back up
@@ -596,6 +930,371 @@ UniboCGRBundleRouter::RerouteTimer::timeout(const struct timeval& now)
     router_->reroute_bundles(link_);
 }
 
+//----------------------------------------------------------------------
+UniboCGRBundleRouter::RoutingWorker::RoutingWorker(UniboCGRBundleRouter* router,
+                                                   size_t max_jobs)
+    : Thread("UniboCGRBundleRouter::RoutingWorker", CREATE_JOINABLE),
+      Logger("UniboCGRBundleRouter::RoutingWorker", "%s/worker",
+             router->logpath()),
+      router_(router),
+      jobs_(logpath_),
+      max_jobs_(max_jobs),
+      peak_depth_(0),
+      routed_(0),
+      rejected_(0)
+{
+}
+
+//----------------------------------------------------------------------
+UniboCGRBundleRouter::RoutingWorker::~RoutingWorker()
+{
+    BundleRef* job;
+    while (jobs_.try_pop(&job)) {
+        delete job;
+    }
+
+    for (size_t i = 0; i < results_.size(); ++i) {
+        delete results_[i];
+    }
+}
+
+//----------------------------------------------------------------------
+bool
+UniboCGRBundleRouter::RoutingWorker::post(Bundle* bundle)
+{
+    oasys::ScopeLock l(&lock_, "RoutingWorker::post");
+
+    size_t depth = jobs_.size();
+    if (depth >= max_jobs_) {
+        ++rejected_;
+        return false;
+    }
+
+    jobs_.push_back(new BundleRef(bundle, "RoutingWorker::post"));
+    if (depth + 1 > peak_depth_) {
+        peak_depth_ = depth + 1;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::RoutingWorker::take_results(
+    std::vector<RoutingResult*>* results)
+{
+    oasys::ScopeLock l(&lock_, "RoutingWorker::take_results");
+    results->swap(results_);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::RoutingWorker::stop()
+{
+    set_should_stop();
+    // a NULL job wakes up the thread
+    jobs_.push_back(NULL);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::RoutingWorker::dump_stats(oasys::StringBuffer* buf)
+{
+    oasys::ScopeLock l(&lock_, "RoutingWorker::dump_stats");
+    buf->appendf("Routing worker: %zu queued (max %zu, peak %zu) -- "
+                 "%llu routed -- %llu routed on the daemon thread (queue full)\n",
+                 jobs_.size(), max_jobs_, peak_depth_,
+                 U64FMT(routed_), U64FMT(rejected_));
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::RoutingWorker::run()
+{
+    while (1) {
+        BundleRef* job = jobs_.pop_blocking();
+        if (job == NULL || should_stop()) {
+            delete job;
+            return;
+        }
+
+        Bundle* bundle = job->object();
+
+        // check to see if forwarding is suppressed to all nodes
+        if (bundle->fwdlog()->get_count(EndpointIDPattern::WILDCARD_EID(),
+                                        ForwardingInfo::SUPPRESSED) > 0) {
+            delete job;
+            continue;
+        }
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        std::string res = "";
+        long unsigned int fragment_length = 0;
+
+        // the links of the next hops, to tell the daemon thread which
+        // deferred lists have to be checked once the result is applied
+        RouteEntryVec matches;
+        LinkRef null_link("RoutingWorker::run");
+        {
+            oasys::ScopeLock l(&router_->cgr_lock_, "RoutingWorker::run");
+            callUniboCGR(tv.tv_sec, bundle, &res, &fragment_length);
+
+            EndpointID eidRes(res);
+            router_->route_table_->get_matching(eidRes, null_link, &matches);
+
+            // the result is dropped, give back the volume booked for
+            // it before another call can book the bundle again
+            if (matches.empty()) {
+                credit_bundle_reservation(bundle->bundleid());
+            }
+        }
+
+        if (! matches.empty()) {
+            {
+                oasys::ScopeLock l(&lock_, "RoutingWorker::run");
+                results_.push_back(new RoutingResult(bundle, res, fragment_length));
+                ++routed_;
+            }
+
+            // the completion event, handled on the daemon thread
+            for (RouteEntryVec::iterator iter = matches.begin();
+                 iter != matches.end(); ++iter) {
+                BundleDaemon::post(
+                    new LinkCheckDeferredEvent((*iter)->link().object()));
+            }
+        }
+
+        delete job;
+    }
+}
+
+//----------------------------------------------------------------------
+UniboCGRBundleRouter::ContactWheel::ContactWheel(UniboCGRBundleRouter* router)
+    : Logger("UniboCGRBundleRouter::ContactWheel", "%s/contact_wheel",
+             router->logpath()),
+      router_(router),
+      slots_(SLOTS),
+      cursor_(0),
+      next_refill_(0),
+      stopped_(false)
+{
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::ContactWheel::stop()
+{
+    oasys::ScopeLock l(&router_->cgr_lock_, "ContactWheel::stop");
+    stopped_ = true;
+
+    // if the timer is pending the timer system deletes it, otherwise
+    // timeout() is running and deletes it once it sees stopped_
+    cancel();
+}
+
+//----------------------------------------------------------------------
+bool
+UniboCGRBundleRouter::ContactWheel::is_stopped()
+{
+    oasys::ScopeLock l(&router_->cgr_lock_, "ContactWheel::is_stopped");
+    return stopped_;
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::ContactWheel::timeout(const struct timeval& now)
+{
+    if (is_stopped()) {
+        delete this;
+        return;
+    }
+
+    time_t t = now.tv_sec;
+    std::vector<Entry> due;
+
+    if (cursor_ == 0) {
+        cursor_ = t - 1;
+    } else if (t - cursor_ > (time_t) SLOTS) {
+        // more than a whole turn behind: walking the slots one second
+        // at a time would skip entries, so take out all the overdue
+        // ones now. The link actions of the contacts already ended are
+        // dropped, only their close is still done.
+        for (size_t s = 0; s < slots_.size(); ++s) {
+            std::vector<Entry>& slot = slots_[s];
+            size_t kept = 0;
+            for (size_t i = 0; i < slot.size(); ++i) {
+                if (slot[i].when_ > t) {
+                    slot[kept++] = slot[i];
+                } else if (slot[i].action_ == CLOSE_LINK || slot[i].to_ > t) {
+                    due.push_back(slot[i]);
+                } else {
+                    log_debug("dropping overdue action for the contact to %llu "
+                              "ended at %ld", slot[i].neighbor_,
+                              (long) slot[i].to_);
+                }
+            }
+            slot.resize(kept);
+        }
+        cursor_ = t - 1;
+    }
+
+    if (t >= next_refill_) {
+        refill(t);
+        next_refill_ = t + SLOTS / 4;
+    }
+
+    while (cursor_ < t) {
+        ++cursor_;
+
+        // the entries of the later turns stay in the slot
+        std::vector<Entry>& slot = slots_[cursor_ % SLOTS];
+        size_t kept = 0;
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].when_ <= cursor_) {
+                due.push_back(slot[i]);
+            } else {
+                slot[kept++] = slot[i];
+            }
+        }
+        slot.resize(kept);
+    }
+
+    for (size_t i = 0; i < due.size() && ! is_stopped(); ++i) {
+        fire(due[i]);
+    }
+
+    // re-armed under the lock, so that stop() either cancels the new
+    // timer or is seen here
+    bool stopped;
+    {
+        oasys::ScopeLock l(&router_->cgr_lock_, "ContactWheel::timeout");
+        stopped = stopped_;
+        if (! stopped) {
+            schedule_in(1000);
+        }
+    }
+    if (stopped) {
+        delete this;
+    }
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::ContactWheel::refill(time_t now)
+{
+    std::vector<LocalContact> contacts(SLOTS);
+    int count;
+    {
+        oasys::ScopeLock l(&router_->cgr_lock_, "ContactWheel::refill");
+        count = get_local_contacts(now, SLOTS, contacts.size(), &contacts[0]);
+    }
+
+    // forget the contacts already ended
+    ContactMap::iterator iter = scheduled_.begin();
+    while (iter != scheduled_.end()) {
+        if (iter->second < now) {
+            scheduled_.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const LocalContact& contact = contacts[i];
+        std::pair<unsigned long long, time_t> key(contact.neighbor,
+                                                  contact.fromTime);
+        if (scheduled_.find(key) != scheduled_.end()) {
+            continue;
+        }
+        scheduled_[key] = contact.toTime;
+
+        log_debug("contact to %llu [%ld, %ld] added",
+                  contact.neighbor, (long) contact.fromTime,
+                  (long) contact.toTime);
+
+        Entry entry;
+        entry.neighbor_ = contact.neighbor;
+        entry.from_     = contact.fromTime;
+        entry.to_       = contact.toTime;
+
+        entry.action_ = OPEN_LINK;
+        schedule(entry, contact.fromTime - OPEN_LEAD);
+        entry.action_ = CHECK_DEFERRED;
+        schedule(entry, contact.fromTime - DEFERRED_LEAD);
+        entry.action_ = CLOSE_LINK;
+        schedule(entry, contact.toTime);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::ContactWheel::schedule(const Entry& entry, time_t when)
+{
+    // late actions are done at the next tick
+    if (when <= cursor_) {
+        when = cursor_ + 1;
+    }
+
+    Entry e = entry;
+    e.when_ = when;
+    slots_[when % SLOTS].push_back(e);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::ContactWheel::fire(const Entry& entry)
+{
+    // on the timer thread the route entries can be deleted by the
+    // daemon at any time, only a copy of the link is safe to use
+    LinkRef link = router_->link_for_neighbor(entry.neighbor_);
+    if (link == NULL) {
+        log_debug("no route to neighbor %llu", entry.neighbor_);
+        return;
+    }
+
+    if (link->isdeleted()) {
+        return;
+    }
+
+    switch (entry.action_) {
+    case OPEN_LINK:
+        if (! link->isopen() && ! link->isopening()) {
+            log_debug("contact to %llu starts at %ld: opening link %s",
+                      entry.neighbor_, (long) entry.from_, link->name());
+            BundleDaemon::post(
+                new LinkStateChangeRequest(link, Link::OPENING,
+                                           ContactEvent::NO_INFO));
+        }
+        break;
+
+    case CHECK_DEFERRED:
+        BundleDaemon::post(new LinkCheckDeferredEvent(link.object()));
+        break;
+
+    case CLOSE_LINK: {
+        // keep the link if the next contact with the neighbor is
+        // running or is about to start
+        ContactMap::iterator next = scheduled_.upper_bound(
+            std::make_pair(entry.neighbor_, entry.from_));
+        if (next != scheduled_.end() &&
+            next->first.first == entry.neighbor_ &&
+            next->first.second <= entry.to_ + OPEN_LEAD) {
+            break;
+        }
+
+        if (link->isopen() && link->queue()->empty() &&
+            link->inflight()->empty()) {
+            log_debug("contact to %llu ended at %ld: closing idle link %s",
+                      entry.neighbor_, (long) entry.to_, link->name());
+            BundleDaemon::post(
+                new LinkStateChangeRequest(link, Link::CLOSED,
+                                           ContactEvent::IDLE));
+        }
+        break;
+    }
+    }
+}
+
 //----------------------------------------------------------------------
 void
 UniboCGRBundleRouter::reroute_bundles(const LinkRef& link)
@@ -661,7 +1360,7 @@ UniboCGRBundleRouter::handle_link_created(LinkCreatedEvent* event)
     ASSERT(link != NULL);
     ASSERT(!link->isdeleted());
 
-    link->set_router_info(new DeferredList(logpath(), link));
+    link->set_router_info(new DeferredList(logpath(), link, &deferred_index_));
                           
     // true=skip changed routes because we are about to call it
     add_nexthop_route(link, true); 
@@ -677,6 +1376,10 @@ UniboCGRBundleRouter::handle_link_deleted(LinkDeletedEvent* event)
 
     route_table_->del_entries_for_nexthop(link);
 
+    // the index holds references to the link, drop them with the
+    // link's deferred list
+    deferred_index_.del_link(link);
+
     RerouteTimerMap::iterator iter = reroute_timers_.find(link->name_str());
     if (iter != reroute_timers_.end()) {
         log_debug("link %s deleted, cancelling reroute timer", link->name());
@@ -723,6 +1426,12 @@ UniboCGRBundleRouter::get_routing_state(oasys::StringBuffer* buf)
     buf->appendf("Route table for %s router:\n\n", name_.c_str());
     route_table_->dump(buf);
 
+    if (worker_ != NULL)
+    {
+        worker_->dump_stats(buf);
+        buf->appendf("\n");
+    }
+
     if (!sessions_.empty())
     {
         buf->appendf("Session table (%zu sessions):\n", sessions_.size());
@@ -820,20 +1529,42 @@ UniboCGRBundleRouter::getLinkForNode(int neighbor)
     convert << neighbor;
     convert << ".0";
     convert >> eids;
-    EndpointID* ied = new EndpointID(eids);
-	route_table_->get_matching(*ied,null_link,&matchess);
+    EndpointID ied(eids);
+	route_table_->get_matching(ied,null_link,&matchess);
+    if (matchess.empty()) {
+        return NULL;
+    }
 	iters = matchess.begin();
     RouteEntry* res = *iters;
     return res;
 }
 
 //----------------------------------------------------------------------
-int
-UniboCGRBundleRouter::route_bundle(Bundle* bundle, bool skip_check_next_hop)
+LinkRef
+UniboCGRBundleRouter::link_for_neighbor(unsigned long long neighbor)
 {
+    LinkRef link("UniboCGRBundleRouter::link_for_neighbor");
+    LinkRef null_link("UniboCGRBundleRouter::link_for_neighbor");
     RouteEntryVec matches;
-    RouteEntryVec::iterator iter;
+    char eid[64];
 
+    snprintf(eid, sizeof(eid), "ipn:%llu.0", neighbor);
+
+    // the lock is held until the link is copied, so the entry can't be
+    // deleted in between
+    oasys::ScopeLock l(route_table_->lock(),
+                       "UniboCGRBundleRouter::link_for_neighbor");
+    route_table_->get_matching(EndpointID(eid), null_link, &matches);
+    if (! matches.empty()) {
+        link = matches.front()->link();
+    }
+    return link;
+}
+
+//----------------------------------------------------------------------
+int
+UniboCGRBundleRouter::route_bundle(Bundle* bundle, bool skip_check_next_hop)
+{
     log_debug("route_bundle: checking bundle %"PRIbid, bundle->bundleid());
 
     // check to see if forwarding is suppressed to all nodes
@@ -847,16 +1578,74 @@ UniboCGRBundleRouter::route_bundle(Bundle* bundle, bool skip_check_next_hop)
     }
 
     
-    LinkRef null_link("UniboCGRBundleRouter::route_bundle");
-
     //Giacomo: chiamo UniboCGR e prendo il risultato
     struct timeval tv;
     gettimeofday(&tv, NULL);
     std::string res = "";
-    callUniboCGR(tv.tv_sec, bundle, &res);
-    log_debug("unibocgr return %s", res);
-    EndpointID* eidRes = new EndpointID(res);
-    route_table_->get_matching(*eidRes, null_link, &matches);
+    long unsigned int fragment_length = 0;
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::route_bundle");
+        callUniboCGR(tv.tv_sec, bundle, &res, &fragment_length);
+    }
+
+    return fwd_to_cgr_nexthop(bundle, res, fragment_length, skip_check_next_hop);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::route_bundle_async(Bundle* bundle)
+{
+    if (worker_ == NULL || ! worker_->post(bundle)) {
+        log_debug("route_bundle_async: routing worker busy, "
+                  "routing bundle %"PRIbid" now", bundle->bundleid());
+        route_bundle(bundle);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::apply_routing_results()
+{
+    if (worker_ == NULL) {
+        return;
+    }
+
+    std::vector<RoutingResult*> results;
+    worker_->take_results(&results);
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        RoutingResult* result = results[i];
+
+        // the bundle might have been delivered or deleted meanwhile;
+        // check_next_hop is done by the LinkCheckDeferredEvent posted
+        // by the worker
+        if (pending_bundles_->contains(result->bundle_)) {
+            fwd_to_cgr_nexthop(result->bundle_.object(), result->res_,
+                               result->fragment_length_, true);
+        } else {
+            // delete_bundle may have run before the worker booked
+            // the volume for the bundle
+            oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::apply_routing_results");
+            credit_bundle_reservation(result->bundle_->bundleid());
+        }
+        delete result;
+    }
+}
+
+//----------------------------------------------------------------------
+int
+UniboCGRBundleRouter::fwd_to_cgr_nexthop(Bundle* bundle, const std::string& res,
+                                         size_t fragment_length,
+                                         bool skip_check_next_hop)
+{
+    RouteEntryVec matches;
+    RouteEntryVec::iterator iter;
+
+    LinkRef null_link("UniboCGRBundleRouter::fwd_to_cgr_nexthop");
+
+    log_debug("unibocgr return %s", res.c_str());
+    EndpointID eidRes(res);
+    route_table_->get_matching(eidRes, null_link, &matches);
 
     // sort the matching routes by priority, allowing subclasses to
     // override the way in which the sorting occurs
@@ -865,6 +1654,26 @@ UniboCGRBundleRouter::route_bundle(Bundle* bundle, bool skip_check_next_hop)
     log_debug("route_bundle bundle id %"PRIbid": checking %zu route entry matches",
               bundle->bundleid(), matches.size());
 
+    // the best route can't carry the whole bundle: the fragments are
+    // posted as new bundles and UniboCGR routes each one on its own,
+    // booking the volume left by the previous ones. fragment_length is
+    // the total length of a fragment, the fragment manager takes the
+    // blocks prepared for the link out of it to get the payload length
+    if (fragment_length != 0 && ! matches.empty()) {
+        log_debug("route_bundle bundle id %"PRIbid": "
+                  "proactively fragmenting to %zu bytes (blocks included) for link %s",
+                  bundle->bundleid(), fragment_length,
+                  matches[0]->link()->name());
+
+        FragmentState* state = BundleDaemon::instance()->fragmentmgr()->
+            proactively_fragment(bundle, matches[0]->link(), fragment_length);
+        if (state != NULL) {
+            BundleDaemon::post_at_head(
+                new BundleDeleteRequest(bundle, BundleProtocol::REASON_NO_ADDTL_INFO));
+            return 0;
+        }
+    }
+
     bool forwarded;    
     unsigned int count = 0;
     for (iter = matches.begin(); iter != matches.end(); ++iter)
@@ -958,10 +1767,36 @@ UniboCGRBundleRouter::check_next_hop(const LinkRef& next_hop)
     u_int max_to_move = next_hop->params().qlimit_bundles_high_;
     BundleRef bundle("UniboCGRBundleRouter::check_next_hop");
 
+    // the bytes that can still be sent before the running contact
+    // ends, less what is already queued or in flight on the link;
+    // unknown if UniboCGR has no running contact to the neighbor
+    bool limited = false;
+    double volume_left = 0;
+    unsigned long long neighbor = ipn_neighbor(next_hop);
+    if (neighbor != 0) {
+        time_t now = time(NULL);
+        LocalContact contact;
+        long unsigned int xmit_rate = 0;
+        int ret;
+        {
+            oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::check_next_hop");
+            ret = get_running_contact(now, neighbor, &contact, &xmit_rate);
+        }
+        if (ret == 0 && xmit_rate > 0) {
+            limited = true;
+            volume_left = (double) (contact.toTime - now) * xmit_rate -
+                          (double) (next_hop->bytes_queued() +
+                                    next_hop->bytes_inflight());
+        }
+    }
+
     oasys::ScopeLock l(deferred->list()->lock(), 
                        "UniboCGRBundleRouter::check_next_hop");
-    BundleList::iterator iter = deferred->list()->begin();
-    while (iter != deferred->list()->end())
+
+    // walk the bundles by priority and expiration time instead of
+    // arrival order, so that the expedited ones leave first
+    DeferredList::OrderSet::const_iterator iter = deferred->order().begin();
+    while (iter != deferred->order().end())
     {
         if (next_hop->queue_is_full()) {
             log_debug("check_next_hop %s: link queue is full, stopping loop",
@@ -969,9 +1804,25 @@ UniboCGRBundleRouter::check_next_hop(const LinkRef& next_hop)
             break;
         }
         
-        bundle = *iter;
+        if (limited && volume_left <= 0) {
+            log_debug("check_next_hop %s: contact volume used up, stopping loop",
+                      next_hop->name());
+            break;
+        }
+
+        bundle = iter->bundle_;
         ++iter;
 
+        // the bundle would miss the end of the contact, leave it for
+        // the next one: a smaller bundle behind it may still fit
+        size_t length = bundle->payload().length();
+        if (limited && (double) length > volume_left) {
+            log_debug("check_next_hop: *%p (%zu bytes) doesn't fit in the "
+                      "%.0f bytes left of the contact", bundle.object(),
+                      length, volume_left);
+            continue;
+        }
+
         ForwardingInfo info = deferred->info(bundle);
 
         // if should_fwd returns false, then the bundle was either
@@ -1004,6 +1855,7 @@ UniboCGRBundleRouter::check_next_hop(const LinkRef& next_hop)
                   bundle.object(), next_hop.object());
         actions_->queue_bundle(bundle.object() , next_hop,
                                info.action(), info.custody_spec());
+        volume_left -= (double) length;
 
         // break out if we have now moved the max
         if (++bundles_moved >= max_to_move) {
@@ -1014,6 +1866,21 @@ UniboCGRBundleRouter::check_next_hop(const LinkRef& next_hop)
     }
 }
 
+//----------------------------------------------------------------------
+/**
+ * Order used by reroute_all_bundles to group the bundles by
+ * destination and, for the same destination, by priority (higher first).
+ */
+struct RerouteGroupSort {
+    bool operator() (const BundleRef& a, const BundleRef& b) const {
+        int cmp = a->dest().str().compare(b->dest().str());
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        return a->priority() > b->priority();
+    }
+};
+
 //----------------------------------------------------------------------
 void
 UniboCGRBundleRouter::reroute_all_bundles()
@@ -1036,36 +1903,75 @@ UniboCGRBundleRouter::reroute_all_bundles()
     // XXX/demmer this should cancel previous scheduled transmissions
     // if any decisions have changed
 
+    // take a snapshot of the pending bundles, so the lock is held only once
+    std::vector<BundleRef> bundles;
     pending_bundles_->lock()->lock("UniboCGRBundleRouter::reroute_all_bundles");
-    pending_bundles_t::iterator iter = pending_bundles_->begin();
-    if ( iter == pending_bundles_->end() ) {
-      pending_bundles_->lock()->unlock();
-      return;
-    }
-    pending_bundles_->lock()->unlock();
-
-    bool skip_check_next_hop = false;
-    while (true)
+    bundles.reserve(pending_bundles_->size());
+    for (pending_bundles_t::iterator iter = pending_bundles_->begin();
+         iter != pending_bundles_->end(); ++iter)
     {
         #ifdef PENDING_BUNDLES_IS_MAP
-            route_bundle(iter->second, skip_check_next_hop); // for <map> lists
+            Bundle* bundle = iter->second; // for <map> lists
         #else
-            route_bundle(*iter, skip_check_next_hop); // for <lists> lists
+            Bundle* bundle = *iter; // for <lists> lists
         #endif
 
-        // only do the check_next_hop for the first bundle which 
-        // primes the pump for all of the other bundles
-        if (!skip_check_next_hop) {
-            skip_check_next_hop = true;
+        // check to see if forwarding is suppressed to all nodes
+        if (bundle->fwdlog()->get_count(EndpointIDPattern::WILDCARD_EID(),
+                                        ForwardingInfo::SUPPRESSED) > 0) {
+            continue;
         }
 
-        pending_bundles_->lock()->lock("UniboCGRBundleRouter::reroute_all_bundles");
-        ++iter;
-        if ( iter == pending_bundles_->end() ) {
-          pending_bundles_->lock()->unlock();
-          break;
+        bundles.push_back(BundleRef(bundle, "UniboCGRBundleRouter::reroute_all_bundles"));
+    }
+    pending_bundles_->lock()->unlock();
+
+    if (bundles.empty()) {
+        return;
+    }
+
+    // group the bundles by destination and, inside each group, by
+    // priority so that UniboCGR books the MTVs of the most urgent
+    // bundles first; stable to keep the pending order otherwise
+    std::stable_sort(bundles.begin(), bundles.end(), RerouteGroupSort());
+
+    size_t count = bundles.size();
+    std::vector<Bundle*> cgr_bundles(count);
+    std::vector<std::string> res(count);
+    std::vector<long unsigned int> fragment_length(count);
+    for (size_t i = 0; i < count; ++i) {
+        cgr_bundles[i] = bundles[i].object();
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    {
+        oasys::ScopeLock l(&cgr_lock_, "UniboCGRBundleRouter::reroute_all_bundles");
+        callUniboCGRBatch(tv.tv_sec, &cgr_bundles[0], count, &res[0],
+                          &fragment_length[0]);
+    }
+
+    // bundles are always added to the deferred lists, check_next_hop
+    // is done only once per link at the end to move them to the queues
+    for (size_t i = 0; i < count; ++i) {
+        fwd_to_cgr_nexthop(cgr_bundles[i], res[i], fragment_length[i], true);
+    }
+
+    ContactManager* cm = BundleDaemon::instance()->contactmgr();
+    std::vector<LinkRef> links;
+    {
+        oasys::ScopeLock l(cm->lock(), "UniboCGRBundleRouter::reroute_all_bundles");
+        const LinkSet* link_set = cm->links();
+        for (LinkSet::const_iterator iter = link_set->begin();
+             iter != link_set->end(); ++iter) {
+            if ((*iter)->router_info() != NULL) {
+                links.push_back(*iter);
+            }
         }
-        pending_bundles_->lock()->unlock();
+    }
+
+    for (size_t i = 0; i < links.size(); ++i) {
+        check_next_hop(links[i]);
     }
 
 #ifdef BDSTATS_ENABLED
@@ -1082,14 +1988,31 @@ UniboCGRBundleRouter::recompute_routes()
 
 //----------------------------------------------------------------------
 UniboCGRBundleRouter::DeferredList::DeferredList(const char* logpath,
-                                             const LinkRef& link)
+                                             const LinkRef& link,
+                                             DeferredIndex* index)
     : RouterInfo(),
       Logger("%s/deferred/%s", logpath, link->name()),
       list_(link->name_str() + ":deferred"),
-      count_(0)
+      seqno_(0),
+      count_(0),
+      link_(link.object()),
+      index_(index)
 {
 }
 
+//----------------------------------------------------------------------
+bool
+UniboCGRBundleRouter::DeferredList::OrderKey::operator<(const OrderKey& other) const
+{
+    if (priority_ != other.priority_) {
+        return priority_ > other.priority_;
+    }
+    if (deadline_ != other.deadline_) {
+        return deadline_ < other.deadline_;
+    }
+    return seqno_ < other.seqno_;
+}
+
 //----------------------------------------------------------------------
 void
 UniboCGRBundleRouter::DeferredList::dump_stats(oasys::StringBuffer* buf)
@@ -1106,7 +2029,7 @@ UniboCGRBundleRouter::DeferredList::find(const BundleRef& bundle,
     if (iter == info_.end()) {
         return false;
     }
-    *info = iter->second;
+    *info = iter->second.info_;
     return true;
 }
 
@@ -1116,7 +2039,7 @@ UniboCGRBundleRouter::DeferredList::info(const BundleRef& bundle)
 {
     InfoMap::const_iterator iter = info_.find(bundle->bundleid());
     ASSERT(iter != info_.end());
-    return iter->second;
+    return iter->second.info_;
 }
 
 //----------------------------------------------------------------------
@@ -1135,9 +2058,20 @@ UniboCGRBundleRouter::DeferredList::add(const BundleRef&      bundle,
     log_debug("adding *%p to deferred (size: %zu, count: %xu)",
               bundle.object(), list_.size(), count_);
 
+    OrderKey key;
+    key.priority_ = bundle->priority();
+    key.deadline_ = bundle->creation_ts().seconds_ + bundle->expiration();
+    key.seqno_    = seqno_++;
+    key.bundle_   = bundle.object();
+
+    Entry entry;
+    entry.info_  = info;
+    entry.order_ = order_.insert(key).first;
+
     count_++;
-    info_.insert(InfoMap::value_type(bundle->bundleid(), info));
+    info_.insert(InfoMap::value_type(bundle->bundleid(), entry));
     list_.push_back(bundle);
+    index_->add(bundle->bundleid(), LinkRef(link_, "DeferredList::add"));
 
     return true;
 }
@@ -1148,8 +2082,11 @@ UniboCGRBundleRouter::DeferredList::del(const BundleRef& bundle)
 {
     ASSERT(list_.lock()->is_locked_by_me());
  
-    size_t n = info_.erase(bundle->bundleid());
-    ASSERT(n == 1);
+    InfoMap::iterator iter = info_.find(bundle->bundleid());
+    ASSERT(iter != info_.end());
+    order_.erase(iter->second.order_);
+    info_.erase(iter);
+    index_->del(bundle->bundleid(), LinkRef(link_, "DeferredList::del"));
     
     if (! list_.erase(bundle)) {
         return false;
@@ -1164,6 +2101,76 @@ UniboCGRBundleRouter::DeferredList::del(const BundleRef& bundle)
     return true;
 }
 
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::DeferredIndex::add(bundleid_t id, const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::add");
+    links_[id].push_back(link);
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::DeferredIndex::del(bundleid_t id, const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::del");
+
+    LinkMap::iterator iter = links_.find(id);
+    if (iter == links_.end()) {
+        return;
+    }
+
+    std::vector<LinkRef>& v = iter->second;
+    std::vector<LinkRef>::iterator link_iter;
+    for (link_iter = v.begin(); link_iter != v.end(); ++link_iter) {
+        if (link_iter->object() == link.object()) {
+            v.erase(link_iter);
+            break;
+        }
+    }
+
+    if (v.empty()) {
+        links_.erase(iter);
+    }
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::DeferredIndex::del_link(const LinkRef& link)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::del_link");
+
+    LinkMap::iterator iter = links_.begin();
+    while (iter != links_.end()) {
+        std::vector<LinkRef>& v = iter->second;
+        std::vector<LinkRef>::iterator link_iter;
+        for (link_iter = v.begin(); link_iter != v.end(); ++link_iter) {
+            if (link_iter->object() == link.object()) {
+                v.erase(link_iter);
+                break;
+            }
+        }
+
+        if (v.empty()) {
+            links_.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+void
+UniboCGRBundleRouter::DeferredIndex::links(bundleid_t id, std::vector<LinkRef>* links)
+{
+    oasys::ScopeLock l(&lock_, "DeferredIndex::links");
+
+    LinkMap::const_iterator iter = links_.find(id);
+    if (iter != links_.end()) {
+        *links = iter->second;
+    }
+}
+
 //----------------------------------------------------------------------
 UniboCGRBundleRouter::DeferredList*
 UniboCGRBundleRouter::deferred_list(const LinkRef& link)
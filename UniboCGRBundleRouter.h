@@ -42,9 +42,17 @@ in Summer 2020 under supervision of Carlo Caini
 #ifndef _UNIBO_CGR_BUNDLE_ROUTER_H_
 #define _UNIBO_CGR_BUNDLE_ROUTER_H_
 
+#include <map>
+#include <set>
+#include <vector>
+#include <oasys/thread/MsgQueue.h>
+#include <oasys/thread/Mutex.h>
+#include <oasys/thread/SpinLock.h>
+#include <oasys/thread/Thread.h>
 #include <oasys/util/StringUtils.h>
 
 #include "BundleRouter.h"
+#include "LinkScheduleEstimator.h"
 #include "RouterInfo.h"
 #include "bundling/BundleInfoCache.h"
 #include "reg/Registration.h"
@@ -77,6 +85,11 @@ namespace dtn {
 		//Method used by interface to get the Link (res) that will be used for a specific number of a node (neighbor)
 		dtn::RouteEntry* getLinkForNode(int neighbor);
 
+		/// Link of the first route to the neighbor, copied under the
+		/// route table lock so that it can be used from threads other
+		/// than the daemon's; NULL if there is no route
+		LinkRef link_for_neighbor(unsigned long long neighbor);
+
 		/**
 		 * Event handler overridden from BundleRouter / BundleEventHandler
 		 * that dispatches to the type specific handlers where
@@ -172,6 +185,35 @@ namespace dtn {
 		 */
 		virtual int route_bundle(Bundle* bundle, bool skip_check_next_hop=false);
 
+		/**
+		 * Forward the bundle on the links of the route entries that
+		 * match the next hops chosen by UniboCGR (res). Called by
+		 * route_bundle and by reroute_all_bundles, which gets the next
+		 * hops of many bundles with a single call to UniboCGR.
+		 *
+		 * If fragment_length isn't 0 the best route can carry only
+		 * a part of the bundle: the bundle is proactively fragmented,
+		 * with fragment_length as the max total length of a fragment
+		 * (blocks included), and the fragments are routed as new bundles.
+		 *
+		 * Returns the number of links on which the bundle was queued.
+		 */
+		virtual int fwd_to_cgr_nexthop(Bundle* bundle, const std::string& res,
+				size_t fragment_length, bool skip_check_next_hop);
+
+		/**
+		 * Hand the bundle to the routing worker instead of running
+		 * UniboCGR on the daemon thread. If the worker queue is full the
+		 * bundle is routed synchronously with route_bundle().
+		 */
+		void route_bundle_async(Bundle* bundle);
+
+		/**
+		 * Forward the bundles whose routes were computed by the routing
+		 * worker. Called on the daemon thread before each event.
+		 */
+		void apply_routing_results();
+
 		/**
 		 * Once a vector of matching routes has been found, sort the
 		 * vector. The default uses the route priority, breaking ties by
@@ -191,6 +233,10 @@ namespace dtn {
 
 		/**
 		 * Go through all known bundles in the system and try to re-route them.
+		 *
+		 * The pending bundles are grouped by destination and priority,
+		 * each group is routed by a single UniboCGR call so that the
+		 * routes to a destination are computed only once.
 		 */
 		virtual void reroute_all_bundles();
 
@@ -261,15 +307,242 @@ namespace dtn {
 		typedef oasys::StringMap<RerouteTimer*> RerouteTimerMap;
 		RerouteTimerMap reroute_timers_;
 
+		/// Reverse index from a bundle to the links whose deferred list
+		/// holds it, kept up to date by DeferredList::add() and del() so
+		/// that remove_from_deferred() doesn't have to scan every link
+		class DeferredIndex {
+		public:
+			/// Record that the link's deferred list holds the bundle
+			void add(bundleid_t id, const LinkRef& link);
+
+			/// Forget that the link's deferred list holds the bundle
+			void del(bundleid_t id, const LinkRef& link);
+
+			/// Forget all the bundles of the link's deferred list, called
+			/// when the link is deleted so its reference is released
+			void del_link(const LinkRef& link);
+
+			/// Fill in the links whose deferred list holds the bundle
+			void links(bundleid_t id, std::vector<LinkRef>* links);
+
+		protected:
+			typedef std::map<bundleid_t, std::vector<LinkRef> > LinkMap;
+			oasys::SpinLock lock_;
+			LinkMap         links_;
+		};
+
+		/// The index shared by the deferred lists of all the links
+		DeferredIndex deferred_index_;
+
+		/// Serializes the calls to UniboCGR, whose state is global
+		oasys::Mutex cgr_lock_;
+
+		/// Next hops computed by the routing worker for a bundle
+		struct RoutingResult {
+			BundleRef   bundle_;
+			std::string res_;
+			size_t      fragment_length_;
+
+			RoutingResult(Bundle* bundle, const std::string& res,
+			              size_t fragment_length)
+				: bundle_(bundle, "UniboCGRBundleRouter::RoutingResult"),
+				  res_(res), fragment_length_(fragment_length) {}
+		};
+
+		/// Thread that runs UniboCGR for the received bundles, so that
+		/// a long route computation doesn't hold up the daemon's events.
+		/// There is a single worker since UniboCGR can't run concurrently.
+		class RoutingWorker : public oasys::Thread, public oasys::Logger {
+		public:
+			RoutingWorker(UniboCGRBundleRouter* router, size_t max_jobs);
+			virtual ~RoutingWorker();
+
+			/// Queue the bundle, returns false if the queue is full
+			bool post(Bundle* bundle);
+
+			/// Move the completed results into results
+			void take_results(std::vector<RoutingResult*>* results);
+
+			/// Ask the thread to exit after the current job
+			void stop();
+
+			/// Print out the queue depth and the counters
+			void dump_stats(oasys::StringBuffer* buf);
+
+		protected:
+			virtual void run();
+
+			UniboCGRBundleRouter*       router_;
+			oasys::MsgQueue<BundleRef*> jobs_;
+			size_t                      max_jobs_;
+
+			oasys::SpinLock             lock_;    ///< protects the fields below
+			std::vector<RoutingResult*> results_;
+			size_t                      peak_depth_;
+			u_int64_t                   routed_;
+			u_int64_t                   rejected_;
+		};
+
+		friend class RoutingWorker;
+
+		/// The routing worker, joined and deleted by shutdown()
+		RoutingWorker* worker_;
+
+		/// Maximum number of bundles waiting for the routing worker
+		static const size_t MAX_ROUTING_JOBS = 1024;
+
+		/// Timer wheel fed with the contacts of the own node known by
+		/// UniboCGR: opens the link to the neighbor just before each
+		/// contact starts, checks its deferred list at the start time
+		/// and closes the link if it is idle when the contact ends.
+		/// Ticks every second on the timer thread, so it only posts
+		/// requests and events to the daemon.
+		class ContactWheel : public oasys::Timer, public oasys::Logger {
+		public:
+			ContactWheel(UniboCGRBundleRouter* router);
+
+			void timeout(const struct timeval& now);
+
+			/// Stop the wheel: it isn't re-armed and fires nothing more,
+			/// the object is deleted by the timer thread
+			void stop();
+
+			/// Number of one second slots, i.e. how far ahead the
+			/// contacts are scheduled
+			static const unsigned int SLOTS = 256;
+
+			/// Seconds before the contact start in which the link is opened
+			static const time_t OPEN_LEAD = 2;
+
+			/// Seconds before the contact start in which the deferred
+			/// bundles are released, so that they are queued on the link
+			/// (opened OPEN_LEAD seconds before) when the contact starts
+			static const time_t DEFERRED_LEAD = 1;
+
+		protected:
+			typedef enum { OPEN_LINK, CHECK_DEFERRED, CLOSE_LINK } action_t;
+
+			struct Entry {
+				unsigned long long neighbor_;
+				time_t             from_;
+				time_t             to_;
+				time_t             when_;    ///< time of the action
+				action_t           action_;
+			};
+
+			/// The contacts already put in the wheel, (neighbor, start)
+			/// to end time
+			typedef std::map<std::pair<unsigned long long, time_t>, time_t>
+				ContactMap;
+
+			/// Add the contacts that start within the wheel's span
+			void refill(time_t now);
+
+			/// Schedule the entry in the slot of the given time
+			void schedule(const Entry& entry, time_t when);
+
+			/// Perform the action of an expired entry
+			void fire(const Entry& entry);
+
+			UniboCGRBundleRouter*            router_;
+			std::vector<std::vector<Entry> > slots_;
+			time_t                           cursor_;      ///< last second processed
+			time_t                           next_refill_;
+			ContactMap                       scheduled_;
+			bool                             stopped_;     ///< protected by cgr_lock_
+
+			/// Check stopped_ under the router's cgr_lock_
+			bool is_stopped();
+		};
+
+		friend class ContactWheel;
+
+		/// Throughput measured on a link from the transmitted bundles,
+		/// smoothed with an EWMA
+		struct ThroughputEstimate {
+			double         rate_;          ///< bytes per second, 0 if unknown
+			struct timeval window_start_;
+			struct timeval last_tx_;
+			u_int64_t      window_bytes_;
+			time_t         last_revision_;
+			double         revised_rate_;  ///< rate given to UniboCGR
+
+			ThroughputEstimate()
+				: rate_(0), window_bytes_(0), last_revision_(0),
+				  revised_rate_(0)
+			{
+				window_start_.tv_sec = window_start_.tv_usec = 0;
+				last_tx_.tv_sec = last_tx_.tv_usec = 0;
+			}
+		};
+
+		/// Account a transmission on the link and, at most once per
+		/// revision interval, revise the xmitRate of the contacts to the
+		/// neighbor if the estimate moved enough
+		void update_throughput(const LinkRef& link, size_t bytes);
+
+		/// Table of throughput estimates, indexed by the link name
+		typedef oasys::StringMap<ThroughputEstimate> ThroughputMap;
+		ThroughputMap throughput_;
+
+		/// Up/down history of the links to a neighbor, from which
+		/// LinkScheduleEstimator predicts the next contacts
+		struct LinkHistory {
+			LinkScheduleEstimator::Log log_;  ///< starts relative to origin_
+			time_t origin_;
+			time_t up_since_;         ///< 0 if no link is up
+			size_t new_entries_;      ///< entries since the last estimate
+			time_t predicted_until_;  ///< end of the last contact predicted
+			time_t estimated_at_;     ///< time of the last estimate
+
+			LinkHistory()
+				: origin_(0), up_since_(0), new_entries_(0),
+				  predicted_until_(0), estimated_at_(0) {}
+		};
+
+		/// Record the link going up or down and, once enough entries
+		/// have been added since the last estimate and at most once per
+		/// LINK_HISTORY_REESTIMATE_INTERVAL, add the contacts
+		/// predicted from the periodic schedule of the link to UniboCGR
+		/// with a confidence below 1
+		void update_link_history(const LinkRef& link, bool up);
+
+		/// Table of link histories, indexed by the remote eid so that
+		/// the history survives the opportunistic links being
+		/// recreated at each encounter
+		typedef oasys::StringMap<LinkHistory> LinkHistoryMap;
+		LinkHistoryMap link_history_;
+
+		/// The contact wheel, cancelled on shutdown
+		ContactWheel* contact_wheel_;
+
 		/// Per-link class used to store deferred transmission bundles
 		/// that helps cache route computations
 		class DeferredList : public RouterInfo, public oasys::Logger {
 		public:
-			DeferredList(const char* logpath, const LinkRef& link);
+			DeferredList(const char* logpath, const LinkRef& link,
+			             DeferredIndex* index);
+
+			/// Key used to order the deferred bundles for transmission:
+			/// higher priority first, then the earlier expiration time,
+			/// then the order of arrival
+			struct OrderKey {
+				int       priority_;
+				u_int64_t deadline_;
+				u_int64_t seqno_;
+				Bundle*   bundle_;
+
+				bool operator<(const OrderKey& other) const;
+			};
+			typedef std::set<OrderKey> OrderSet;
 
 			/// Accessor for the bundle list
 			BundleList* list() { return &list_; }
 
+			/// Accessor for the bundles in transmission order, the list
+			/// lock must be held while using it
+			const OrderSet& order() { return order_; }
+
 			/// Accessor for the forwarding info associated with the
 			/// bundle, which must be on the list
 			const ForwardingInfo& info(const BundleRef& bundle);
@@ -291,10 +564,19 @@ namespace dtn {
 
 
 		protected:
-			typedef std::map<bundleid_t, ForwardingInfo> InfoMap;
+			/// Forwarding info of a bundle and its position in order_
+			struct Entry {
+				ForwardingInfo     info_;
+				OrderSet::iterator order_;
+			};
+			typedef std::map<bundleid_t, Entry> InfoMap;
 			BundleList list_;
 			InfoMap    info_;
+			OrderSet   order_;
+			u_int64_t  seqno_;
 			size_t     count_;
+			Link*      link_;  ///< not a LinkRef, the link owns this list
+			DeferredIndex* index_;
 		};
 
 		/// Helper accessor to return the deferred queue for a link
@@ -6969,6 +6969,72 @@ namespace dtn
       this->_xsd_bundle_ = bundle;
     }
 
+    const bundle_report::removed::container& bundle_report::
+    removed () const
+    {
+      return this->_xsd_removed_;
+    }
+
+    bundle_report::removed::container& bundle_report::
+    removed ()
+    {
+      return this->_xsd_removed_;
+    }
+
+    void bundle_report::
+    removed (const removed::container& removed)
+    {
+      this->_xsd_removed_ = removed;
+    }
+
+    const bundle_report::report_seq::container& bundle_report::
+    report_seq () const
+    {
+      return this->_xsd_report_seq_;
+    }
+
+    bundle_report::report_seq::container& bundle_report::
+    report_seq ()
+    {
+      return this->_xsd_report_seq_;
+    }
+
+    void bundle_report::
+    report_seq (const report_seq::type& report_seq)
+    {
+      this->_xsd_report_seq_.set (report_seq);
+    }
+
+    void bundle_report::
+    report_seq (const report_seq::container& report_seq)
+    {
+      this->_xsd_report_seq_ = report_seq;
+    }
+
+    const bundle_report::since::container& bundle_report::
+    since () const
+    {
+      return this->_xsd_since_;
+    }
+
+    bundle_report::since::container& bundle_report::
+    since ()
+    {
+      return this->_xsd_since_;
+    }
+
+    void bundle_report::
+    since (const since::type& since)
+    {
+      this->_xsd_since_.set (since);
+    }
+
+    void bundle_report::
+    since (const since::container& since)
+    {
+      this->_xsd_since_ = since;
+    }
+
 
     // bundle_attributes_query
     // 
@@ -19946,7 +20012,10 @@ namespace dtn
     bundle_report::
     bundle_report ()
     : ::xml_schema::type (),
-    _xsd_bundle_ (::xml_schema::flags (), this)
+    _xsd_bundle_ (::xml_schema::flags (), this),
+    _xsd_removed_ (::xml_schema::flags (), this),
+    _xsd_report_seq_ (::xml_schema::flags (), this),
+    _xsd_since_ (::xml_schema::flags (), this)
     {
     }
 
@@ -19957,7 +20026,16 @@ namespace dtn
     : ::xml_schema::type (_xsd_bundle_report, f, c),
     _xsd_bundle_ (_xsd_bundle_report._xsd_bundle_,
                   f | ::xml_schema::flags::not_root,
-                  this)
+                  this),
+    _xsd_removed_ (_xsd_bundle_report._xsd_removed_,
+                   f | ::xml_schema::flags::not_root,
+                   this),
+    _xsd_report_seq_ (_xsd_bundle_report._xsd_report_seq_,
+                      f | ::xml_schema::flags::not_root,
+                      this),
+    _xsd_since_ (_xsd_bundle_report._xsd_since_,
+                 f | ::xml_schema::flags::not_root,
+                 this)
     {
     }
 
@@ -19966,7 +20044,10 @@ namespace dtn
                    ::xml_schema::flags f,
                    ::xml_schema::type* c)
     : ::xml_schema::type (e, f, c),
-    _xsd_bundle_ (f | ::xml_schema::flags::not_root, this)
+    _xsd_bundle_ (f | ::xml_schema::flags::not_root, this),
+    _xsd_removed_ (f | ::xml_schema::flags::not_root, this),
+    _xsd_report_seq_ (f | ::xml_schema::flags::not_root, this),
+    _xsd_since_ (f | ::xml_schema::flags::not_root, this)
     {
       parse (e, f);
     }
@@ -19995,6 +20076,45 @@ namespace dtn
             continue;
           }
         }
+
+        // removed
+        //
+        {
+          if (e.name () == "removed" && e.namespace_ ().empty ())
+          {
+            this->removed ().push_back (
+              removed::traits::create (
+                e.dom_element (),
+                f | ::xml_schema::flags::not_root,
+                this));
+            continue;
+          }
+        }
+      }
+
+      while (p.more_attributes ())
+      {
+        const ::xsd::cxx::xml::dom::attribute< char > a (p.next_attribute ());
+
+        if (a.name () == "report_seq" && a.namespace_ ().empty ())
+        {
+          this->report_seq (
+            report_seq::traits::create (
+              a.dom_attribute (),
+              f | ::xml_schema::flags::not_root,
+              this));
+          continue;
+        }
+
+        if (a.name () == "since" && a.namespace_ ().empty ())
+        {
+          this->since (
+            since::traits::create (
+              a.dom_attribute (),
+              f | ::xml_schema::flags::not_root,
+              this));
+          continue;
+        }
       }
     }
 
@@ -25187,6 +25307,36 @@ namespace dtn
           s.dom_element () << *b;
         }
       }
+
+      {
+        for (bundle_report::removed::const_iterator
+             b (i.removed ().begin ()), n (i.removed ().end ());
+             b != n; ++b)
+        {
+          ::xsd::cxx::xml::dom::element< char > s (
+            "removed",
+            e);
+          s.dom_element () << *b;
+        }
+      }
+
+      if (i.report_seq ())
+      {
+        ::xsd::cxx::xml::dom::attribute< char > a (
+          "report_seq",
+          e);
+
+        a.dom_attribute () << *i.report_seq ();
+      }
+
+      if (i.since ())
+      {
+        ::xsd::cxx::xml::dom::attribute< char > a (
+          "since",
+          e);
+
+        a.dom_attribute () << *i.since ();
+      }
     }
 
     void
@@ -9325,6 +9325,71 @@ namespace dtn
       void
       bundle (const bundle::container&);
 
+      // removed
+      // 
+      public:
+      struct removed
+      {
+        typedef ::xml_schema::unsigned_long type;
+        typedef ::xsd::cxx::tree::traits< type, char > traits;
+        typedef ::xsd::cxx::tree::sequence< type > container;
+        typedef container::iterator iterator;
+        typedef container::const_iterator const_iterator;
+      };
+
+      const removed::container&
+      removed () const;
+
+      removed::container&
+      removed ();
+
+      void
+      removed (const removed::container&);
+
+      // report_seq
+      // 
+      public:
+      struct report_seq
+      {
+        typedef ::xml_schema::unsigned_long type;
+        typedef ::xsd::cxx::tree::traits< type, char > traits;
+        typedef ::xsd::cxx::tree::optional< type > container;
+      };
+
+      const report_seq::container&
+      report_seq () const;
+
+      report_seq::container&
+      report_seq ();
+
+      void
+      report_seq (const report_seq::type&);
+
+      void
+      report_seq (const report_seq::container&);
+
+      // since
+      // 
+      public:
+      struct since
+      {
+        typedef ::xml_schema::unsigned_long type;
+        typedef ::xsd::cxx::tree::traits< type, char > traits;
+        typedef ::xsd::cxx::tree::optional< type > container;
+      };
+
+      const since::container&
+      since () const;
+
+      since::container&
+      since ();
+
+      void
+      since (const since::type&);
+
+      void
+      since (const since::container&);
+
       // Constructors.
       //
       public:
@@ -9349,6 +9414,9 @@ namespace dtn
       parse (const ::xercesc::DOMElement&, ::xml_schema::flags);
 
       ::xsd::cxx::tree::sequence< bundle::type > _xsd_bundle_;
+      ::xsd::cxx::tree::sequence< removed::type > _xsd_removed_;
+      ::xsd::cxx::tree::optional< report_seq::type > _xsd_report_seq_;
+      ::xsd::cxx::tree::optional< since::type > _xsd_since_;
     };
 
     class bundle_attributes_query: public ::xml_schema::type
@@ -155,6 +155,14 @@ static void print_cgr_settings()
 	writeLog("Add computed route to intermediate nodes enabled.");
 #endif
 
+#if (REVERSE_ONE_ROUTE_PER_NEIGHBOR == 1)
+	writeLog("One route per neighbor computed by a single reverse search.");
+#endif
+
+#if (PROACTIVE_FRAGMENTATION == 1)
+	writeLog("Proactive fragmentation enabled.");
+#endif
+
 #if (CCSDS_SABR_DEFAULTS == 1)
 	writeLog("CCSDS SABR standard algorithm enabled.");
 #endif
@@ -719,6 +727,178 @@ static int executeCGR(CgrBundle *bundle, Node *terminusNode, List excludedNeighb
 
 }
 
+/******************************************************************************
+ *
+ * \par Function Name:
+ *  	prepare_call
+ *
+ * \brief	 Bring the contact graph to the current time: discard the routes
+ *           if the contact plan changed and remove the expired contacts.
+ *
+ *
+ * \par Date Written:
+ *  	18/10/26
+ *
+ * \return int
+ *
+ * \retval          0   Success case
+ * \retval         -2   MWITHDRAW error
+ * \retval         -5   Time is in the past
+ *
+ * \param[in]   time   The current time
+ *****************************************************************************/
+static int prepare_call(time_t time)
+{
+	int result = 0;
+
+	if(time < current_time)
+	{
+		result = -5;
+		writeLog("Error, time (%ld s) is in the past (last time: %ld s)", time, current_time);
+	}
+	else
+	{
+		if (contactPlanEditTime.tv_sec > cgrEditTime.tv_sec
+				|| (cgrEditTime.tv_sec == contactPlanEditTime.tv_sec
+						&& contactPlanEditTime.tv_usec > cgrEditTime.tv_usec))
+		{
+			if (cgrEditTime.tv_sec != -1)
+			{
+				writeLog("Contact plan modified, all routes will be discarded.");
+				discardAllRoutes();
+			}
+			cgrEditTime.tv_sec = contactPlanEditTime.tv_sec;
+			cgrEditTime.tv_usec = contactPlanEditTime.tv_usec;
+
+			if(build_local_node_neighbors_list(localNode) < 0)
+			{
+				result = -2;
+				verbose_debug_printf("Error...");
+			}
+		}
+
+		if(result == 0)
+		{
+			current_time = time;
+
+			removeExpired(current_time);
+		}
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *  	route_bundle
+ *
+ * \brief	 Get the best routes for a bundle, on the contact graph
+ *           already prepared for the current time.
+ *
+ *
+ * \par Date Written:
+ *  	18/10/26
+ *
+ * \return int
+ *
+ * \retval      ">= 0"  Success case: number of best routes found
+ * \retval         -1   There aren't routes to reach the destination.
+ * \retval         -2   MWITHDRAW error
+ * \retval         -3   Phase one error (phase one's arguments error)
+ *
+ * \param[in]   *bundle              The bundle that has to be forwarded
+ * \param[in]   excludedNeighbors    The excluded neighbors list
+ * \param[out]  *bestRoutes          If result > 0: the list of best routes, NULL otherwise
+ *
+ * \par Notes:
+ *          1.  The routes of phase one are kept in the destination's Node,
+ *              so they are computed only by the first bundle to the destination.
+ *****************************************************************************/
+static int route_bundle(CgrBundle *bundle, List excludedNeighbors, List *bestRoutes)
+{
+	int result = 0;
+	Node *terminusNode;
+
+	terminusNode = add_node(bundle->terminus_node);
+
+	if(!is_initialized_terminus_node(terminusNode))
+	{
+		// Some error in the "Node tree" management
+		terminusNode = NULL;
+	}
+
+#if (CGR_AVOID_LOOP == 1 || CGR_AVOID_LOOP == 3)
+	result = set_failed_neighbors_list(bundle, localNode);
+#endif
+	if (result >= 0 && !(RETURN_TO_SENDER(bundle)) && bundle->sender_node != 0)
+	{
+		result = excludeNeighbor(excludedNeighbors, bundle->sender_node);
+	}
+
+	parse_excluded_nodes(excludedNeighbors);
+
+#if (LOG == 1)
+	file_call = openBundleFile(count_bundles);
+	print_bundle(file_call, bundle, excludedNeighbors, current_time);
+#endif
+
+	if (terminusNode != NULL && result >= 0)
+	{
+#if (MSR == 1)
+		result = tryMSR(bundle, excludedNeighbors, file_call, bestRoutes);
+		if(result <= 0 && result != -2)
+		{
+#endif
+			result = executeCGR(bundle, terminusNode, excludedNeighbors, bestRoutes);
+#if (MSR == 1)
+		}
+#endif
+	}
+	else
+	{
+		result = -2;
+	}
+
+	closeBundleFile(&file_call);
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *  	log_best_routes_result
+ *
+ * \brief	 Write in the main log file the result of the call for a bundle
+ *
+ *
+ * \par Date Written:
+ *  	18/10/26
+ *
+ * \return void
+ *
+ * \param[in]   result       The result of the call
+ * \param[in]   bestRoutes   The best routes found
+ *****************************************************************************/
+static void log_best_routes_result(int result, List bestRoutes)
+{
+	if(result == -1)
+	{
+		writeLog("0 routes found to destination.");
+	}
+	else if(result == 0)
+	{
+		writeLog("Best routes found: 0.");
+	}
+	else if(result > 0)
+	{
+		print_result_cgr(result, bestRoutes);
+	}
+
+	return;
+}
+
 /******************************************************************************
  *
  * \par Function Name:
@@ -760,7 +940,6 @@ static int executeCGR(CgrBundle *bundle, Node *terminusNode, List excludedNeighb
 int getBestRoutes(time_t time, CgrBundle *bundle, List excludedNeighbors, List *bestRoutes)
 {
 	int result = -4;
-	Node *terminusNode;
 
 	setLogTime(time);
 
@@ -779,100 +958,118 @@ int getBestRoutes(time_t time, CgrBundle *bundle, List excludedNeighbors, List *
 			result = 0;
 			writeLog("Bundle expired.");
 		}
-		else if(time < current_time)
-		{
-			result = -5;
-			writeLog("Error, time (%ld s) is in the past (last time: %ld s)", time, current_time);
-		}
 		else
 		{
-
-			result = 0;
-
-			if (contactPlanEditTime.tv_sec > cgrEditTime.tv_sec
-					|| (cgrEditTime.tv_sec == contactPlanEditTime.tv_sec
-							&& contactPlanEditTime.tv_usec > cgrEditTime.tv_usec))
-			{
-				if (cgrEditTime.tv_sec != -1)
-				{
-					writeLog("Contact plan modified, all routes will be discarded.");
-					discardAllRoutes();
-				}
-				cgrEditTime.tv_sec = contactPlanEditTime.tv_sec;
-				cgrEditTime.tv_usec = contactPlanEditTime.tv_usec;
-
-				if(build_local_node_neighbors_list(localNode) < 0)
-				{
-					result = -2;
-					verbose_debug_printf("Error...");
-				}
-			}
+			result = prepare_call(time);
 
 			if(result == 0)
 			{
+				result = route_bundle(bundle, excludedNeighbors, bestRoutes);
+			}
+		}
 
-				current_time = time;
+		log_best_routes_result(result, *bestRoutes);
+	}
 
-				removeExpired(current_time);
+	debug_printf("result -> %d", result);
 
-				terminusNode = add_node(bundle->terminus_node);
+	count_bundles++;
 
-				if(!is_initialized_terminus_node(terminusNode))
-				{
-					// Some error in the "Node tree" management
-					terminusNode = NULL;
-				}
+	return result;
+}
 
-				result = 0;
+/******************************************************************************
+ *
+ * \par Function Name:
+ *  	startBestRoutesBatch
+ *
+ * \brief	 Start a batch of calls: bring the contact graph to the current time
+ *           once for all the bundles of the batch.
+ *
+ *
+ * \par Date Written:
+ *  	18/10/26
+ *
+ * \return int
+ *
+ * \retval          0   Success case: call getBestRoutesInBatch for each bundle
+ * \retval         -2   MWITHDRAW error
+ * \retval         -5   Time is in the past
+ *
+ * \param[in]   time   The current time
+ *
+ * \par Notes:
+ *          1.  The contact plan must not change until the end of the batch.
+ *****************************************************************************/
+int startBestRoutesBatch(time_t time)
+{
+	int result;
 
-#if (CGR_AVOID_LOOP == 1 || CGR_AVOID_LOOP == 3)
-				result = set_failed_neighbors_list(bundle, localNode);
-#endif
-				if (result >= 0 && !(RETURN_TO_SENDER(bundle)) && bundle->sender_node != 0)
-				{
-					result = excludeNeighbor(excludedNeighbors, bundle->sender_node);
-				}
+	setLogTime(time);
 
-				parse_excluded_nodes(excludedNeighbors);
+	result = prepare_call(time);
 
-#if (LOG == 1)
-				file_call = openBundleFile(count_bundles);
-				print_bundle(file_call, bundle, excludedNeighbors, current_time);
-#endif
+	debug_printf("result -> %d", result);
 
-				if (terminusNode != NULL && result >= 0)
-				{
-#if (MSR == 1)
-					result = tryMSR(bundle, excludedNeighbors, file_call, bestRoutes);
-					if(result <= 0 && result != -2)
-					{
-#endif
-						result = executeCGR(bundle, terminusNode, excludedNeighbors, bestRoutes);
-#if (MSR == 1)
-					}
-#endif
-				}
-				else
-				{
-					result = -2;
-				}
+	return result;
+}
 
-				closeBundleFile(&file_call);
-			}
-		}
+/******************************************************************************
+ *
+ * \par Function Name:
+ *  	getBestRoutesInBatch
+ *
+ * \brief	 Get the best routes list for a bundle of the batch
+ *           started by startBestRoutesBatch.
+ *
+ *
+ * \par Date Written:
+ *  	18/10/26
+ *
+ * \return int
+ *
+ * \retval      ">= 0"  Success case: number of best routes found
+ * \retval         -1   There aren't routes to reach the destination.
+ * \retval         -2   MWITHDRAW error
+ * \retval         -3   Phase one error (phase one's arguments error)
+ * \retval         -4   Arguments error
+ *
+ * \param[in]   *bundle              The bundle that has to be forwarded
+ * \param[in]   excludedNeighbors    The excluded neighbors list, the nodes to which
+ *                                   the bundle hasn't to be forwarded as "first hop"
+ * \param[out]  *bestRoutes          If result > 0: the list of best routes, NULL otherwise
+ *
+ * \par Notes:
+ *          1.  Give the bundles grouped by destination: the first bundle of the group
+ *              computes the routes of phase one, the other ones only run phase two
+ *              and three on the same routes.
+ *          2.  The bestRoutes list is valid until the next call.
+ *****************************************************************************/
+int getBestRoutesInBatch(CgrBundle *bundle, List excludedNeighbors, List *bestRoutes)
+{
+	int result = -4;
 
-		if(result == -1)
+	if (bundle != NULL && excludedNeighbors != NULL && bestRoutes != NULL)
+	{
+		*bestRoutes = NULL;
+		debug_printf("Call n.: %u", count_bundles);
+		writeLog("Destination node: %llu.", bundle->terminus_node);
+		if (check_bundle(bundle) != 0)
 		{
-			writeLog("0 routes found to destination.");
+			writeLog("Bundle bad formed.");
+			result = -4;
 		}
-		else if(result == 0)
+		else if (bundle->expiration_time < current_time) //bundle expired
 		{
-			writeLog("Best routes found: 0.");
+			result = 0;
+			writeLog("Bundle expired.");
 		}
-		else if(result > 0)
+		else
 		{
-			print_result_cgr(result, *bestRoutes);
+			result = route_bundle(bundle, excludedNeighbors, bestRoutes);
 		}
+
+		log_best_routes_result(result, *bestRoutes);
 	}
 
 	debug_printf("result -> %d", result);
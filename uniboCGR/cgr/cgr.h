@@ -51,6 +51,8 @@ extern unsigned int count_bundles;
 #endif
 
 extern int getBestRoutes(time_t time, CgrBundle *bundle, List excludedNeighbors, List *routes);
+extern int startBestRoutesBatch(time_t time);
+extern int getBestRoutesInBatch(CgrBundle *bundle, List excludedNeighbors, List *routes);
 extern int initialize_cgr(time_t time, unsigned long long ownNode);
 extern void destroy_cgr(time_t time);
 
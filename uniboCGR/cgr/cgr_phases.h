@@ -69,12 +69,14 @@ extern "C"
 #undef NEGLECT_CONFIDENCE
 #undef PERC_CONVERGENCE_LAYER_OVERHEAD
 #undef MIN_CONVERGENCE_LAYER_OVERHEAD
+#undef REVERSE_ONE_ROUTE_PER_NEIGHBOR
 
 #define CGR_AVOID_LOOP 3
 #define MAX_LOOPS_NUMBER -1
 #define QUEUE_DELAY 1
 #define MAX_DIJKSTRA_ROUTES 0
 #define ADD_COMPUTED_ROUTE_TO_INTERMEDIATE_NODES 0
+#define REVERSE_ONE_ROUTE_PER_NEIGHBOR 1
 #define NEGLECT_CONFIDENCE 0
 #ifndef MIN_CONFIDENCE_IMPROVEMENT
 #define	MIN_CONFIDENCE_IMPROVEMENT	(0.05)
@@ -105,11 +107,15 @@ extern "C"
 #undef NEGLECT_CONFIDENCE
 #undef PERC_CONVERGENCE_LAYER_OVERHEAD
 #undef MIN_CONVERGENCE_LAYER_OVERHEAD
+#undef REVERSE_ONE_ROUTE_PER_NEIGHBOR
+#undef PROACTIVE_FRAGMENTATION
 //TODO #undef MIN_CONFIDENCE_IMPROVEMENT
 
 #define CGR_AVOID_LOOP 0
 #define QUEUE_DELAY 0
 #define MAX_DIJKSTRA_ROUTES 1
+#define REVERSE_ONE_ROUTE_PER_NEIGHBOR 0
+#define PROACTIVE_FRAGMENTATION 0
 #define ADD_COMPUTE_ROUTE_TO_INTERMEDIATE_NODES 0
 #define NEGLECT_CONFIDENCE 1
 //TODO #define MIN_CONFIDENCE_IMPROVEMENT (1.0) ???
@@ -126,7 +132,8 @@ extern "C"
  *
  * \par Notes:
  *           - You could find some difference with the ION's CGR implementation like
- *             proactive fragmentation (here absent).
+ *             proactive fragmentation (here done by DTN2 on the route volume limit
+ *             computed by phase two, see PROACTIVE_FRAGMENTATION).
  *
  * \hideinitializer
  */
@@ -142,10 +149,12 @@ extern "C"
 #undef NEGLECT_CONFIDENCE
 #undef PERC_CONVERGENCE_LAYER_OVERHEAD
 #undef MIN_CONVERGENCE_LAYER_OVERHEAD
+#undef REVERSE_ONE_ROUTE_PER_NEIGHBOR
 
 #define CGR_AVOID_LOOP 0
 #define QUEUE_DELAY 0
 #define MAX_DIJKSTRA_ROUTES 1
+#define REVERSE_ONE_ROUTE_PER_NEIGHBOR 0
 #define ADD_COMPUTE_ROUTE_TO_INTERMEDIATE_NODES 0
 #define NEGLECT_CONFIDENCE 0
 #ifndef MIN_CONFIDENCE_IMPROVEMENT
@@ -286,6 +295,29 @@ extern "C"
 #define ADD_COMPUTED_ROUTE_TO_INTERMEDIATE_NODES 0
 #endif
 
+#ifndef REVERSE_ONE_ROUTE_PER_NEIGHBOR
+/**
+ * \brief Enable to compute the "one-route-per-neighbor" routes with a single reverse search.
+ *
+ * \details This is a possible enhancement provided by Unibo_CGR. Without it, the "one-route-per-neighbor"
+ *          enhancement calls Dijkstra once for each neighbor, excluding every time the neighbor just found,
+ *          so a node with k neighbors pays k full searches.
+ *          With this macro enabled, a single backward (latest departure) search is performed from the destination:
+ *          it labels each contact with the latest time at which a transmission can start on it and still reach
+ *          the destination, and with the next contact (successor) of that route. Each neighbor's route
+ *          is then built walking the successors from its first usable contact, taking for each hop the contact
+ *          between the same nodes with the earliest arrival (the labels ensure that the successor can still be used).
+ *          The routes are ordered as the Dijkstra's searches would find them, and phase two computes the
+ *          arrival times of the bundle as usual. The routes can arrive (even much) later than the Dijkstra's ones,
+ *          since the nodes crossed are the ones of the latest departure route.
+ *          - Set to 1 to pay one reverse search instead of one Dijkstra's search per neighbor.
+ *          - Set to 0 to preserve standard behavior (one Dijkstra's search per neighbor).
+ *
+ * \hideinitializer
+ */
+#define REVERSE_ONE_ROUTE_PER_NEIGHBOR 0
+#endif
+
 /******************************************************/
 
 /*******************PHASE TWO MACROS*******************/
@@ -306,6 +338,25 @@ extern "C"
 #define QUEUE_DELAY 1
 #endif
 
+#ifndef PROACTIVE_FRAGMENTATION
+/**
+ * \brief   Keep the routes that can carry only a part of a fragmentable bundle.
+ *
+ * \details Without it, phase two discards a route if the bundle doesn't fit in the window
+ *          of one of its contacts or if the bundle's EVC is greater than the effective volume limit,
+ *          so a large bundle could find no route at all.
+ *          With this macro enabled, for the bundles that can be fragmented, the route remains viable
+ *          and its route volume limit is the volume of the first fragment: phase three books only this volume
+ *          and the bundle protocol fragments the bundle proactively, each remaining fragment is routed again.
+ *          A fragment must carry more than MIN_CONVERGENCE_LAYER_OVERHEAD bytes.
+ *          - Set to 1 to enable proactive fragmentation.
+ *          - Set to 0 to discard the routes that can't carry the whole bundle (CCSDS SABR).
+ *
+ * \hideinitializer
+ */
+#define PROACTIVE_FRAGMENTATION 1
+#endif
+
 #ifndef MIN_CONFIDENCE_IMPROVEMENT
 /**
  * \brief   Lower confidence for a route.
@@ -373,6 +424,7 @@ extern int computeApplicableBacklog(unsigned long long neighbor, int priority, u
 
 /**************************** PHASE THREE ****************************/
 extern int chooseBestRoutes(CgrBundle *bundle, List candidateRoutes);
+extern double get_route_volume(CgrBundle *bundle, Route *route);
 /*********************************************************************/
 
 #if (LOG == 1)
@@ -407,6 +459,12 @@ fatal error
 // ADD_COMPUTED_ROUTE_TO_INTERMEDIATE_NODES must be 0 or 1
 #endif
 
+#if (REVERSE_ONE_ROUTE_PER_NEIGHBOR != 0 && REVERSE_ONE_ROUTE_PER_NEIGHBOR != 1)
+fatal error
+// Intentional compilation error
+// REVERSE_ONE_ROUTE_PER_NEIGHBOR must be 0 or 1.
+#endif
+
 #if (QUEUE_DELAY != 0 && QUEUE_DELAY != 1)
 fatal error
 // Intentional compilation error
@@ -23,6 +23,20 @@
 #include "../routes/routes.h"
 #include "cgr_phases.h"
 
+#if (defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__))
+/**
+ * \brief Compile the function also for the AVX2 and SSE4.2 instruction sets, the version
+ *        to use is chosen at run time (CPUID); the "default" one is the scalar fallback.
+ *
+ * \details The loops of the function are vectorized even at -O2.
+ *          SSE2 alone can't compare 64 bits integers (time_t), so the scalar fallback.
+ */
+#define VECTOR_CLONES __attribute__((target_clones("avx2", "sse4.2", "default"), \
+		optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#else
+#define VECTOR_CLONES
+#endif
+
 /**
  * \brief List of unsigned long long, for each neighbor in this list we already have a computed
  *        route (selectedRoutes)
@@ -62,7 +76,7 @@ typedef enum
 {
 	ClearTotally = 1, // Clear all the graph to known values
 	ClearPartially = 2, // Keep in mind the previous range found or not found
-	ClearYen = 3 // ClearPartially and keep suppress the contact's with suppressed field equals to 2
+	ClearYen = 3 // ClearPartially and keep suppress the contact's with suppressed field greater than 1
 } ClearRule;
 
 typedef enum
@@ -249,32 +263,33 @@ void reset_phase_one()
  *****************************************************************************/
 static void clear_work_areas(ClearRule rule)
 {
-	Contact *current;
-	RbtNode *node;
+	DenseContacts dense;
 	ContactNote *work;
+	unsigned int i, count;
 
-	current = get_first_contact(&node);
-	while (current != NULL)
+	count = get_contacts_dense_arrays(&dense);
+	for (i = 0; i < count; i++)
 	{
-		work = current->routingObject;
+		work = &(dense.notes[i]);
 		work->predecessor = NULL;
 		if(rule == ClearTotally)
 		{
-			work->suppressed = 0;
+			dense.suppressed[i] = 0;
 			work->rangeFlag = 0;
 			work->owlt = 0;
 		}
-		else if(rule == ClearPartially || work->suppressed == Suppressed)
+		else if(rule == ClearPartially || dense.suppressed[i] == Suppressed)
 		{
-			work->suppressed = 0;
+			dense.suppressed[i] = 0;
 		}
 
-		work->visited = 0;
+		dense.visited[i] = 0;
 		work->owltSum = 0;
-		work->arrivalTime = MAX_POSIX_TIME;
+		dense.arrivalTime[i] = MAX_POSIX_TIME;
 		work->hopCount = 0;
 		work->arrivalConfidence = 1.0F;
-		current = get_next_contact(&node);
+		work->successor = NULL;
+		work->latestDeparture = -1;
 	}
 
 	if(rule == ClearTotally)
@@ -482,60 +497,53 @@ static int populate_route(Contact *finalContact, Contact *rootContact, Route *re
 {
 	int result = 0;
 	time_t earliestEndTime;
-	Contact *contact, *firstContact = NULL;
-	ContactNote *current_work;
-	ListElt *elt;
+	Contact *contact;
+	unsigned int hop;
+	DenseContacts dense;
+
+	get_contacts_dense_arrays(&dense);
 
-	resultRoute->arrivalTime = finalContact->routingObject->arrivalTime;
+	resultRoute->arrivalTime = dense.arrivalTime[finalContact->id];
 	resultRoute->arrivalConfidence = finalContact->routingObject->arrivalConfidence;
 	resultRoute->owltSum = finalContact->routingObject->owltSum;
 	resultRoute->computedAtTime = current_time;
 
-	earliestEndTime = MAX_POSIX_TIME;
-	contact = finalContact;
-
-	while (contact != &graphRoot)
+	hop = 0;
+	for (contact = finalContact; contact != &graphRoot; contact = contact->routingObject->predecessor)
 	{
-		current_work = contact->routingObject;
-		if (contact->toTime < earliestEndTime)
-		{
-			earliestEndTime = contact->toTime;
-		}
+		hop++;
+	}
 
-		elt = list_insert_first(resultRoute->hops, contact);
+	if (allocate_route_hops(resultRoute, hop) < 0)
+	{
+		result = -2;
+	}
+	else
+	{
+		earliestEndTime = MAX_POSIX_TIME;
+		resultRoute->rootOfSpur = NO_ROOT_OF_SPUR;
 
-		if (elt == NULL)
-		{
-			result = -2;
-			contact = NULL; //I leave the loop
-		}
-		else
+		for (contact = finalContact; contact != &graphRoot; contact = contact->routingObject->predecessor)
 		{
-			if (contact == rootContact)
+			hop--;
+			if (contact->toTime < earliestEndTime)
 			{
-				//Spur route
-				resultRoute->rootOfSpur = elt;
+				earliestEndTime = contact->toTime;
 			}
 
-			elt = list_insert_last(contact->citations, elt);
+			resultRoute->hops[hop].contact = contact;
 
-			if (elt == NULL)
-			{
-				result = -2;
-				contact = NULL; //I leave the loop
-			}
-			else
+			if (contact == rootContact)
 			{
-				firstContact = contact;
-				contact = current_work->predecessor;
+				//Spur route
+				resultRoute->rootOfSpur = (int) hop;
 			}
 		}
-	}
 
-	if (result == 0)
-	{
-		resultRoute->neighbor = firstContact->toNode;
-		resultRoute->fromTime = firstContact->fromTime;
+		result = cite_route_hops(resultRoute);
+
+		resultRoute->neighbor = ROUTE_HOP(resultRoute, 0)->toNode;
+		resultRoute->fromTime = ROUTE_HOP(resultRoute, 0)->fromTime;
 		resultRoute->toTime = earliestEndTime;
 	}
 
@@ -559,12 +567,17 @@ static int populate_route(Contact *finalContact, Contact *rootContact, Route *re
  * \retval   0	The two edges have the same cost
  * \retval   1	The first edge has a greater cost than the second edge
  *
+ * \param[in]		firstArrivalTime		The arrival time of the first edge
  * \param[in]		*first		The first edge
+ * \param[in]		secondArrivalTime		The arrival time of the second edge
  * \param[in]		*second		The second edge
  *
  * \warning first doesn't have to be NULL.
  * \warning second doesn't have to be NULL.
  *
+ * \par Notes:
+ *          1.  The arrival times aren't in the ContactNotes, see DenseContacts.
+ *
  *
  * \par Revision History:
  *
@@ -572,15 +585,16 @@ static int populate_route(Contact *finalContact, Contact *rootContact, Route *re
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static int compare_dijkstra_edges(ContactNote *first, ContactNote *second)
+static int compare_dijkstra_edges(time_t firstArrivalTime, ContactNote *first,
+		time_t secondArrivalTime, ContactNote *second)
 {
 	int result = 1;
 
-	if (first->arrivalTime < second->arrivalTime)
+	if (firstArrivalTime < secondArrivalTime)
 	{
 		result = -1;
 	}
-	else if (first->arrivalTime == second->arrivalTime)
+	else if (firstArrivalTime == secondArrivalTime)
 	{
 		if (first->hopCount < second->hopCount)
 		{
@@ -656,73 +670,76 @@ static int compare_dijkstra_edges(ContactNote *first, ContactNote *second)
 static void compute_new_distances(Contact *current)
 {
 	int go_to_next = 0;
-	Contact *contact;
-	RbtNode *rbtNode;
+	unsigned int i, count;
 	unsigned int owlt;
 	unsigned int owltMargin;
-	time_t earliestTransmissionTime;
+	unsigned long long fromNode = current->toNode;
+	time_t earliestTransmissionTime, currentArrivalTime, arrivalTime;
 	ContactNote *work, *currentWork, tempWork;
+	DenseContacts dense;
 
 	currentWork = current->routingObject;
 
-	for (contact = get_first_contact_from_node(current->toNode, &rbtNode); contact != NULL;
-			contact = get_next_contact(&rbtNode))
+	count = get_contacts_dense_arrays(&dense);
+	currentArrivalTime = (current == &graphRoot) ? current_time : dense.arrivalTime[current->id];
+
+	// the contacts from the same node have consecutive ids
+	for (i = get_first_dense_contact_from_node(fromNode); i < count && dense.fromNode[i] == fromNode; i++)
 	{
-		if (contact->fromNode != current->toNode)
-		{
-			rbtNode = NULL; //I leave the loop
-		}
-		else if ((contact->toNode != current->fromNode && contact->fromNode != contact->toNode)
+		if ((dense.toNode[i] != current->fromNode && dense.fromNode[i] != dense.toNode[i])
 				|| (current == &graphRoot))
 		{
 			//don't route back and permits loopback
 			//only for the local node (SABR)
-			work = contact->routingObject;
+			work = &(dense.notes[i]);
 
-			if(work->suppressed == SuppressedFromNodeForYenLoop)
+			if(dense.suppressed[i] == SuppressedFromNodeForYenLoop)
 			{
 				// The work is suppressed due to a Yen loop caused by the fromNode,
 				// All the contacts in this loop will have the same fromNode so
 				// all contacts will be suppressed due to a Yen loop caused by the fromNode,
 				// stop the loop and remember this for the currentWork in the next iterations
 				// of the Yen's algotithm
-				currentWork->suppressed = SuppressedToNodeForYenLoop;
-				rbtNode = NULL;
+				if (current != &graphRoot)
+				{
+					dense.suppressed[current->id] = SuppressedToNodeForYenLoop;
+				}
+				i = count; //I leave the loop
 			}
-			else if (!work->suppressed && !work->visited)
+			else if (!dense.suppressed[i] && !dense.visited[i])
 			{
-				earliestTransmissionTime = contact->fromTime;
+				earliestTransmissionTime = dense.fromTime[i];
 				if (current == &graphRoot)
 				{
-					if (contact->fromTime < current_time) //SABR 3.2.4.1.1
+					if (dense.fromTime[i] < current_time) //SABR 3.2.4.1.1
 					{
 						earliestTransmissionTime = current_time;
 					}
-					if (neighbor_is_excluded(contact->toNode))
+					if (neighbor_is_excluded(dense.toNode[i]))
 					{
 						//helpful for "one route per neighbor"
-						work->suppressed = Suppressed;
+						dense.suppressed[i] = Suppressed;
 						go_to_next = 1;
 					}
 #if (NEGLECT_CONFIDENCE == 0 && REVISABLE_CONFIDENCE == 0)
-					else if (contact->confidence < 1.0F)
+					else if (dense.confidence[i] < 1.0F)
 					{
 						// first hop must be certain
-						work->suppressed = Suppressed;
+						dense.suppressed[i] = Suppressed;
 						go_to_next = 1;
 					}
 #endif
 				}
-				else if (contact->fromTime < currentWork->arrivalTime) //SABR 3.2.4.1.1
+				else if (dense.fromTime[i] < currentArrivalTime) //SABR 3.2.4.1.1
 				{
-					earliestTransmissionTime = currentWork->arrivalTime;
+					earliestTransmissionTime = currentArrivalTime;
 				}
 
 				if (go_to_next)
 				{
 					go_to_next = 0; //reset for the next iteration
 				}
-				else if (contact->toTime > earliestTransmissionTime)
+				else if (dense.toTime[i] > earliestTransmissionTime)
 				{
 					// in phase one we search the range ALWAYS at the start time of the contact
 					// this depends on the destination's neighbors management.
@@ -731,10 +748,10 @@ static void compute_new_distances(Contact *current)
 
 					if (work->rangeFlag == RangeNotFound
 							|| (work->rangeFlag == RangeNotSearched
-									&& get_applicable_range(contact->fromNode, contact->toNode, contact->fromTime, &owlt) < 0))
+									&& get_applicable_range(dense.fromNode[i], dense.toNode[i], dense.fromTime[i], &owlt) < 0))
 					{
 						work->rangeFlag = RangeNotFound; //range not found at start time, this contact cannot be used to compute a route
-						work->suppressed = Suppressed;
+						dense.suppressed[i] = Suppressed;
 					}
 					//if rangeFlag == RangeFound, we use the work->owlt
 					else
@@ -746,22 +763,22 @@ static void compute_new_distances(Contact *current)
 						owltMargin = ((MAX_SPEED_MPH / 3600) * owlt) / 186282;
 						owlt += owltMargin;
 
-						tempWork.arrivalTime = earliestTransmissionTime + owlt;
+						arrivalTime = earliestTransmissionTime + owlt;
 
 						tempWork.owltSum = owlt + currentWork->owltSum;
 						tempWork.hopCount = currentWork->hopCount;
-						tempWork.arrivalConfidence = contact->confidence
+						tempWork.arrivalConfidence = dense.confidence[i]
 								* currentWork->arrivalConfidence;
 
-						if (contact->toNode != contact->fromNode)
+						if (dense.toNode[i] != dense.fromNode[i])
 						{
 							tempWork.hopCount += 1;
 						}
 
-						if (compare_dijkstra_edges(&tempWork, work) < 0)
+						if (compare_dijkstra_edges(arrivalTime, &tempWork, dense.arrivalTime[i], work) < 0)
 						{
 							//found a new lower distance
-							work->arrivalTime = tempWork.arrivalTime;
+							dense.arrivalTime[i] = arrivalTime;
 							work->hopCount = tempWork.hopCount;
 							work->owltSum = tempWork.owltSum;
 							work->predecessor = current;
@@ -773,11 +790,64 @@ static void compute_new_distances(Contact *current)
 		}
 	}
 
-	currentWork->visited = 1;
+	if (current != &graphRoot)
+	{
+		dense.visited[current->id] = 1;
+	}
 
 	return;
 }
 
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		find_earliest_arrival_time
+ *
+ * \brief Dijkstra's algorithm second loop, first pass: the earliest arrival time
+ *        in the unvisited set
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return time_t
+ *
+ * \retval time_t  The earliest arrival time, MAX_POSIX_TIME if there isn't any contact
+ *                 with a finite distance in the unvisited set
+ *
+ * \param[in]  count            The number of contacts in the dense arrays
+ * \param[in]  *dense           The dense arrays of the contacts
+ * \param[in]  loopbackAllowed  Set to 1 if the loopback contacts can be chosen
+ *
+ * \par Notes:
+ *          1.  The loop has no branches and reads only the arrivalTime, suppressed,
+ *              visited, fromNode and toNode arrays, so that it can be vectorized (VECTOR_CLONES).
+ *          2.  A loopback contact is reached only from the graph's root (see compute_new_distances),
+ *              so fromNode == toNode is the same as hopCount == 0 for the contacts with a finite distance.
+ *****************************************************************************/
+static VECTOR_CLONES time_t find_earliest_arrival_time(unsigned int count, const DenseContacts *dense,
+		int loopbackAllowed)
+{
+	const time_t *arrivalTime = dense->arrivalTime;
+	const int *suppressed = dense->suppressed;
+	const int *visited = dense->visited;
+	const unsigned long long *fromNode = dense->fromNode;
+	const unsigned long long *toNode = dense->toNode;
+	unsigned int i;
+	time_t candidate, key, bestArrivalTime = MAX_POSIX_TIME;
+
+	for (i = 0; i < count; i++)
+	{
+		candidate = (suppressed[i] == 0) & (visited[i] == 0)
+				& ((fromNode[i] != toNode[i]) | loopbackAllowed);
+		// candidate ? arrivalTime[i] : MAX_POSIX_TIME
+		key = (arrivalTime[i] & -candidate) | (MAX_POSIX_TIME & (candidate - 1));
+		bestArrivalTime = (key < bestArrivalTime) ? key : bestArrivalTime;
+	}
+
+	return bestArrivalTime;
+}
+
 /******************************************************************************
  *
  * \par Function Name:
@@ -805,6 +875,11 @@ static void compute_new_distances(Contact *current)
  * \par Notes:
  *             1. This is a modified Dijkstra's algorithm, so we have even the
  *                excluded set and not excluded set (ContactNote's suppressed field)
+ *             2. The first loop has no branches so that the compiler can vectorize it
+ *                (see find_earliest_arrival_time), the (branchy) comparison is done only
+ *                for the few contacts that have the earliest arrival time.
+ *             3. Full ties are broken by the contact's key (compare_contacts), so the
+ *                result doesn't depend on the position of the contacts in the dense arrays.
  *
  *
  *
@@ -816,33 +891,41 @@ static void compute_new_distances(Contact *current)
  *****************************************************************************/
 static Contact* find_best_contact(unsigned long long toNode)
 {
-	Contact *contact;
-	RbtNode *rbtNode = NULL;
+	DenseContacts dense;
 	ContactNote *work, tempWork;
+	unsigned int i, count;
+	int loopbackAllowed, cmp;
+	time_t bestArrivalTime, tempArrivalTime = MAX_POSIX_TIME;
 
-	tempWork.arrivalTime = MAX_POSIX_TIME;
 	tempWork.hopCount = UINT_MAX;
 	tempWork.owltSum = UINT_MAX;
 	tempWork.predecessor = NULL;
 	tempWork.arrivalConfidence = 0.0F;
 
-	for (contact = get_first_contact(&rbtNode); contact != NULL;
-			contact = get_next_contact(&rbtNode))
+	loopbackAllowed = (toNode == localNode); //loopback only for the local node
+
+	count = get_contacts_dense_arrays(&dense);
+
+	// First pass, without branches: the earliest arrival time in the unvisited set
+	bestArrivalTime = find_earliest_arrival_time(count, &dense, loopbackAllowed);
+
+	// Second pass: the tie-break keys only for the contacts with the earliest arrival time
+	for (i = 0; i < count && bestArrivalTime != MAX_POSIX_TIME; i++)
 	{
-		work = contact->routingObject;
+		work = &(dense.notes[i]);
 
-		if (!(work->suppressed) && !(work->visited) && work->arrivalTime != MAX_POSIX_TIME)
+		if (dense.arrivalTime[i] == bestArrivalTime && !(dense.suppressed[i]) && !(dense.visited[i])
+				&& (dense.fromNode[i] != dense.toNode[i] || loopbackAllowed))
 		{
-			if (work->hopCount != 0 || toNode == localNode) //loopback only for the local node
+			cmp = compare_dijkstra_edges(dense.arrivalTime[i], work, tempArrivalTime, &tempWork);
+			if (cmp < 0 || (cmp == 0 && tempWork.predecessor != NULL
+					&& compare_contacts(dense.contact[i], tempWork.predecessor) < 0))
 			{
-				if (compare_dijkstra_edges(work, &tempWork) < 0)
-				{
-					tempWork.predecessor = contact;
-					tempWork.arrivalTime = work->arrivalTime;
-					tempWork.hopCount = work->hopCount;
-					tempWork.owltSum = work->owltSum;
-					tempWork.arrivalConfidence = work->arrivalConfidence;
-				}
+				tempWork.predecessor = dense.contact[i];
+				tempArrivalTime = dense.arrivalTime[i];
+				tempWork.hopCount = work->hopCount;
+				tempWork.owltSum = work->owltSum;
+				tempWork.arrivalConfidence = work->arrivalConfidence;
 			}
 		}
 	}
@@ -953,14 +1036,12 @@ static int dijkstra_search(Contact *rootContact, unsigned long long toNode, Rout
  *****************************************************************************/
 static int update_cost_values(Route *route)
 {
-	ListElt *elt, *first;
 	Contact *contact;
 	time_t arrivalTime, earliestTransmissionTime;
-	unsigned int owlt, owltMargin, owltSum;
+	unsigned int owlt, owltMargin, owltSum, hop;
 	int result = 0;
 
-	first = route->hops->first;
-	contact = (Contact*) first->data;
+	contact = ROUTE_HOP(route, 0);
 	route->arrivalTime = 0;
 	route->owltSum = 0;
 	owlt = 1;
@@ -996,7 +1077,7 @@ static int update_cost_values(Route *route)
 
 		arrivalTime = earliestTransmissionTime + owlt;
 
-		for (elt = first->next; elt != NULL && result == 0; elt = elt->next)
+		for (hop = 1; hop < route->hopsCount && result == 0; hop++)
 		{
 			owlt = 1;
 			earliestTransmissionTime =
@@ -1095,11 +1176,11 @@ static Route* get_best_known_route(RtgObject *rtgObj, unsigned long long neighbo
 				}
 				else if (bestRoute->arrivalTime == current->arrivalTime)
 				{
-					if (bestRoute->hops->length > current->hops->length)
+					if (bestRoute->hopsCount > current->hopsCount)
 					{
 						bestRoute = current;
 					}
-					else if (bestRoute->hops->length == current->hops->length)
+					else if (bestRoute->hopsCount == current->hopsCount)
 					{
 						if (bestRoute->owltSum > current->owltSum)
 						{
@@ -1163,24 +1244,18 @@ static Route* get_best_known_route(RtgObject *rtgObj, unsigned long long neighbo
  *****************************************************************************/
 static void suppress_root_path_ipn_node(unsigned long long fromNode)
 {
-	int stop = 0;
-	Contact *contact;
-	RbtNode *rbtNode;
+	DenseContacts dense;
+	unsigned int i, count;
+
+	count = get_contacts_dense_arrays(&dense);
 
-	for (contact = get_first_contact_from_node(fromNode, &rbtNode);
-			contact != NULL && !stop; contact = get_next_contact(&rbtNode))
+	// the contacts from the same node have consecutive ids
+	for (i = get_first_dense_contact_from_node(fromNode); i < count && dense.fromNode[i] == fromNode; i++)
 	{
-		if (contact->fromNode != fromNode)
-		{
-			stop = 1;
-		}
-		else
-		{
-			//We want to exclude this contact even for the successive iteration
-			//of Yen's algorithm on the current route
-			//for this reason we set a distinguishable suppressed flag
-			contact->routingObject->suppressed = SuppressedFromNodeForYenLoop;
-		}
+		//We want to exclude this contact even for the successive iteration
+		//of Yen's algorithm on the current route
+		//for this reason we set a distinguishable suppressed flag
+		dense.suppressed[i] = SuppressedFromNodeForYenLoop;
 	}
 
 	return;
@@ -1193,7 +1268,7 @@ static void suppress_root_path_ipn_node(unsigned long long fromNode)
  *
  * \brief Initialize all the values of the edges in the Yen's root path,
  *        and adds to the excluded set the spur nodes except
- *        the node pointed by rootOfSpur->data
+ *        the sender node of the root of spur
  *
  *
  * \par Date Written:
@@ -1206,13 +1281,15 @@ static void suppress_root_path_ipn_node(unsigned long long fromNode)
  * \retval  -2  The best-case delivery time (arrivalTime) for at least one
  *              contact is greater than the end time of the contact.
  *
- * \param[in]  *rootOfSpur        The last hop of the Yen's root path
+ * \param[in]  *fromRoute         The route from which we take the Yen's root path
+ * \param[in]  rootOfSpur         The index of the last hop of the Yen's root path
  * \param[in]  isFirstSpurRoute   Used to know if it is the first spur route that we
  *                                are computing during the current iteration of the Yen's algorithm.
  *                                This argument is used to suppress the root path nodes that
  *                                will cause a loop during the Dijkstra's search.
  *
- * \warning rootOfSpur doesn't have to be NULL.
+ * \warning fromRoute doesn't have to be NULL.
+ * \warning rootOfSpur has to be a valid hop index.
  *
  * \par Revision History:
  *
@@ -1220,35 +1297,35 @@ static void suppress_root_path_ipn_node(unsigned long long fromNode)
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
+static int initialize_root_path(Route *fromRoute, int rootOfSpur, int isFirstSpurRoute)
 {
 	Contact *contact, *rootOfSpurContact, *prevContact;
-	ListElt *elt, *first;
 	ContactNote *work = NULL;
 	unsigned int owlt = 0, owltSum = 0;
 	float arrivalConfidence = 1.0F;
-	time_t transmitTime;
+	time_t transmitTime, arrivalTime = 0;
 	unsigned int hop = 0;
-	int result = 0;
+	int result = 0, stop = 0;
+	DenseContacts dense;
 
-	rootOfSpurContact = (Contact*) rootOfSpur->data;
+	get_contacts_dense_arrays(&dense);
+
+	rootOfSpurContact = ROUTE_HOP(fromRoute, rootOfSpur);
 	prevContact = &graphRoot;
-	first = rootOfSpur->list->first;
 
-	elt = first;
-	while (elt != NULL)
+	while (!stop)
 	{
-		contact = (Contact*) elt->data;
+		contact = ROUTE_HOP(fromRoute, hop);
 
-		if (elt == first)
+		if (hop == 0)
 		{
 			transmitTime = (contact->fromTime > current_time) ? contact->fromTime : current_time;
 		}
 		else
 		{
-			//work is referred to the previous contact
+			//arrivalTime is referred to the previous contact
 			transmitTime =
-					(contact->fromTime > work->arrivalTime) ? contact->fromTime : work->arrivalTime;
+					(contact->fromTime > arrivalTime) ? contact->fromTime : arrivalTime;
 		}
 
 		work = contact->routingObject;
@@ -1264,7 +1341,7 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 		if (transmitTime > contact->toTime)
 		{
 			result = -2;
-			elt = NULL;
+			stop = 1;
 			verbose_debug_printf("The transmit time is greater than the arrivalTime\n");
 		}
 		// in phase one we search the range ALWAYS at the start time of the contact
@@ -1275,7 +1352,7 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 		{
 			work->rangeFlag = RangeNotFound;
 			result = -1;
-			elt = NULL;
+			stop = 1;
 			verbose_debug_printf("Range not found.\n");
 		}
 		else
@@ -1285,7 +1362,8 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 			work->rangeFlag = RangeFound;
 
 			owlt += ((MAX_SPEED_MPH / 3600) * owlt) / 186282;
-			work->arrivalTime = transmitTime + owlt;
+			arrivalTime = transmitTime + owlt;
+			dense.arrivalTime[contact->id] = arrivalTime;
 			owltSum += owlt;
 			work->owltSum = owltSum;
 			arrivalConfidence *= contact->confidence;
@@ -1296,11 +1374,10 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 			prevContact = contact;
 
 			//This contacts will be suppressed also for the next spur routes
-			work->suppressed = SuppressedFromNodeForYenLoop;
+			dense.suppressed[contact->id] = SuppressedFromNodeForYenLoop;
 
 			if (contact != rootOfSpurContact) //Important check
 			{
-				elt = elt->next;
 				if(isFirstSpurRoute)
 				{
 					// Only for the first spur route, for the other spur routes
@@ -1311,7 +1388,7 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 			}
 			else
 			{
-				elt = NULL;
+				stop = 1;
 				// suppress the root vertex node
 				suppress_root_path_ipn_node(contact->fromNode);
 			}
@@ -1322,7 +1399,7 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
 	if (result < 0)
 	{
 		//don't compute a route from this root path
-		rootOfSpurContact->routingObject->arrivalTime = MAX_POSIX_TIME;
+		dense.arrivalTime[rootOfSpurContact->id] = MAX_POSIX_TIME;
 	}
 
 	return result;
@@ -1346,10 +1423,12 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
  * \return void
  *
  * \param[in]   *terminusNode  The Node from which we get the Yen's "list A" (selectedRoutes)
- * \param[in]   *rootOfSpur    The last hop of the Yen's root path
+ * \param[in]   *fromRoute     The route from which we take the Yen's root path
+ * \param[in]   rootOfSpur     The index of the last hop of the Yen's root path,
+ *                             NO_ROOT_OF_SPUR for an empty root path
  *
  * \warning terminusNode doesn't have to be NULL.
- * \warning rootOfSpur doesn't have to be NULL.
+ * \warning fromRoute doesn't have to be NULL.
  *
  * \par Revision History:
  *
@@ -1357,58 +1436,34 @@ static int initialize_root_path(ListElt *rootOfSpur, int isFirstSpurRoute)
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static void avoid_duplicate_routes(Node *terminusNode, ListElt *rootOfSpur)
+static void avoid_duplicate_routes(Node *terminusNode, Route *fromRoute, int rootOfSpur)
 {
-	int stop = 0;
+	int hop, sameRootPath;
 	RtgObject *rtgObj = terminusNode->routingObject;
-	ListElt *elt, *temp, *rootPathContactElt;
+	ListElt *elt;
 	Contact *suppressMe;
 	Route *route;
-	List hops;
+	DenseContacts dense;
+
+	get_contacts_dense_arrays(&dense);
 
 	for (elt = list_get_first_elt(rtgObj->selectedRoutes); elt != NULL; elt = elt->next)
 	{
 		route = (Route*) elt->data;
 
-		if (rootOfSpur == NULL)
+		// the routes that share the root path, up to the root of spur included
+		sameRootPath = ((int) route->hopsCount > rootOfSpur + 1);
+		for (hop = 0; hop <= rootOfSpur && sameRootPath; hop++)
 		{
-			temp = list_get_first_elt(route->hops);
-			suppressMe = (Contact*) temp->data;
-			if(suppressMe->routingObject->suppressed == NotSuppressed) //just for safety
-			{
-				suppressMe->routingObject->suppressed = Suppressed;
-			}
+			sameRootPath = (ROUTE_HOP(route, hop) == ROUTE_HOP(fromRoute, hop));
 		}
-		else
+
+		if (sameRootPath)
 		{
-			hops = rootOfSpur->list;
-			stop = 0;
-			rootPathContactElt = list_get_first_elt(hops);
-			for (temp = list_get_first_elt(route->hops); temp != NULL && !stop; temp = temp->next)
+			suppressMe = ROUTE_HOP(route, rootOfSpur + 1); //suppress next contact
+			if(dense.suppressed[suppressMe->id] == NotSuppressed) //just for safety
 			{
-				if (temp->data == rootPathContactElt->data) //same contact
-				{
-					if (rootPathContactElt == rootOfSpur) //same root path
-					{
-						if (temp->next != NULL)
-						{
-							suppressMe = (Contact*) temp->next->data; //suppress next contact
-							if(suppressMe->routingObject->suppressed == NotSuppressed) //just for safety
-							{
-								suppressMe->routingObject->suppressed = Suppressed;
-							}
-						}
-						stop = 1;
-					}
-					else //same partial root path
-					{
-						rootPathContactElt = rootPathContactElt->next;
-					}
-				}
-				else //different root path
-				{
-					stop = 1;
-				}
+				dense.suppressed[suppressMe->id] = Suppressed;
 			}
 		}
 
@@ -1491,7 +1546,8 @@ void remove_neighbor_from_known_routes(List knownRoutes, unsigned long long neig
  * \param[in]    isFirstSpurRoute  Set to 1 if it's the first spur route computed during
  *                                 the current Yen's algorithm on fromRoute.
  *                                 Set to 0 otherwise.
- * \param[in]    *rootOfSpur       The hop of the fromRoute from which we compute the new Route
+ * \param[in]    rootOfSpur        The index of the hop of the fromRoute from which we compute
+ *                                 the new Route, NO_ROOT_OF_SPUR to start from the graph root
  * \param[in]    *fromRoute        The Route that we consider as "father" of the new Route
  * \param[out]   *resultRoute      The Route computed
  *
@@ -1510,7 +1566,7 @@ void remove_neighbor_from_known_routes(List knownRoutes, unsigned long long neig
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, ListElt *rootOfSpur, Node *terminusNode,
+static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, int rootOfSpur, Node *terminusNode,
 		Route *resultRoute)
 {
 	int result = 0;
@@ -1534,15 +1590,15 @@ static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, ListElt *r
 		clear_work_areas(ClearYen);
 	}
 
-	if (rootOfSpur == NULL)
+	if (rootOfSpur == NO_ROOT_OF_SPUR)
 	{
 		rootOfSpurContact = &graphRoot;
 	}
 	else
 	{
-		rootOfSpurContact = (Contact*) rootOfSpur->data;
+		rootOfSpurContact = ROUTE_HOP(fromRoute, rootOfSpur);
 
-		if (initialize_root_path(rootOfSpur, isFirstSpurRoute) < 0)
+		if (initialize_root_path(fromRoute, rootOfSpur, isFirstSpurRoute) < 0)
 		{
 			result = -3; //the root path can't be used
 		}
@@ -1550,7 +1606,7 @@ static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, ListElt *r
 
 	if (result == 0)
 	{
-		avoid_duplicate_routes(terminusNode, rootOfSpur);
+		avoid_duplicate_routes(terminusNode, fromRoute, rootOfSpur);
 
 		result = dijkstra_search(rootOfSpurContact, terminusNode->nodeNbr, resultRoute);
 
@@ -1593,8 +1649,9 @@ static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, ListElt *r
  *
  * \param[in]   *fromRoute          The Route that we consider as "father" of the new Route
  * \param[in]   *terminusNode       The Node for which we want to compute a Route
- * \param[in]   upperBound          Set to != NULL if you want to stop Yen's algorithm
- *                                  when you reach the upperBound as "next root of spur"
+ * \param[in]   upperBound          Set to a hop index if you want to stop Yen's algorithm
+ *                                  when you reach the upperBound as "next root of spur",
+ *                                  NO_ROOT_OF_SPUR otherwise
  * \param[out]  *allNeighborsFound  Boolean: 1 if we have a computed route for each neighbor,
  *                                  0 otherwise
  *
@@ -1618,13 +1675,14 @@ static int compute_spur_route(Route *fromRoute, int isFirstSpurRoute, ListElt *r
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static int compute_all_spurs(Route *fromRoute, Node *terminusNode, ListElt *upperBound, int *allNeighborsFound)
+static int compute_all_spurs(Route *fromRoute, Node *terminusNode, int upperBound, int *allNeighborsFound)
 {
 
 	int result = 0, stop = 0;
 	int ok, created = 0;
 	int isFirstSpurRoute;
-	ListElt *rootOfNextSpur, *rootOfSpur, *elt = NULL;
+	int rootOfSpur;
+	ListElt *elt = NULL;
 	Route *last_computed_route = NULL;
 	RtgObject *rtgObj = NULL;
 	unsigned long long *current = NULL;
@@ -1636,9 +1694,9 @@ static int compute_all_spurs(Route *fromRoute, Node *terminusNode, ListElt *uppe
 
 	rootOfSpur = fromRoute->rootOfSpur;
 
-	if (fromRoute->rootOfSpur == NULL)
+	if (fromRoute->rootOfSpur == NO_ROOT_OF_SPUR)
 	{
-		// Only for a route computed from the graph root (so rootOfSpur is NULL)
+		// Only for a route computed from the graph root
 		for (elt = excludedNeighbors->first; elt != NULL && !stop; elt = elt->next)
 		{
 			current = (unsigned long long*) elt->data;
@@ -1650,12 +1708,6 @@ static int compute_all_spurs(Route *fromRoute, Node *terminusNode, ListElt *uppe
 				stop = 1;
 			}
 		}
-
-		rootOfNextSpur = list_get_first_elt(fromRoute->hops);
-	}
-	else
-	{
-		rootOfNextSpur = rootOfSpur->next;
 	}
 
 	rtgObj = terminusNode->routingObject;
@@ -1734,7 +1786,7 @@ static int compute_all_spurs(Route *fromRoute, Node *terminusNode, ListElt *uppe
 				stop = 1;
 				verbose_debug_printf("Yen's algorithm must be stopped for the current route.");
 			}
-			else if(rootOfSpur == NULL)
+			else if(rootOfSpur == NO_ROOT_OF_SPUR)
 			{
 				//We have a route for all neighbors
 				//Here we done a search from the graph's root and
@@ -1745,12 +1797,8 @@ static int compute_all_spurs(Route *fromRoute, Node *terminusNode, ListElt *uppe
 
 			if (!otherNeighbor)
 			{
-				rootOfSpur = rootOfNextSpur;
-				if (rootOfSpur != fromRoute->hops->last && rootOfSpur != upperBound)
-				{
-					rootOfNextSpur = rootOfNextSpur->next;
-				}
-				else
+				rootOfSpur++;
+				if (rootOfSpur >= (int) fromRoute->hopsCount - 1 || rootOfSpur == upperBound)
 				{
 					stop = 1;
 					//reached destination or upper bound
@@ -1820,7 +1868,7 @@ static int compute_another_route(Route *fromRoute, Node *terminusNode, int *allN
 	int result = -4, totComputed = 0, computedNow = 0;
 	Route *route;
 	RtgObject *rtgObj = terminusNode->routingObject;
-	ListElt *tempRootOfSpur;
+	int tempRootOfSpur;
 
 	*allNeighborsFound = 0;
 
@@ -1830,7 +1878,7 @@ static int compute_another_route(Route *fromRoute, Node *terminusNode, int *allN
 		{
 
 			//Only if this route hasn't children alive
-			totComputed = compute_all_spurs(fromRoute, terminusNode, NULL, allNeighborsFound);
+			totComputed = compute_all_spurs(fromRoute, terminusNode, NO_ROOT_OF_SPUR, allNeighborsFound);
 			computedNow = 1;
 		}
 
@@ -1841,13 +1889,13 @@ static int compute_another_route(Route *fromRoute, Node *terminusNode, int *allN
 
 			route = get_best_known_route(rtgObj, fromRoute->neighbor);
 
-			if(route == NULL && fromRoute->rootOfSpur != NULL)
+			if(route == NULL && fromRoute->rootOfSpur != NO_ROOT_OF_SPUR)
 			{
 				// 0 route found to the neighbor but we started from rootOfSpur
 				// This must be done due to the use of the Lawler's modification to the Yen's algorithm
 				// Remember that this is time-dependent graph
 				tempRootOfSpur = fromRoute->rootOfSpur;
-				fromRoute->rootOfSpur = NULL;
+				fromRoute->rootOfSpur = NO_ROOT_OF_SPUR;
 				result = compute_all_spurs(fromRoute, terminusNode, tempRootOfSpur, allNeighborsFound);
 				fromRoute->rootOfSpur = tempRootOfSpur;
 
@@ -2051,7 +2099,7 @@ static int computeOtherRoutes(Node *terminusNode, List subsetComputedRoutes, lon
  * \retval  -2	MWITHDRAW error
  *
  * \param[in]   *node           The Node to which we want to add the Route
- * \param[in]   *lastHopTonode  The last hop of the hops list that has
+ * \param[in]   *lastHopTonode  The contact of the last hop of the route that has
  *                              as receiver node the "node"
  * \param[in]   neighbor        The route's neighbor
  *
@@ -2064,10 +2112,9 @@ static int computeOtherRoutes(Node *terminusNode, List subsetComputedRoutes, lon
  *  -------- | --------------- |  -----------------------------------------------
  *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
  *****************************************************************************/
-static int add_route(Node *node, ListElt *lastHopToNode, unsigned long long neighbor)
+static int add_route(Node *node, Contact *lastHopToNode, unsigned long long neighbor)
 {
 	int result = -1, found;
-	Contact *finalContact;
 	Route *route;
 	RtgObject *rtgObj = node->routingObject;
 	ListElt *elt;
@@ -2089,8 +2136,7 @@ static int add_route(Node *node, ListElt *lastHopToNode, unsigned long long neig
 
 		if (route != NULL)
 		{
-			finalContact = (Contact*) lastHopToNode->data;
-			result = populate_route(finalContact, &graphRoot, route);
+			result = populate_route(lastHopToNode, &graphRoot, route);
 
 			if (result == 0)
 			{
@@ -2150,23 +2196,22 @@ static int add_route(Node *node, ListElt *lastHopToNode, unsigned long long neig
  *****************************************************************************/
 static int add_computed_route_to_intermediate_nodes(Route *route)
 {
-	ListElt *elt, *last;
 	Contact *current;
 	Node *currentNode;
 	int result = 0, count = 0;
+	unsigned int hop;
 	unsigned long long neighbor;
 
-	last = route->hops->last;
-	current = (Contact*) route->hops->first->data;
-	neighbor = current->toNode;
+	neighbor = ROUTE_HOP(route, 0)->toNode;
 
-	for (elt = route->hops->first; elt != last && result != -2; elt = elt->next)
+	// the last contact is the route itself
+	for (hop = 0; hop + 1 < route->hopsCount && result != -2; hop++)
 	{
-		current = (Contact*) elt->data;
+		current = ROUTE_HOP(route, hop);
 		currentNode = add_node(current->toNode);
 		if (currentNode != NULL)
 		{
-			result = add_route(currentNode, elt, neighbor);
+			result = add_route(currentNode, current, neighbor);
 			if (result == 0)
 			{
 				count++;
@@ -2187,106 +2232,830 @@ static int add_computed_route_to_intermediate_nodes(Route *route)
 }
 #endif
 
+#if (REVERSE_ONE_ROUTE_PER_NEIGHBOR == 1)
 /******************************************************************************
  *
  * \par Function Name:
- * 		computeOneRoutePerNeighbor
+ * 		get_reverse_search_owlt
  *
- * \brief Compute one route for each neighbor that has a path to reach the destination.
+ * \brief Get the owlt (plus the owlt margin) of a contact for the reverse search
  *
  *
  * \par Date Written:
- * 		30/01/20
+ * 		18/10/26
  *
  * \return int
  *
- * \retval   ">= 0"	Number of routes computed and added to selectedRoutes
- * \retval      -2	MWITHDRAW error
+ * \retval   0	Success case: range found
+ * \retval  -1	Range not found at the contact's start time, the contact has been suppressed
  *
- * \param[in]  *terminusNode     The Node (destination) for which we are computing the routes
- * \param[in]  missingNeighbors  The number of routes to compute (one route for each missing neighbor)
- *                               MUST be greater than 0.
- * \warning terminusNode doesn't have to be NULL.
+ * \param[in]    *contact     The contact for which we want the owlt
+ * \param[out]   *owltResult  In success case, the owlt plus the owlt margin
  *
- * \par Revision History:
+ * \warning contact doesn't have to be NULL.
+ * \warning owltResult doesn't have to be NULL.
  *
- *  DD/MM/YY | AUTHOR          |   DESCRIPTION
- *  -------- | --------------- |  -----------------------------------------------
- *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
- *  27/04/20 | L. Persampieri  |   Refactoring
+ * \par Notes:
+ *          1.  As in the Dijkstra's search, the range is searched at the contact's start time
+ *              and the result is remembered in the ContactNote.
  *****************************************************************************/
-static int computeOneRoutePerNeighbor(Node *terminusNode, long unsigned int missingNeighbors)
+static int get_reverse_search_owlt(Contact *contact, unsigned int *owltResult)
 {
-	int result, stop = 0;
-	int ok, temp;
-	Route *route;
-	RtgObject *rtgObj;
-	ClearRule rule;
+	int result = 0;
+	unsigned int owlt;
+	ContactNote *work = contact->routingObject;
+	DenseContacts dense;
 
-	/*
-	 * Every time we compute a route we add the neighbor to the excluded list,
-	 * so the next routes branches off from another neighbor. At the first
-	 * dijkstra's failed search we have computed the routes for all neighbors
-	 * that have a path to destination.
-	 */
+	get_contacts_dense_arrays(&dense);
 
-	result = 0;
-	rtgObj = terminusNode->routingObject;
+	owlt = work->owlt; //initialize to work value
 
-	// Only for the first time that we compute routes for the destination
-	// Note: the computeOtherRoutes function excluded all the neighbors
-	// for which we already have a route and set alreadyExcluded to 1
-	if(!alreadyExcluded)
+	if (work->rangeFlag == RangeNotFound
+			|| (work->rangeFlag == RangeNotSearched
+					&& get_applicable_range(contact->fromNode, contact->toNode, contact->fromTime, &owlt) < 0))
 	{
-		result = exclude_all_neighbors_from_computed_routes(rtgObj->selectedRoutes);
+		work->rangeFlag = RangeNotFound;
+		dense.suppressed[contact->id] = Suppressed;
+		result = -1;
+	}
+	else
+	{
+		work->rangeFlag = RangeFound;
+		work->owlt = owlt;
 
-		if(result < 0)
+		*owltResult = owlt + ((MAX_SPEED_MPH / 3600) * owlt) / 186282;
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		compare_latest_departures
+ *
+ * \brief Compare two edges (ContactNotes) of the reverse search
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval  -1	The	first edge is better than the second edge
+ * \retval   0	The two edges have the same cost
+ * \retval   1	The first edge is worse than the second edge
+ *
+ * \param[in]		*first		The first edge
+ * \param[in]		*second		The second edge
+ *
+ * \warning first doesn't have to be NULL.
+ * \warning second doesn't have to be NULL.
+ *
+ * \par Notes:
+ *          1.  A later departure is better, then we prefer less hops
+ *              to destination and then a lower owlt sum.
+ *****************************************************************************/
+static int compare_latest_departures(ContactNote *first, ContactNote *second)
+{
+	int result = 1;
+
+	if (first->latestDeparture > second->latestDeparture)
+	{
+		result = -1;
+	}
+	else if (first->latestDeparture == second->latestDeparture)
+	{
+		if (first->hopCount < second->hopCount)
 		{
-			stop = 1;
+			result = -1;
 		}
-		else
+		else if (first->hopCount == second->hopCount)
 		{
-			result = 0;
+			if (first->owltSum < second->owltSum)
+			{
+				result = -1;
+			}
+			else if (first->owltSum == second->owltSum)
+			{
+				result = 0;
+			}
 		}
+	}
 
-		alreadyExcluded = 1;
+	return result;
+}
 
-	}
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		compute_new_latest_departures
+ *
+ * \brief Reverse search first loop
+ *
+ * \details For the current contact we compute the latest departure of all
+ *          the (unvisited) contacts that have as toNode the fromNode of the current contact,
+ *          then we keep the latest one for each of them.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return void
+ *
+ * \param[in]  *current       The current contact, at the end we add it to the visited set
+ *
+ * \warning current doesn't have to be NULL.
+ *
+ * \par Notes:
+ *          1.  The latest departure of a contact is the latest time at which the transmission
+ *              can start on it, so that the bundle arrives to the next hop before the
+ *              latest departure of the next hop.
+ *****************************************************************************/
+static void compute_new_latest_departures(Contact *current)
+{
+	DenseContacts dense;
+	ContactNote *work, *currentWork, tempWork;
+	unsigned int i, count, owlt;
 
-	/*
-	 * We have excluded all neighbors for whom we already have at least a route
-	 *
-	 * For each new route found (necessarily from a new neighbor) we exclude the new neighbor
-	 *
-	 */
+	currentWork = current->routingObject;
 
-	ok = 0;
-	if(!graphCleaned)
-	{
-		// first time during the current call
-		rule = ClearTotally;
-	}
-	else
+	count = get_contacts_dense_arrays(&dense);
+	for (i = 0; i < count; i++)
 	{
-		rule = ClearPartially;
-	}
+		work = &(dense.notes[i]);
 
-	if(missingNeighbors > 0)
-	{
-		while (!stop)
+		if (dense.toNode[i] == current->fromNode && dense.fromNode[i] != dense.toNode[i]
+				&& dense.fromNode[i] != current->toNode && !dense.suppressed[i] && !dense.visited[i])
 		{
-			route = create_cgr_route();
-			if (route != NULL)
-			{
-				clear_work_areas(rule);
+			//don't route back and no loopback
 
-				ok = dijkstra_search(&graphRoot, terminusNode->nodeNbr, route);
+			if (get_reverse_search_owlt(dense.contact[i], &owlt) == 0)
+			{
+				tempWork.latestDeparture = currentWork->latestDeparture - owlt;
+				if (dense.toTime[i] - 1 < tempWork.latestDeparture)
+				{
+					tempWork.latestDeparture = dense.toTime[i] - 1;
+				}
+
+				if (tempWork.latestDeparture >= dense.fromTime[i]
+						&& tempWork.latestDeparture >= current_time)
+				{
+					tempWork.hopCount = currentWork->hopCount + 1;
+					tempWork.owltSum = currentWork->owltSum + owlt;
+
+					if (compare_latest_departures(&tempWork, work) < 0)
+					{
+						work->latestDeparture = tempWork.latestDeparture;
+						work->hopCount = tempWork.hopCount;
+						work->owltSum = tempWork.owltSum;
+						work->successor = current;
+					}
+				}
+			}
+		}
+	}
+
+	dense.visited[current->id] = 1;
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		find_latest_departure_contact
+ *
+ * \brief Reverse search second loop
+ *
+ * \details For all the contacts in the unvisited set with a known latest departure
+ *          we choose the contact with the latest one.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return Contact*
+ *
+ * \retval Contact*  The contact with the latest departure
+ * \retval NULL      There aren't contacts with a known latest departure in the unvisited set
+ *
+ * \par Notes:
+ *          1.  Full ties are broken by the contact's key (compare_contacts), as in find_best_contact.
+ *****************************************************************************/
+static Contact* find_latest_departure_contact()
+{
+	DenseContacts dense;
+	ContactNote *work, *best = NULL;
+	unsigned int i, count, bestId = 0;
+	int cmp;
+
+	count = get_contacts_dense_arrays(&dense);
+	for (i = 0; i < count; i++)
+	{
+		work = &(dense.notes[i]);
+
+		if (!(dense.suppressed[i]) && !(dense.visited[i]) && work->latestDeparture >= 0)
+		{
+			cmp = (best == NULL) ? -1 : compare_latest_departures(work, best);
+			if (cmp < 0 || (cmp == 0 && compare_contacts(dense.contact[i], dense.contact[bestId]) < 0))
+			{
+				best = work;
+				bestId = i;
+			}
+		}
+	}
+
+	return (best != NULL) ? dense.contact[bestId] : NULL;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		reverse_search
+ *
+ * \brief Backward search from the destination: label each contact with the
+ *        latest departure to reach the destination and with its successor.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return void
+ *
+ * \param[in]  toNode   The destination ipn node
+ *
+ * \par Notes:
+ *          1.  The contacts from the local node are labeled but never expanded:
+ *              they are the first hop of the routes.
+ *          2.  The work areas must be cleared before calling this function.
+ *****************************************************************************/
+static void reverse_search(unsigned long long toNode)
+{
+	Contact *contact;
+	DenseContacts dense;
+	ContactNote *work;
+	unsigned int i, count, owlt;
+
+	// The last hops: the transmission can start until the end of the contact
+	count = get_contacts_dense_arrays(&dense);
+	for (i = 0; i < count; i++)
+	{
+		work = &(dense.notes[i]);
+
+		if (dense.toNode[i] == toNode && dense.fromNode[i] != toNode && !dense.suppressed[i]
+				&& dense.toTime[i] - 1 >= dense.fromTime[i] && dense.toTime[i] - 1 >= current_time
+				&& get_reverse_search_owlt(dense.contact[i], &owlt) == 0)
+		{
+			work->latestDeparture = dense.toTime[i] - 1;
+			work->successor = NULL;
+			work->hopCount = 1;
+			work->owltSum = owlt;
+		}
+	}
+
+	while ((contact = find_latest_departure_contact()) != NULL)
+	{
+		if (contact->fromNode == localNode || contact->fromNode == toNode)
+		{
+			dense.visited[contact->id] = 1;
+		}
+		else
+		{
+			compute_new_latest_departures(contact);
+		}
+	}
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		find_walk_hop
+ *
+ * \brief Choose the contact for one hop of a route walked along the successor labels
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return Contact*
+ *
+ * \retval Contact*  The contact with the earliest arrival to the toNode of the reference contact
+ * \retval NULL      No contact can be used (only if the reference contact is an ancestor)
+ *
+ * \param[in]   *ref           The contact labeled by the reverse search for this hop
+ * \param[in]   *prev          The contact chosen for the previous hop (the graph's root for the first one)
+ * \param[in]   readyTime      The arrival time to the fromNode of the reference contact
+ * \param[in]   refine         Set to 1 to look at the earlier contacts between the same nodes,
+ *                             set to 0 to take the reference contact
+ * \param[out]  *arrivalTime   The arrival time to the toNode of the contact found
+ * \param[out]  *owltResult    The owlt (plus the owlt margin) of the contact found
+ *
+ * \warning ref doesn't have to be NULL.
+ * \warning prev doesn't have to be NULL.
+ *
+ * \par Notes:
+ *          1.  The reference contact can always be used: the bundle gets to its fromNode
+ *              no later than its latest departure, so it's the worst case. An earlier contact
+ *              between the same nodes gets there before, and then the successor of the
+ *              reference contact can still be used.
+ *          2.  The contacts already in the route are skipped, we don't want loops.
+ *****************************************************************************/
+static Contact* find_walk_hop(Contact *ref, Contact *prev, time_t readyTime, int refine,
+		time_t *arrivalTime, unsigned int *owltResult)
+{
+	Contact *contact, *best = NULL, *ancestor;
+	RbtNode *rbtNode;
+	unsigned int owlt;
+	time_t departure, arrival, bestArrival = MAX_POSIX_TIME;
+	int usable;
+
+	contact = (refine) ? get_first_contact_from_node_to_node(ref->fromNode, ref->toNode, &rbtNode) : ref;
+
+	while (contact != NULL)
+	{
+		departure = (contact->fromTime > readyTime) ? contact->fromTime : readyTime;
+		usable = (contact->toTime > departure && get_reverse_search_owlt(contact, &owlt) == 0);
+
+#if (NEGLECT_CONFIDENCE == 0 && REVISABLE_CONFIDENCE == 0)
+		if (prev == &graphRoot && contact->confidence < 1.0F)
+		{
+			// first hop must be certain
+			usable = 0;
+		}
+#endif
+
+		for (ancestor = prev; usable && ancestor != &graphRoot;
+				ancestor = ancestor->routingObject->predecessor)
+		{
+			if (ancestor == contact)
+			{
+				usable = 0;
+			}
+		}
+
+		if (usable)
+		{
+			arrival = departure + owlt;
+			if (arrival < bestArrival)
+			{
+				best = contact;
+				bestArrival = arrival;
+				*owltResult = owlt;
+			}
+		}
+
+		if (contact == ref)
+		{
+			contact = NULL; //I leave the loop
+		}
+		else
+		{
+			contact = get_next_contact(&rbtNode);
+		}
+	}
+
+	*arrivalTime = bestArrival;
+
+	return best;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		populate_route_by_successors
+ *
+ * \brief Build the route that starts with the first hop, walking the successor labels
+ *        of the reverse search up to the destination.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval   0	Success case: route built
+ * \retval  -1	A hop would be a contact already in the route (only with refine)
+ * \retval  -2	MWITHDRAW error
+ *
+ * \param[in]    *firstHop     A contact from the local node labeled by the reverse search,
+ *                             with a latest departure not before the current time
+ * \param[in]    refine        Set to 1 to take for each hop the contact with the earliest arrival
+ *                             between the same nodes (see find_walk_hop), 0 to follow the labels
+ * \param[out]   *resultRoute  In success case all phase one fields of this Route
+ *                             will be setted (see populate_route notes).
+ *
+ * \warning firstHop doesn't have to be NULL.
+ * \warning resultRoute doesn't have to be NULL.
+ *
+ * \par Notes:
+ *          1.  The route walks the same nodes of the labels, with the earliest arrival time
+ *              that they allow: the labels alone give the route that departs as late as possible.
+ *          2.  The ContactNotes of the route get the same values of a Dijkstra's search,
+ *              so that populate_route can be used.
+ *****************************************************************************/
+static int populate_route_by_successors(Contact *firstHop, int refine, Route *resultRoute)
+{
+	int result = 0;
+	Contact *ref, *hop, *prev = &graphRoot;
+	ContactNote *work, *prevWork;
+	unsigned int owlt = 0;
+	time_t readyTime = current_time, arrivalTime;
+	DenseContacts dense;
+
+	get_contacts_dense_arrays(&dense);
+
+	for (ref = firstHop; ref != NULL && result == 0; ref = ref->routingObject->successor)
+	{
+		hop = find_walk_hop(ref, prev, readyTime, refine, &arrivalTime, &owlt);
+
+		if (hop == NULL)
+		{
+			result = -1;
+		}
+		else
+		{
+			work = hop->routingObject;
+			prevWork = prev->routingObject;
+			work->predecessor = prev;
+			dense.arrivalTime[hop->id] = arrivalTime;
+			work->owltSum = prevWork->owltSum + owlt;
+			work->hopCount = prevWork->hopCount + 1;
+			work->arrivalConfidence = prevWork->arrivalConfidence * hop->confidence;
+
+			prev = hop;
+			readyTime = arrivalTime;
+		}
+	}
+
+	if (result == 0)
+	{
+		result = populate_route(prev, NULL, resultRoute);
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		compare_neighbor_routes
+ *
+ * \brief Compare two routes found by the reverse search, as the Dijkstra's search
+ *        compares its edges (see compare_dijkstra_edges)
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval  -1	The	first route is better than the second route
+ * \retval   0	The two routes have the same cost
+ * \retval   1	The first route is worse than the second route
+ *
+ * \param[in]		*first		The first route
+ * \param[in]		*second		The second route
+ *
+ * \warning first doesn't have to be NULL.
+ * \warning second doesn't have to be NULL.
+ *****************************************************************************/
+static int compare_neighbor_routes(Route *first, Route *second)
+{
+	ContactNote firstWork, secondWork;
+
+	firstWork.hopCount = first->hopsCount;
+	firstWork.owltSum = first->owltSum;
+	firstWork.arrivalConfidence = first->arrivalConfidence;
+
+	secondWork.hopCount = second->hopsCount;
+	secondWork.owltSum = second->owltSum;
+	secondWork.arrivalConfidence = second->arrivalConfidence;
+
+	return compare_dijkstra_edges(first->arrivalTime, &firstWork, second->arrivalTime, &secondWork);
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		compute_neighbors_routes
+ *
+ * \brief Build one route for each neighbor that the reverse search found able to reach
+ *        the destination, ordered from the best to the worst.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval   ">= 0"	Number of routes built
+ * \retval      -2	MWITHDRAW error
+ *
+ * \param[out]  routes   The routes built, from the best to the worst (compare_neighbor_routes)
+ *
+ * \par Notes:
+ *          1.  Call it just after reverse_search.
+ *          2.  The neighbors in the excludedNeighbors list are skipped.
+ *          3.  For each neighbor the first hop is its first contact with a latest departure
+ *              not before the current time: contacts from the local node are ordered by toNode
+ *              and then by fromTime.
+ *****************************************************************************/
+static int compute_neighbors_routes(List routes)
+{
+	int result = 0, temp;
+	Contact *contact;
+	RbtNode *rbtNode;
+	ContactNote *work;
+	Route *route;
+	ListElt *elt;
+	unsigned long long neighbor = 0;
+	time_t transmitTime;
+	DenseContacts dense;
+
+	get_contacts_dense_arrays(&dense);
+
+	for (contact = get_first_contact_from_node(localNode, &rbtNode);
+			contact != NULL && contact->fromNode == localNode && result >= 0;
+			contact = get_next_contact(&rbtNode))
+	{
+		work = contact->routingObject;
+		transmitTime = (contact->fromTime > current_time) ? contact->fromTime : current_time;
+
+		if (contact->toNode != neighbor && contact->toNode != localNode
+				&& !dense.suppressed[contact->id] && work->latestDeparture >= transmitTime
+#if (NEGLECT_CONFIDENCE == 0 && REVISABLE_CONFIDENCE == 0)
+				&& contact->confidence >= 1.0F // first hop must be certain
+#endif
+				&& !neighbor_is_excluded(contact->toNode))
+		{
+			route = create_cgr_route();
+			if (route == NULL)
+			{
+				result = -2;
+			}
+			else
+			{
+				temp = populate_route_by_successors(contact, 1, route);
+				if (temp == -1)
+				{
+					// a loop through the same contact, the labels never loop
+						temp = populate_route_by_successors(contact, 0, route);
+				}
+
+				if (temp == 0)
+				{
+					neighbor = contact->toNode;
+
+					for (elt = routes->first; elt != NULL
+							&& compare_neighbor_routes((Route*) elt->data, route) <= 0; elt = elt->next)
+						;
+
+					elt = (elt == NULL) ? list_insert_last(routes, route) : list_insert_before(elt, route);
+					if (elt == NULL)
+					{
+						delete_cgr_route(route);
+						result = -2;
+					}
+					else
+					{
+						result++;
+					}
+				}
+				else
+				{
+					delete_cgr_route(route);
+					if (temp == -2)
+					{
+						result = -2;
+					}
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		computeOneRoutePerNeighborByReverseSearch
+ *
+ * \brief Compute one route for each neighbor that has a path to reach the destination,
+ *        with a single reverse search.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval   ">= 0"	Number of routes computed and added to selectedRoutes
+ * \retval      -2	MWITHDRAW error
+ *
+ * \param[in]  *terminusNode     The Node (destination) for which we are computing the routes
+ * \param[in]  missingNeighbors  The max number of routes to add to selectedRoutes
+ *
+ * \warning terminusNode doesn't have to be NULL.
+ *
+ * \par Notes:
+ *          1.  The work areas must be cleared before calling this function.
+ *          2.  The neighbors in the excludedNeighbors list are skipped.
+ *          3.  Each route walks the successor labels of the reverse search (see
+ *              populate_route_by_successors), no Dijkstra's search is performed.
+ *              The missingNeighbors best routes are kept, as the Dijkstra's searches would do;
+ *              phase two then computes the arrival times of the bundle.
+ *****************************************************************************/
+static int computeOneRoutePerNeighborByReverseSearch(Node *terminusNode, long unsigned int missingNeighbors)
+{
+	int result = 0, found, temp;
+	List routes;
+	ListElt *elt;
+	Route *route;
+	RtgObject *rtgObj = terminusNode->routingObject;
+
+	routes = list_create(NULL, NULL, NULL, NULL);
+	if (routes == NULL)
+	{
+		return -2;
+	}
+
+	reverse_search(terminusNode->nodeNbr);
+	found = compute_neighbors_routes(routes);
+	if (found < 0)
+	{
+		result = -2;
+	}
+
+	while ((elt = routes->first) != NULL)
+	{
+		route = (Route*) elt->data;
+		list_remove_elt(elt);
+
+		if (result < 0 || (unsigned long) result >= missingNeighbors)
+		{
+			delete_cgr_route(route);
+		}
+		//Always insert as first element in selectedRoutes
+		else if (insert_selected_route(rtgObj, route) == 0)
+		{
+			result++;
+			remove_neighbor_from_known_routes(rtgObj->knownRoutes, route->neighbor);
+
+			// Necessarily a new neighbor
+			if (exclude_current_neighbor(route) < 0)
+			{
+				result = -2;
+			}
+#if (ADD_COMPUTED_ROUTE_TO_INTERMEDIATE_NODES == 1)
+			else if(add_computed_route_to_intermediate_nodes(route) < 0)
+			{
+				result = -2;
+			}
+#endif
+		}
+		else
+		{
+			delete_cgr_route(route);
+			result = -2;
+		}
+	}
+
+	free_list(routes);
+
+	if (result >= 0 && result == found)
+	{
+		// ------ DISCOVERED ALL NEIGHBORS TO REACH DESTINATION ------
+
+		temp = insert_neighbors_to_reach_destination(excludedNeighbors, terminusNode);
+		if(temp < 0)
+		{
+			verbose_debug_printf("Can't add neighbors (error: %d)...", temp);
+		}
+		if(temp == -2)
+		{
+			result = -2;
+		}
+	}
+
+	debug_printf("Reverse search: %d routes added.", result);
+
+	return result;
+}
+#endif
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		computeOneRoutePerNeighbor
+ *
+ * \brief Compute one route for each neighbor that has a path to reach the destination.
+ *
+ *
+ * \par Date Written:
+ * 		30/01/20
+ *
+ * \return int
+ *
+ * \retval   ">= 0"	Number of routes computed and added to selectedRoutes
+ * \retval      -2	MWITHDRAW error
+ *
+ * \param[in]  *terminusNode     The Node (destination) for which we are computing the routes
+ * \param[in]  missingNeighbors  The number of routes to compute (one route for each missing neighbor)
+ *                               MUST be greater than 0.
+ * \warning terminusNode doesn't have to be NULL.
+ *
+ * \par Revision History:
+ *
+ *  DD/MM/YY | AUTHOR          |   DESCRIPTION
+ *  -------- | --------------- |  -----------------------------------------------
+ *  30/01/20 | L. Persampieri  |   Initial Implementation and documentation.
+ *  27/04/20 | L. Persampieri  |   Refactoring
+ *****************************************************************************/
+static int computeOneRoutePerNeighbor(Node *terminusNode, long unsigned int missingNeighbors)
+{
+	int result, stop = 0;
+	int ok, temp;
+	Route *route;
+	RtgObject *rtgObj;
+	ClearRule rule;
+
+	/*
+	 * Every time we compute a route we add the neighbor to the excluded list,
+	 * so the next routes branches off from another neighbor. At the first
+	 * dijkstra's failed search we have computed the routes for all neighbors
+	 * that have a path to destination.
+	 */
+
+	result = 0;
+	rtgObj = terminusNode->routingObject;
+
+	// Only for the first time that we compute routes for the destination
+	// Note: the computeOtherRoutes function excluded all the neighbors
+	// for which we already have a route and set alreadyExcluded to 1
+	if(!alreadyExcluded)
+	{
+		result = exclude_all_neighbors_from_computed_routes(rtgObj->selectedRoutes);
+
+		if(result < 0)
+		{
+			stop = 1;
+		}
+		else
+		{
+			result = 0;
+		}
+
+		alreadyExcluded = 1;
+
+	}
+
+	/*
+	 * We have excluded all neighbors for whom we already have at least a route
+	 *
+	 * For each new route found (necessarily from a new neighbor) we exclude the new neighbor
+	 *
+	 */
+
+	ok = 0;
+	if(!graphCleaned)
+	{
+		// first time during the current call
+		rule = ClearTotally;
+	}
+	else
+	{
+		rule = ClearPartially;
+	}
+
+	if(missingNeighbors > 0)
+	{
+#if (REVERSE_ONE_ROUTE_PER_NEIGHBOR == 1)
+		if (!stop && terminusNode->nodeNbr != localNode)
+		{
+			// One (reverse) traversal of the contacts graph for all the neighbors
+			clear_work_areas(rule);
+			result = computeOneRoutePerNeighborByReverseSearch(terminusNode, missingNeighbors);
+			stop = 1;
+		}
+#endif
+		while (!stop)
+		{
+			route = create_cgr_route();
+			if (route != NULL)
+			{
+				clear_work_areas(rule);
+
+				ok = dijkstra_search(&graphRoot, terminusNode->nodeNbr, route);
 
 				rule = ClearPartially; //for each following Dijkstra's search
 
 				if (ok == 0)
 				{
-					route->rootOfSpur = NULL;
+					route->rootOfSpur = NO_ROOT_OF_SPUR;
 					//Always insert as first element in selectedRoutes
 					if (insert_selected_route(rtgObj, route) == 0)
 					{
@@ -2503,7 +3272,7 @@ int computeRoutes(Node *terminusNode, List subsetComputedRoutes, long unsigned i
  *****************************************************************************/
 static void print_phase_one_route(FILE *file, Route *route, unsigned int num)
 {
-	ListElt *elt;
+	unsigned int hop;
 	Contact *contact;
 	char temp[20];
 	Route *father;
@@ -2535,21 +3304,18 @@ static void print_phase_one_route(FILE *file, Route *route, unsigned int num)
 		}
 		else if (route->hops != NULL)
 		{
-			fprintf(file, "%lu\n%-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %s\n",
-					route->hops->length, "FromNode", "ToNode", "FromTime", "ToTime", "XmitRate",
+			fprintf(file, "%u\n%-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %s\n",
+					route->hopsCount, "FromNode", "ToNode", "FromTime", "ToTime", "XmitRate",
 					"Confidence", "MTV[Bulk]", "MTV[Normal]", "MTV[Expedited]");
-			for (elt = route->hops->first; elt != NULL; elt = elt->next)
+			for (hop = 0; hop < route->hopsCount; hop++)
 			{
-				if (elt->data != NULL)
-				{
-					contact = (Contact*) elt->data;
-					fprintf(file,
-							"%-15llu %-15llu %-15ld %-15ld %-15lu %-10.2f%-5s %-15g %-15g %g\n",
-							contact->fromNode, contact->toNode, (long int) contact->fromTime,
-							(long int) contact->toTime, contact->xmitRate, contact->confidence,
-							(elt == route->rootOfSpur) ? " x" : "", contact->mtv[0],
-							contact->mtv[1], contact->mtv[2]);
-				}
+				contact = ROUTE_HOP(route, hop);
+				fprintf(file,
+						"%-15llu %-15llu %-15ld %-15ld %-15lu %-10.2f%-5s %-15g %-15g %g\n",
+						contact->fromNode, contact->toNode, (long int) contact->fromTime,
+						(long int) contact->toTime, contact->xmitRate, contact->confidence,
+						((int) hop == route->rootOfSpur) ? " x" : "", contact->mtv[0],
+						contact->mtv[1], contact->mtv[2]);
 			}
 		}
 
@@ -76,11 +76,11 @@ static int best_route_cost_function(void *first, void *second)
 		}
 		else if (firstRoute->pbat == secondRoute->pbat)
 		{
-			if (firstRoute->hops->length > secondRoute->hops->length) //SABR 3.2.8.1.4 a) 2)
+			if (firstRoute->hopsCount > secondRoute->hopsCount) //SABR 3.2.8.1.4 a) 2)
 			{
 				result = 1;
 			}
-			else if (firstRoute->hops->length == secondRoute->hops->length)
+			else if (firstRoute->hopsCount == secondRoute->hopsCount)
 			{
 				if (firstRoute->toTime < secondRoute->toTime) //SABR 3.2.8.1.4 a) 3)
 				{
@@ -238,6 +238,41 @@ static void getBestRoute(List candidateRoutes)
 	return;
 }
 
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		get_route_volume
+ *
+ * \brief Get the volume that the bundle will consume on each contact of the route.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return double
+ *
+ * \retval  "> 0"  The bundle's EVC, or the route volume limit if it is lower
+ *                 (the bundle will be proactively fragmented)
+ *
+ * \param[in]   *bundle   The bundle that has to be forwarded
+ * \param[in]   *route    A route choosed by phase three
+ *
+ * \par Notes:
+ *          1.  Phase two keeps a route with a volume limit lower than the EVC
+ *              only for fragmentable bundles, see PROACTIVE_FRAGMENTATION.
+ *****************************************************************************/
+double get_route_volume(CgrBundle *bundle, Route *route)
+{
+	double volume = (double) bundle->evc;
+
+	if (route->routeVolumeLimit < volume)
+	{
+		volume = route->routeVolumeLimit;
+	}
+
+	return volume;
+}
+
 /******************************************************************************
  *
  * \par Function Name:
@@ -246,7 +281,8 @@ static void getBestRoute(List candidateRoutes)
  * \brief For each contact in the hops list of a best route
  *        this function will decrease the mtv field for all level of priority
  *        less than or equal to the bundle's priority. The volume will be decreased
- *        by the bundle's evc.
+ *        by the bundle's evc, or by the route volume limit if the bundle
+ *        will be proactively fragmented.
  *
  *
  * \par Date Written:
@@ -268,22 +304,25 @@ static void getBestRoute(List candidateRoutes)
  *****************************************************************************/
 static void update_volumes(CgrBundle *bundle, List bestRoutes)
 {
-	ListElt *routeElt, *hopElt;
+	ListElt *routeElt;
 	Contact *contact;
 	Route *route;
+	unsigned int hop;
 	int i, priority = bundle->priority_level;
+	double volume;
 
 	for (routeElt = bestRoutes->first; routeElt != NULL; routeElt = routeElt->next)
 	{
 		route = (Route*) routeElt->data;
+		volume = get_route_volume(bundle, route);
 
-		for (hopElt = route->hops->first; hopElt != NULL; hopElt = hopElt->next)
+		for (hop = 0; hop < route->hopsCount; hop++)
 		{
-			contact = (Contact*) hopElt->data;
+			contact = ROUTE_HOP(route, hop);
 
 			for (i = 0; i <= priority; i++)
 			{
-				contact->mtv[i] -= (double) bundle->evc;
+				contact->mtv[i] -= volume;
 			}
 		}
 	}
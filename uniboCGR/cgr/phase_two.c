@@ -432,11 +432,12 @@ static int computeResidualBacklog(Route *route, CgrScalar *allotment, CgrScalar
  * \param[in]		*contact                A contact of the hops list.
  * \param[in]		priority                The priority level of the bundle
  * \param[in]		firstByteTransmitTime   The first byte transmit time for the sender node of the contact
- * \param[in]		*elt                    The ListElt for which the contact is the data field
+ * \param[in]		*route                  The route for which we are computing the EVL
+ * \param[in]		hop                     The index of the contact in the route's hops
  * \param[out]		*effectiveVolumeLimit   The effective volume limit computed, only in success case
  *
  * \warning contact doesn't have to be NULL
- * \warning elt doesn't have to be NULL
+ * \warning route doesn't have to be NULL
  * \warning effectiveVolumeLimit doesn't have to be NULL
  *
  * \par Notes:
@@ -451,24 +452,21 @@ static int computeResidualBacklog(Route *route, CgrScalar *allotment, CgrScalar
  *  06/02/20 | L. Persampieri  |  Initial Implementation and documentation.
  *****************************************************************************/
 static int computeEffectiveVolumeLimit(Contact *contact, Priority priority,
-		time_t firstByteTransmitTime, ListElt *elt, double *effectiveVolumeLimit)
+		time_t firstByteTransmitTime, Route *route, unsigned int hop, double *effectiveVolumeLimit)
 {
 	time_t effectiveStopTime, effectiveDuration;
 	int result = 0;
 	Contact *temp;
 
 	effectiveStopTime = contact->toTime;
-	elt = elt->next;
 
-	while (elt != NULL)
+	for (hop = hop + 1; hop < route->hopsCount; hop++)
 	{
-		temp = (Contact*) elt->data;
+		temp = ROUTE_HOP(route, hop);
 		if (temp->toTime < effectiveStopTime)
 		{
 			effectiveStopTime = temp->toTime;
 		}
-
-		elt = elt->next;
 	}
 
 	effectiveDuration = effectiveStopTime - firstByteTransmitTime;
@@ -540,21 +538,30 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 {
 	int result = -1, viableRoute;
 	unsigned int owlt, owltMargin, owltSum = 0;
-	CgrScalar applicableRadiationLatency;
+	long int applicableRadiationLatency;
 	time_t firstByteTransmitTime, lastByteTransmitTime, startTime, arrivalTime;
-	double effectiveVolumeLimit;
+	double effectiveVolumeLimit, volume;
 	Contact *contact, *nextContact;
-	ListElt *elt, *nextElt;
+	unsigned int hop;
 	Priority priority;
+	int fragmentable;
 #if (QUEUE_DELAY == 1)
 	double nominalContactVolume;
 	time_t queueDelay;
 #endif
 
 	priority = bundle->priority_level;
-	elt = route->hops->first;
-	contact = (Contact*) route->hops->first->data;
+	hop = 0;
+	contact = ROUTE_HOP(route, 0);
 	*lastByteArrivalTime = 0;
+	// the volume that will travel on the route: the whole bundle
+	// or, with proactive fragmentation, the first fragment (RVL)
+	volume = (double) bundle->evc;
+#if (PROACTIVE_FRAGMENTATION == 1)
+	fragmentable = (IS_FRAGMENTABLE(bundle) != 0);
+#else
+	fragmentable = 0;
+#endif
 
 	if (contact->xmitRate > 0)
 	{
@@ -572,20 +579,16 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 		arrivalTime = startTime;
 		owltSum = 0;
 
-		copyCgrScalar(&applicableRadiationLatency, residualBacklog);
-		divideCgrScalar(&applicableRadiationLatency, (long int) contact->xmitRate);
+		applicableRadiationLatency = CgrScalarToLong(residualBacklog) / (long int) contact->xmitRate;
 
 		// here applicableRadiationLatency = backlog lien SABR 3.2.6.2 g)
 
-		firstByteTransmitTime = startTime
-				+ ((ONE_GIG * applicableRadiationLatency.gigs) + applicableRadiationLatency.units);
+		firstByteTransmitTime = startTime + applicableRadiationLatency;
 
 		route->eto = firstByteTransmitTime; // SABR 3.2.6.2 i) (3.2.6.3)
 
-		loadCgrScalar(&applicableRadiationLatency, (long int) bundle->evc);
-		divideCgrScalar(&applicableRadiationLatency, (long int) contact->xmitRate);
-		lastByteTransmitTime = firstByteTransmitTime
-				+ ((ONE_GIG * applicableRadiationLatency.gigs) + applicableRadiationLatency.units); // SABR 3.2.6.4
+		applicableRadiationLatency = (long int) bundle->evc / (long int) contact->xmitRate;
+		lastByteTransmitTime = firstByteTransmitTime + applicableRadiationLatency; // SABR 3.2.6.4
 
 		route->routeVolumeLimit = DBL_MAX;
 
@@ -593,11 +596,15 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 
 		while (contact != NULL && viableRoute)
 		{
-			nextElt = elt->next;
+			nextContact = (hop + 1 < route->hopsCount) ? ROUTE_HOP(route, hop + 1) : NULL;
 
-			nextContact = (nextElt == NULL) ? NULL : (Contact*) nextElt->data;
+			if(lastByteTransmitTime > contact->toTime && fragmentable)
+			{
+				// the fragment will be sized to the volume limit computed below
+				lastByteTransmitTime = contact->toTime;
+			}
 
-			if(lastByteTransmitTime > contact->toTime) //TODO do not fragment
+			if(lastByteTransmitTime > contact->toTime)
 			{
 				viableRoute = 0;
 			}
@@ -630,13 +637,15 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 				}
 				else
 				{
-					if (computeEffectiveVolumeLimit(contact, priority, firstByteTransmitTime, elt,
+					if (computeEffectiveVolumeLimit(contact, priority, firstByteTransmitTime, route, hop,
 							&effectiveVolumeLimit) < 0) // SABR 3.2.6.8.9
 					{
 						viableRoute = 0;
 					}
-					else if (effectiveVolumeLimit < bundle->evc) //TODO do not fragment
+					else if (effectiveVolumeLimit < volume && (!fragmentable
+							|| effectiveVolumeLimit <= (double) MIN_CONVERGENCE_LAYER_OVERHEAD))
 					{
+						// a fragment must carry more than its own overhead
 						viableRoute = 0;
 					}
 					else
@@ -646,8 +655,13 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 								(route->routeVolumeLimit < effectiveVolumeLimit) ?
 										route->routeVolumeLimit : effectiveVolumeLimit;
 
+						if (route->routeVolumeLimit < volume)
+						{
+							volume = route->routeVolumeLimit;
+						}
+
 						contact = nextContact;
-						elt = nextElt;
+						hop++;
 
 						if (contact != NULL)
 						{
@@ -683,11 +697,12 @@ static int computeExpectedBundleDeliveryTime(CgrBundle *bundle, Route *route,
 							}
 #endif
 
-							loadCgrScalar(&applicableRadiationLatency, (long int) bundle->evc);
-							divideCgrScalar(&applicableRadiationLatency, (long int) contact->xmitRate);
-							lastByteTransmitTime = firstByteTransmitTime
-									+ ((ONE_GIG * applicableRadiationLatency.gigs)
-											+ applicableRadiationLatency.units);
+							applicableRadiationLatency = (long int) volume;
+							if (contact->xmitRate > 0)
+							{
+								applicableRadiationLatency /= (long int) contact->xmitRate;
+							}
+							lastByteTransmitTime = firstByteTransmitTime + applicableRadiationLatency;
 						}
 					}
 				}
@@ -760,6 +775,7 @@ static int computePBAT(Route *route, CgrBundle *bundle)
 {
 	int result = -1;
 	CgrScalar applicableBacklog, totalBacklog, allotment, volume, residualBacklog;
+	long int overbooked;
 	time_t lastByteArrivalTime;
 
 	if (computeApplicableBacklog(route->neighbor, bundle->priority_level, bundle->ordinal, &applicableBacklog, &totalBacklog) < 0)
@@ -781,13 +797,9 @@ static int computePBAT(Route *route, CgrBundle *bundle)
 
 			/***************** OVERBOOKING MANAGEMENT *****************/
 			// Ported from ION 3.7.0
-			copyCgrScalar(&(route->overbooked), &allotment);
-			increaseCgrScalar(&(route->overbooked), (long int) bundle->evc);
-			subtractFromCgrScalar(&(route->overbooked), &volume);
-			if (!CgrScalarIsValid(&(route->overbooked)))
-			{
-				loadCgrScalar(&(route->overbooked), 0);
-			}
+			overbooked = CgrScalarToLong(&allotment) + (long int) bundle->evc
+					- CgrScalarToLong(&volume);
+			loadCgrScalar(&(route->overbooked), (overbooked > 0) ? overbooked : 0);
 			/**********************************************************/
 
 			result = computeExpectedBundleDeliveryTime(bundle, route, &residualBacklog,
@@ -1245,7 +1257,7 @@ static int phase_one_conversation_management(int thereIsNewCandidateRoute, Route
  *                            route could cause a loop
  *
  * \warning route doesn't have to be NULL
- * \warning route->hops doesn't have to be NULL and the list must have at least one contact
+ * \warning route->hops doesn't have to be NULL and the route must have at least one hop
  * \warning bundle doesn't have to be NULL and all fields must be initialized
  *
  * \par Revision History:
@@ -1259,7 +1271,7 @@ static int loopIdentified(Route *route, CgrBundle *bundle)
 	int result = 0;
 #if (CGR_AVOID_LOOP == 2 || CGR_AVOID_LOOP == 3)
 	int found;
-	ListElt *elt, *last_contact;
+	unsigned int hop;
 	Contact *current;
 	unsigned int loop_level = 0;
 #endif
@@ -1279,13 +1291,12 @@ static int loopIdentified(Route *route, CgrBundle *bundle)
 	if (result == 0 && route->hops != NULL)
 	{
 		found = 0;
-		last_contact = route->hops->last; //the last contact can't cause the loop
 
-		for (elt = route->hops->first; elt != last_contact && elt != NULL && !found; elt =
-				elt->next)
+		//the last contact can't cause the loop
+		for (hop = 0; hop + 1 < route->hopsCount && !found; hop++)
 		{
-			current = (Contact*) elt->data;
-			if (current != NULL && search_ipn_node(bundle->geoRoute, current->toNode) == 0)
+			current = ROUTE_HOP(route, hop);
+			if (search_ipn_node(bundle->geoRoute, current->toNode) == 0)
 			{
 				found = 1;
 			}
@@ -1428,7 +1439,7 @@ int checkRoute(CgrBundle *bundle, List excludedNeighbors, Route *route)
 		route->checkValue = 1;
 
 #if (NEGLECT_CONFIDENCE == 0)
-		firstContact = (Contact*) route->hops->first->data;
+		firstContact = ROUTE_HOP(route, 0);
 #endif
 
 		if (route->toTime <= current_time)
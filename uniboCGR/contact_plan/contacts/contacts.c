@@ -13,6 +13,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "contacts.h"
 #include "../../library/list/list.h"
 #include "../../library/commonDefines.h"
@@ -48,7 +49,26 @@ static Rbt *contacts = NULL;
 static void erase_contact(Contact*);
 
 static void erase_contact_note(ContactNote *note);
-static ContactNote* create_contact_note();
+static void free_dense_contacts(DenseContacts *arrays);
+static int add_dense_contact(Contact *contact);
+static void remove_dense_contact(Contact *contact);
+
+/**
+ * \brief The fields of the contacts read by the searches, indexed by the contact's id.
+ */
+static DenseContacts dense = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+/**
+ * \brief Number of contacts in the DenseContacts arrays.
+ */
+static unsigned int denseContactsCount = 0;
+/**
+ * \brief Number of elements allocated for each DenseContacts array.
+ */
+static unsigned int denseContactsCapacity = 0;
+/**
+ * \brief Boolean: set to 1 when the ids don't follow the order of the contacts graph.
+ */
+static int denseContactsUnordered = 0;
 
 /**
  * \brief The time of the next contact that expires.
@@ -317,6 +337,7 @@ int revise_confidence(unsigned long long fromNode, unsigned long long toNode, ti
 		if(contact != NULL)
 		{
 			contact->confidence = newConfidence;
+			dense.confidence[contact->id] = newConfidence;
 			result = 0;
 		}
 	}
@@ -372,6 +393,7 @@ int revise_contact(unsigned long long fromNode, unsigned long long toNode, time_
 		if(contact != NULL)
 		{
 			contact->confidence = newConfidence;
+			dense.confidence[contact->id] = newConfidence;
 			contact->xmitRate = xmitRate;
 			if(copyMTV != 0)
 			{
@@ -506,10 +528,9 @@ static void erase_contact(Contact *contact)
 	contact->toTime = 0;
 	contact->type = Registration;
 	contact->xmitRate = 0;
-	contact->mtv[0] = 0.0;
-	contact->mtv[1] = 0.0;
-	contact->mtv[2] = 0.0;
+	contact->mtv = NULL;
 	contact->routingObject = NULL;
+	contact->id = 0;
 }
 
 /******************************************************************************
@@ -569,6 +590,11 @@ void destroy_ContactsGraph()
 	rbt_destroy(contacts);
 	contacts = NULL;
 	timeContactToRemove = MAX_POSIX_TIME;
+
+	free_dense_contacts(&dense);
+	denseContactsCount = 0;
+	denseContactsCapacity = 0;
+	denseContactsUnordered = 0;
 }
 
 /******************************************************************************
@@ -598,15 +624,14 @@ static void erase_contact_note(ContactNote *note)
 
 	if (note != NULL)
 	{
-		note->arrivalTime = -1;
 		note->hopCount = 0;
 		note->predecessor = NULL;
-		note->suppressed = 0;
-		note->visited = 0;
 		note->owltSum = 0;
 		note->arrivalConfidence = 0.0F;
 		note->rangeFlag = 0;
 		note->owlt = 0;
+		note->successor = NULL;
+		note->latestDeparture = -1;
 	}
 
 	return;
@@ -615,39 +640,492 @@ static void erase_contact_note(ContactNote *note)
 /******************************************************************************
  *
  * \par Function Name:
- *      create_contact_note
+ *      free_dense_contacts
  *
- * \brief  Allocate (with MWITHDRAW) a memory area for a ContactNote
+ * \brief  Release the memory of all the arrays of a DenseContacts
  *
  *
  * \par Date Written:
- *      13/01/20
+ *      18/10/26
  *
- * \return ContactNote*
+ * \return void
  *
- * \retval ContactNote*  The new allocated ContactNote
- * \retval NULL          MWITHDRAW error)
+ * \param[in]	*arrays  The DenseContacts with the arrays to release
  *
  * \par Notes:
- *              1. The new allocated ContactNote will have all fields erased.
- *              2. You must check that the return value of this function is not NULL.
+ *              1. The released arrays are set to NULL.
+ *****************************************************************************/
+static void free_dense_contacts(DenseContacts *arrays)
+{
+	if (arrays->fromNode != NULL)
+	{
+		MDEPOSIT(arrays->fromNode);
+	}
+	if (arrays->toNode != NULL)
+	{
+		MDEPOSIT(arrays->toNode);
+	}
+	if (arrays->fromTime != NULL)
+	{
+		MDEPOSIT(arrays->fromTime);
+	}
+	if (arrays->toTime != NULL)
+	{
+		MDEPOSIT(arrays->toTime);
+	}
+	if (arrays->confidence != NULL)
+	{
+		MDEPOSIT(arrays->confidence);
+	}
+	if (arrays->mtv != NULL)
+	{
+		MDEPOSIT(arrays->mtv);
+	}
+	if (arrays->arrivalTime != NULL)
+	{
+		MDEPOSIT(arrays->arrivalTime);
+	}
+	if (arrays->suppressed != NULL)
+	{
+		MDEPOSIT(arrays->suppressed);
+	}
+	if (arrays->visited != NULL)
+	{
+		MDEPOSIT(arrays->visited);
+	}
+	if (arrays->notes != NULL)
+	{
+		MDEPOSIT(arrays->notes);
+	}
+	if (arrays->contact != NULL)
+	{
+		MDEPOSIT(arrays->contact);
+	}
+
+	memset(arrays, 0, sizeof(DenseContacts));
+
+	return;
+}
+
+/******************************************************************************
  *
- * \par Revision History:
+ * \par Function Name:
+ *      link_dense_contact
  *
- *  DD/MM/YY |  AUTHOR         |   DESCRIPTION
- *  -------- | --------------- | -----------------------------------------------
- *  13/01/20 | L. Persampieri  |  Initial Implementation and documentation.
+ * \brief  Point the contact in the slot passed as argument to its slot
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]	id  The slot of the DenseContacts arrays
+ *
+ * \par Notes:
+ *              1. The id, the routingObject and the mtv fields of the contact will be updated.
  *****************************************************************************/
-static ContactNote* create_contact_note()
+static void link_dense_contact(unsigned int id)
 {
-	ContactNote *note = (ContactNote*) MWITHDRAW(sizeof(ContactNote));
+	Contact *contact = dense.contact[id];
 
-	if (note != NULL)
+	contact->id = id;
+	contact->routingObject = &(dense.notes[id]);
+	contact->mtv = dense.mtv[id];
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      grow_dense_contacts
+ *
+ * \brief  Double the number of slots of the DenseContacts arrays
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval   0   Success case
+ * \retval  -2   MWITHDRAW error
+ *
+ * \par Notes:
+ *              1. The arrays are moved, so the routingObject and the mtv
+ *                 of every contact will be updated.
+ *              2. In the MWITHDRAW error case the arrays aren't changed.
+ *****************************************************************************/
+static int grow_dense_contacts()
+{
+	DenseContacts newDense;
+	unsigned int i, newCapacity;
+
+	newCapacity = (denseContactsCapacity == 0) ? 64 : 2 * denseContactsCapacity;
+
+	newDense.fromNode = (unsigned long long*) MWITHDRAW(sizeof(unsigned long long) * newCapacity);
+	newDense.toNode = (unsigned long long*) MWITHDRAW(sizeof(unsigned long long) * newCapacity);
+	newDense.fromTime = (time_t*) MWITHDRAW(sizeof(time_t) * newCapacity);
+	newDense.toTime = (time_t*) MWITHDRAW(sizeof(time_t) * newCapacity);
+	newDense.confidence = (float*) MWITHDRAW(sizeof(float) * newCapacity);
+	newDense.mtv = (double (*)[3]) MWITHDRAW(sizeof(double[3]) * newCapacity);
+	newDense.arrivalTime = (time_t*) MWITHDRAW(sizeof(time_t) * newCapacity);
+	newDense.suppressed = (int*) MWITHDRAW(sizeof(int) * newCapacity);
+	newDense.visited = (int*) MWITHDRAW(sizeof(int) * newCapacity);
+	newDense.notes = (ContactNote*) MWITHDRAW(sizeof(ContactNote) * newCapacity);
+	newDense.contact = (Contact**) MWITHDRAW(sizeof(Contact*) * newCapacity);
+
+	if (newDense.fromNode == NULL || newDense.toNode == NULL || newDense.fromTime == NULL
+			|| newDense.toTime == NULL || newDense.confidence == NULL || newDense.mtv == NULL
+			|| newDense.arrivalTime == NULL || newDense.suppressed == NULL || newDense.visited == NULL
+			|| newDense.notes == NULL || newDense.contact == NULL)
+	{
+		free_dense_contacts(&newDense);
+		return -2;
+	}
+
+	if (denseContactsCount > 0)
+	{
+		memcpy(newDense.fromNode, dense.fromNode, sizeof(unsigned long long) * denseContactsCount);
+		memcpy(newDense.toNode, dense.toNode, sizeof(unsigned long long) * denseContactsCount);
+		memcpy(newDense.fromTime, dense.fromTime, sizeof(time_t) * denseContactsCount);
+		memcpy(newDense.toTime, dense.toTime, sizeof(time_t) * denseContactsCount);
+		memcpy(newDense.confidence, dense.confidence, sizeof(float) * denseContactsCount);
+		memcpy(newDense.mtv, dense.mtv, sizeof(double[3]) * denseContactsCount);
+		memcpy(newDense.arrivalTime, dense.arrivalTime, sizeof(time_t) * denseContactsCount);
+		memcpy(newDense.suppressed, dense.suppressed, sizeof(int) * denseContactsCount);
+		memcpy(newDense.visited, dense.visited, sizeof(int) * denseContactsCount);
+		memcpy(newDense.notes, dense.notes, sizeof(ContactNote) * denseContactsCount);
+		memcpy(newDense.contact, dense.contact, sizeof(Contact*) * denseContactsCount);
+	}
+
+	free_dense_contacts(&dense);
+	dense = newDense;
+	denseContactsCapacity = newCapacity;
+
+	for (i = 0; i < denseContactsCount; i++)
+	{
+		link_dense_contact(i);
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      move_dense_contact
+ *
+ * \brief  Copy a slot of the DenseContacts arrays into another slot
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]	to     The slot that will be overwritten
+ * \param[in]	from   The slot to copy
+ *
+ * \par Notes:
+ *              1. The contact of the from slot will point to the to slot.
+ *****************************************************************************/
+static void move_dense_contact(unsigned int to, unsigned int from)
+{
+	dense.fromNode[to] = dense.fromNode[from];
+	dense.toNode[to] = dense.toNode[from];
+	dense.fromTime[to] = dense.fromTime[from];
+	dense.toTime[to] = dense.toTime[from];
+	dense.confidence[to] = dense.confidence[from];
+	memcpy(dense.mtv[to], dense.mtv[from], sizeof(double[3]));
+	dense.arrivalTime[to] = dense.arrivalTime[from];
+	dense.suppressed[to] = dense.suppressed[from];
+	dense.visited[to] = dense.visited[from];
+	dense.notes[to] = dense.notes[from];
+	dense.contact[to] = dense.contact[from];
+
+	link_dense_contact(to);
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      swap_dense_contacts
+ *
+ * \brief  Swap two slots of the DenseContacts arrays
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]	first    The first slot
+ * \param[in]	second   The second slot
+ *
+ * \par Notes:
+ *              1. The two contacts will point to their new slot.
+ *****************************************************************************/
+static void swap_dense_contacts(unsigned int first, unsigned int second)
+{
+	unsigned long long fromNode = dense.fromNode[first], toNode = dense.toNode[first];
+	time_t fromTime = dense.fromTime[first], toTime = dense.toTime[first];
+	time_t arrivalTime = dense.arrivalTime[first];
+	int suppressed = dense.suppressed[first], visited = dense.visited[first];
+	float confidence = dense.confidence[first];
+	double mtv[3];
+	ContactNote note = dense.notes[first];
+	Contact *contact = dense.contact[first];
+
+	memcpy(mtv, dense.mtv[first], sizeof(double[3]));
+
+	move_dense_contact(first, second);
+
+	dense.fromNode[second] = fromNode;
+	dense.toNode[second] = toNode;
+	dense.fromTime[second] = fromTime;
+	dense.toTime[second] = toTime;
+	dense.confidence[second] = confidence;
+	memcpy(dense.mtv[second], mtv, sizeof(double[3]));
+	dense.arrivalTime[second] = arrivalTime;
+	dense.suppressed[second] = suppressed;
+	dense.visited[second] = visited;
+	dense.notes[second] = note;
+	dense.contact[second] = contact;
+
+	link_dense_contact(second);
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      add_dense_contact
+ *
+ * \brief  Give to the contact the first free slot of the DenseContacts arrays
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval   0   Success case
+ * \retval  -2   MWITHDRAW error
+ *
+ * \param[in]	*contact  The contact that will be added to the contacts graph
+ *
+ * \par Notes:
+ *              1. The arrays grow by doubling their size (see grow_dense_contacts).
+ *              2. The new ContactNote will have all fields erased and the MTVs are set to 0.
+ *              3. If the contact doesn't follow the last contact of the arrays in the
+ *                 order of the contacts graph, the arrays will be sorted again at the
+ *                 next get_contacts_dense_arrays.
+ *****************************************************************************/
+static int add_dense_contact(Contact *contact)
+{
+	unsigned int i;
+
+	if (denseContactsCount == denseContactsCapacity && grow_dense_contacts() < 0)
+	{
+		return -2;
+	}
+
+	i = denseContactsCount;
+	dense.fromNode[i] = contact->fromNode;
+	dense.toNode[i] = contact->toNode;
+	dense.fromTime[i] = contact->fromTime;
+	dense.toTime[i] = contact->toTime;
+	dense.confidence[i] = contact->confidence;
+	dense.mtv[i][0] = 0.0;
+	dense.mtv[i][1] = 0.0;
+	dense.mtv[i][2] = 0.0;
+	dense.arrivalTime[i] = -1;
+	dense.suppressed[i] = 0;
+	dense.visited[i] = 0;
+	erase_contact_note(&(dense.notes[i]));
+	dense.contact[i] = contact;
+
+	link_dense_contact(i);
+	denseContactsCount++;
+
+	if (i > 0 && compare_contacts(dense.contact[i - 1], contact) > 0)
+	{
+		denseContactsUnordered = 1;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      remove_dense_contact
+ *
+ * \brief  Release the slot of the contact in the DenseContacts arrays
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]	*contact  The contact that we want to delete
+ *
+ * \par Notes:
+ *              1. The last contact of the arrays is moved in the released slot,
+ *                 so its id, its routingObject and its mtv change and the arrays
+ *                 will be sorted again at the next get_contacts_dense_arrays.
+ *****************************************************************************/
+static void remove_dense_contact(Contact *contact)
+{
+	unsigned int id = contact->id;
+	unsigned int last;
+
+	if (contact->routingObject != NULL && denseContactsCount > 0)
+	{
+		last = denseContactsCount - 1;
+
+		if (id != last)
+		{
+			move_dense_contact(id, last);
+			denseContactsUnordered = 1;
+		}
+
+		denseContactsCount--;
+	}
+
+	contact->routingObject = NULL;
+	contact->mtv = NULL;
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      sort_dense_contacts
+ *
+ * \brief  Give to the contacts the ids in the same order of the contacts graph
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \par Notes:
+ *              1. Each contact is swapped into its slot, no memory is allocated.
+ *              2. The ContactNotes and the MTVs follow their contact.
+ *****************************************************************************/
+static void sort_dense_contacts()
+{
+	Contact *contact;
+	RbtNode *node;
+	unsigned int i = 0, id;
+
+	for (contact = get_first_contact(&node); contact != NULL && i < denseContactsCount;
+			contact = get_next_contact(&node))
+	{
+		id = contact->id;
+		if (id != i)
+		{
+			// the slots before i are already sorted, so id > i
+			swap_dense_contacts(i, id);
+		}
+		i++;
+	}
+
+	denseContactsUnordered = 0;
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      get_contacts_dense_arrays
+ *
+ * \brief  Get the DenseContacts arrays of all the contacts
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return unsigned int
+ *
+ * \retval "unsigned int"  The number of contacts in the arrays
+ *
+ * \param[out]	*arrays   The arrays, indexed by the contact's id
+ *
+ * \par Notes:
+ *              1. The arrays are ordered as the contacts graph: if some contact has been
+ *                 added out of order or removed they are sorted again here, and the ids change.
+ *              2. Any contact added to or removed from the graph can
+ *                 change the arrays: don't keep them across these operations.
+ *****************************************************************************/
+unsigned int get_contacts_dense_arrays(DenseContacts *arrays)
+{
+	if (denseContactsUnordered)
+	{
+		sort_dense_contacts();
+	}
+
+	if (arrays != NULL)
+	{
+		*arrays = dense;
+	}
+
+	return denseContactsCount;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      get_first_dense_contact_from_node
+ *
+ * \brief  Get the id of the first contact with the fromNode passed as argument
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return unsigned int
+ *
+ * \retval "unsigned int"  The id of the first contact with a fromNode not lower than
+ *                         fromNodeNbr (the number of contacts if there isn't)
+ *
+ * \param[in]	fromNodeNbr   The sender node
+ *
+ * \par Notes:
+ *              1. The contacts from fromNodeNbr are the ones from this id as long as
+ *                 the DenseContacts fromNode is fromNodeNbr.
+ *              2. Binary search on the sorted arrays (see get_contacts_dense_arrays).
+ *****************************************************************************/
+unsigned int get_first_dense_contact_from_node(unsigned long long fromNodeNbr)
+{
+	unsigned int low = 0, high, middle;
+
+	high = get_contacts_dense_arrays(NULL);
+
+	while (low < high)
 	{
-		erase_contact_note(note);
+		middle = low + (high - low) / 2;
+		if (dense.fromNode[middle] < fromNodeNbr)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
 	}
 
-	return note;
+	return low;
 }
 
 /******************************************************************************
@@ -681,40 +1159,26 @@ void free_contact(void *data)
 {
 	Contact *contact;
 	ListElt *current, *temp;
-	ListElt *hop;
 	Route *route;
-	int deleted;
 
 	if (data != NULL)
 	{
 		contact = (Contact*) data;
-		if (contact->routingObject != NULL)
-		{
-			MDEPOSIT(contact->routingObject);
-		}
+		remove_dense_contact(contact);
 
 		if (contact->citations != NULL)
 		{
 			current = contact->citations->first;
 			while (current != NULL)
 			{
-				deleted = 0;
 				temp = current->next;
 
 				if (current->data != NULL)
 				{
-					hop = (ListElt*) current->data;
-					if (hop->list != NULL)
-					{
-						if (hop->list->userData != NULL)
-						{
-							deleted = 1;
-							route = (Route*) hop->list->userData;
-							delete_cgr_route(route); //this function remove the citation
-						}
-					}
+					route = (Route*) current->data;
+					delete_cgr_route(route); //this function remove the citation
 				}
-				if (deleted == 0)
+				else
 				{
 					flush_verbose_debug_printf("Error!!!");
 					list_remove_elt(current);
@@ -782,11 +1246,6 @@ Contact* create_contact(unsigned long long fromNode, unsigned long long toNode,
 		contact->xmitRate = xmitRate;
 		contact->confidence = confidence;
 		contact->type = type;
-		/* NOTE: We assume that toTime - fromTime is greater or equal to 0 */
-		volume = (double) (xmitRate * ((long unsigned int) (toTime - fromTime)));
-		contact->mtv[0] = volume;
-		contact->mtv[1] = volume;
-		contact->mtv[2] = volume;
 
 		contact->citations = list_create(contact, NULL, NULL, NULL);
 		if (contact->citations == NULL)
@@ -794,15 +1253,19 @@ Contact* create_contact(unsigned long long fromNode, unsigned long long toNode,
 			MDEPOSIT(contact);
 			contact = NULL;
 		}
+		else if (add_dense_contact(contact) < 0)
+		{
+			MDEPOSIT(contact->citations);
+			MDEPOSIT(contact);
+			contact = NULL;
+		}
 		else
 		{
-			contact->routingObject = create_contact_note();
-			if (contact->routingObject == NULL)
-			{
-				MDEPOSIT(contact->citations);
-				MDEPOSIT(contact);
-				contact = NULL;
-			}
+			/* NOTE: We assume that toTime - fromTime is greater or equal to 0 */
+			volume = (double) (xmitRate * ((long unsigned int) (toTime - fromTime)));
+			contact->mtv[0] = volume;
+			contact->mtv[1] = volume;
+			contact->mtv[2] = volume;
 		}
 	}
 
@@ -943,6 +1406,7 @@ int add_contact_to_graph(unsigned long long fromNode, unsigned long long toNode,
 							// don't consider confidence as rilevant changes to contact plan
 							// (don't discard routes for this)
 							temp->confidence = confidence;
+							dense.confidence[temp->id] = confidence;
 #endif
 							overlapped = 1;
 							temp = NULL;
@@ -85,45 +85,95 @@ typedef struct
 	CtType type;
 	/**
 	 * \brief Remaining volume (for each level of priority)
+	 *
+	 * \details It points to the contact's row of the DenseContacts mtv array.
 	 */
-	double mtv[3];
+	double *mtv;
 	/**
 	 * \brief Used by Dijkstra's search
 	 */
 	ContactNote *routingObject;
 	/**
-	 * \brief List of ListElt data.
+	 * \brief List of Route data.
 	 *
-	 * \details Each citation is a pointer to the element
-	 * of the hops list of the Route where the contact appears,
-	 * and this element of the hops list points to this contact.
+	 * \details Each citation is a pointer to a Route where the contact appears,
+	 * the hop of the Route keeps the citation (see RouteHop).
 	 */
 	List citations;
+	/**
+	 * \brief Dense index of the contact in the DenseContacts arrays.
+	 *
+	 * \details It can change when another contact is added to or removed from the graph.
+	 */
+	unsigned int id;
 } Contact;
 
-struct cgrContactNote
+/**
+ * \brief The fields of the contacts read by the searches, in arrays indexed by the contact's id.
+ *
+ * \details Each field has its own array, so that a loop that reads only some fields
+ *          scans contiguous memory. The ids follow the order of the contacts graph,
+ *          so the contacts from the same node have consecutive ids.
+ */
+typedef struct
 {
 	/**
-	 * \brief Previous contact in the route, used to reconstruct the route at the end of
-	 * the Dijkstra's search
+	 * \brief Sender node (ipn node number)
 	 */
-	Contact *predecessor;
+	unsigned long long *fromNode;
+	/**
+	 * \brief Receiver node (ipn node number)
+	 */
+	unsigned long long *toNode;
 	/**
-	 * \brief Best case arrival time to the toNode of the contact
+	 * \brief Start transit time
 	 */
-	time_t arrivalTime;
+	time_t *fromTime;
 	/**
-	 * \brief Boolean used to identify each contact that belongs to the visited set
+	 * \brief Stop transmit time
+	 */
+	time_t *toTime;
+	/**
+	 * \brief Confidence that the contact will materialize
+	 */
+	float *confidence;
+	/**
+	 * \brief Remaining volume (for each level of priority), pointed by the contact's mtv field
+	 */
+	double (*mtv)[3];
+	/**
+	 * \brief Best case arrival time to the toNode of the contact, used by Dijkstra's search
+	 */
+	time_t *arrivalTime;
+	/**
+	 * \brief Flag used to identify each contact that belongs to the excluded set, used by the searches
+	 */
+	int *suppressed;
+	/**
+	 * \brief Boolean used to identify each contact that belongs to the visited set, used by the searches
 	 *
 	 * \details Values
 	 *          -  1  Contact already visited
 	 *          -  0  Contact not visited
 	 */
-	int visited;
+	int *visited;
 	/**
-	 * \brief Flag used to identify each contact that belongs to the excluded set
+	 * \brief The ContactNotes, pointed by the contact's routingObject field
 	 */
-	int suppressed;
+	ContactNote *notes;
+	/**
+	 * \brief The contacts themselves, for all the other fields
+	 */
+	Contact **contact;
+} DenseContacts;
+
+struct cgrContactNote
+{
+	/**
+	 * \brief Previous contact in the route, used to reconstruct the route at the end of
+	 * the Dijkstra's search
+	 */
+	Contact *predecessor;
 	/**
 	 * \brief Ranges sum to reach the toNode
 	 */
@@ -153,6 +203,16 @@ struct cgrContactNote
 	 * \brief The owlt of the range found.
 	 */
 	unsigned int owlt;
+	/**
+	 * \brief Next contact in the route, used by the reverse (latest departure) search
+	 *        to walk the route from the local node to the destination.
+	 */
+	Contact *successor;
+	/**
+	 * \brief Latest time at which the transmission can start on this contact
+	 *        and still reach the destination, computed by the reverse search.
+	 */
+	time_t latestDeparture;
 };
 
 #ifdef __cplusplus
@@ -185,6 +245,8 @@ extern Contact* get_first_contact_from_node_to_node(unsigned long long fromNodeN
 		unsigned long long toNodeNbr, RbtNode **node);
 extern Contact* get_next_contact(RbtNode **node);
 extern Contact* get_prev_contact(RbtNode **node);
+extern unsigned int get_contacts_dense_arrays(DenseContacts *dense);
+extern unsigned int get_first_dense_contact_from_node(unsigned long long fromNodeNbr);
 
 #if REVISABLE_CONFIDENCE
 extern int revise_confidence(unsigned long long fromNode, unsigned long long toNode, time_t fromTime, float newConfidence);
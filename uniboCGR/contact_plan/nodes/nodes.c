@@ -300,7 +300,10 @@ int create_NodesTree()
 static void discardRoute(void *data)
 {
 	Route *route = (Route*) data;
-	free_list(route->hops); 	//hops list has NULL as delete function
+	if (route->hops != NULL && route->hops != route->inlineHops)
+	{
+		MDEPOSIT(route->hops); //the citations have already been deleted
+	}
 	free_list(route->children); //children list has NULL as delete function
 	MDEPOSIT(route);
 	return;
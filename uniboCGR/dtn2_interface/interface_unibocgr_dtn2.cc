@@ -24,6 +24,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <string.h>
+#include <map>
+#include <vector>
 
 
 
@@ -46,6 +48,8 @@
 #define NOMINAL_PRIMARY_BLKSIZE	29 // from ION 4.0.0: bpv7/library/libbpP.c
 #define MSR 0
 #define EPOCH_2000_SEC 946684800
+// owlt (s) of the range added for a predicted contact to a neighbor without ranges
+#define PREDICTED_CONTACT_OWLT 1
 
 /**
  * \brief This time is used by the CGR as time 0.
@@ -68,6 +72,43 @@ static dtn::Bundle *Dtn2BundleS = NULL;
  */
 static CgrBundle *cgrBundle = NULL;
 
+/**
+ * \brief A contact whose MTVs have been decreased for a bundle.
+ *
+ * \details The contact is kept by its key, it could be removed from the graph
+ *          before the volume is given back.
+ */
+typedef struct
+{
+	unsigned long long fromNode;
+	unsigned long long toNode;
+	time_t fromTime;
+	/**
+	 * \brief The volume subtracted, the EVC or the first fragment's volume
+	 */
+	double volume;
+} ReservedContact;
+
+/**
+ * \brief The volume booked by phase three for a bundle.
+ */
+typedef struct
+{
+	/**
+	 * \brief The MTVs decreased are the ones from 0 to this priority level
+	 */
+	int priority;
+	/**
+	 * \brief One element for each hop of each best route
+	 */
+	std::vector<ReservedContact> contacts;
+} Reservation;
+
+/**
+ * \brief The reservations ledger, indexed by DTN2's bundle id.
+ */
+static std::map<u_int64_t, Reservation> reservations;
+
 #define printDebugIonRoute(ionwm, route) do {  } while(0)
 
 
@@ -853,6 +894,369 @@ static int exclude_neighbors()
 	return result;
 }
 
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      record_reservation
+ *
+ * \brief  Keep track of the volume booked by phase three on the contacts
+ *         of the best routes for the bundle.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]     id          The DTN2's bundle id
+ * \param[in]     *bundle     The CGR's bundle, with the EVC and the priority
+ * \param[in]     bestRoutes  The best routes choosed by phase three
+ *
+ * \par Notes:
+ *          1.  A reservation still in the ledger for the bundle is given back
+ *              before, so a bundle routed twice (e.g. by the routing worker and
+ *              by the daemon thread) never keeps a volume that nobody credits.
+ *****************************************************************************/
+static void record_reservation(u_int64_t id, CgrBundle *bundle, List bestRoutes)
+{
+	ListElt *routeElt;
+	Route *route;
+	Contact *contact;
+	unsigned int hop;
+	ReservedContact reserved;
+
+	credit_bundle_reservation(id);
+
+	Reservation &reservation = reservations[id];
+
+	reservation.priority = bundle->priority_level;
+	reservation.contacts.clear();
+
+	for (routeElt = bestRoutes->first; routeElt != NULL; routeElt = routeElt->next)
+	{
+		route = (Route*) routeElt->data;
+		reserved.volume = get_route_volume(bundle, route);
+
+		for (hop = 0; hop < route->hopsCount; hop++)
+		{
+			contact = ROUTE_HOP(route, hop);
+			reserved.fromNode = contact->fromNode;
+			reserved.toNode = contact->toNode;
+			reserved.fromTime = contact->fromTime;
+			reservation.contacts.push_back(reserved);
+		}
+	}
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      credit_reservation
+ *
+ * \brief  Give back to the contacts the volume booked for a bundle.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]     *reservation   The reservation to credit
+ *
+ * \par Notes:
+ *          1.  The contacts no longer in the graph are skipped.
+ *          2.  The MTVs never exceed the contact's nominal volume.
+ *****************************************************************************/
+static void credit_reservation(Reservation *reservation)
+{
+	unsigned int i;
+	int j;
+	Contact *contact;
+	ReservedContact *reserved;
+	double volume;
+
+	for (i = 0; i < reservation->contacts.size(); i++)
+	{
+		reserved = &(reservation->contacts[i]);
+		contact = get_contact(reserved->fromNode, reserved->toNode, reserved->fromTime, NULL);
+
+		if (contact != NULL)
+		{
+			volume = ((double) contact->xmitRate) * ((double) (contact->toTime - contact->fromTime));
+
+			for (j = 0; j <= reservation->priority && j < 3; j++)
+			{
+				contact->mtv[j] += reserved->volume;
+				if (contact->mtv[j] > volume)
+				{
+					contact->mtv[j] = volume;
+				}
+			}
+		}
+	}
+
+	return;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      credit_bundle_reservation
+ *
+ * \brief  Give back the volume booked for a bundle that has been cancelled,
+ *         that is going to be rerouted or that has been deleted.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval    0   Volume given back to the contacts
+ * \retval   -1   No reservation for this bundle
+ *
+ * \param[in]     id    The DTN2's bundle id
+ *
+ * \par Notes:
+ *          1.  A bundle deleted while it is being routed gets its reservation after
+ *              this call: the caller that drops the routing result has to call
+ *              this function again.
+ *****************************************************************************/
+int credit_bundle_reservation(u_int64_t id)
+{
+	int result = -1;
+	std::map<u_int64_t, Reservation>::iterator it = reservations.find(id);
+
+	if (it != reservations.end())
+	{
+		debug_printf("Credit reservation of bundle %llu.", (unsigned long long) id);
+		credit_reservation(&(it->second));
+		reservations.erase(it);
+		result = 0;
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      confirm_bundle_reservation
+ *
+ * \brief  The bundle has been transmitted: the volume booked is really used,
+ *         forget the reservation.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval    0   Reservation confirmed
+ * \retval   -1   No reservation for this bundle
+ *
+ * \param[in]     id    The DTN2's bundle id
+ *****************************************************************************/
+int confirm_bundle_reservation(u_int64_t id)
+{
+	return (reservations.erase(id) > 0) ? 0 : -1;
+}
+
+#if (REVISABLE_XMIT_RATE)
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      rescale_reservations
+ *
+ * \brief  Scale the volumes booked on the contacts between two nodes
+ *         whose MTVs have been scaled.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return void
+ *
+ * \param[in]     fromNode   The sender node of the contacts
+ * \param[in]     toNode     The receiver node of the contacts
+ * \param[in]     factors    The factor of each contact scaled, by its fromTime
+ *****************************************************************************/
+static void rescale_reservations(unsigned long long fromNode, unsigned long long toNode,
+		const std::map<time_t, double> &factors)
+{
+	unsigned int i;
+	ReservedContact *reserved;
+	std::map<u_int64_t, Reservation>::iterator it;
+	std::map<time_t, double>::const_iterator factor;
+
+	for (it = reservations.begin(); it != reservations.end() && !factors.empty(); ++it)
+	{
+		for (i = 0; i < it->second.contacts.size(); i++)
+		{
+			reserved = &(it->second.contacts[i]);
+			if (reserved->fromNode == fromNode && reserved->toNode == toNode)
+			{
+				factor = factors.find(reserved->fromTime);
+				if (factor != factors.end())
+				{
+					reserved->volume *= factor->second;
+				}
+			}
+		}
+	}
+
+	return;
+}
+#endif
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      get_max_fragment_size
+ *
+ * \brief  Get the largest bundle size (blocks included) whose EVC fits in a volume.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return long unsigned int
+ *
+ * \retval  ">= 0"  The largest size, not greater than maxSize, whose EVC is
+ *                  not greater than volume
+ *
+ * \param[in]     volume     The volume that the fragment can use
+ * \param[in]     maxSize    The size of the whole bundle
+ *
+ * \par Notes:
+ *          1.  The EVC doesn't decrease with the size, so a binary search is enough.
+ *****************************************************************************/
+static long unsigned int get_max_fragment_size(double volume, long unsigned int maxSize)
+{
+	long unsigned int low = 0, high = maxSize, mid;
+
+	while (low < high)
+	{
+		mid = low + (high - low + 1) / 2;
+		if ((double) computeBundleEVC(mid) <= volume)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	return low;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      route_one_bundle
+ *
+ * \brief  Get the best routes for one bundle, the caller has already
+ *         checked the contact plan.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval    0   Routes found and converted
+ * \retval   -1   There aren't route to reach the destination
+ * \retval   -2   MWITHDRAW error
+ * \retval   -3   Phase one arguments error
+ * \retval   -4   CGR arguments error
+ * \retval   -7   Bundle's conversion error
+ * \retval   -8   NULL pointer during conversion to ION's contact
+ *
+ * \param[in]     time              The current time
+ * \param[in]     *bundle           The DTN2's bundle that has to be forwarded
+ * \param[out]    *res              The best routes found
+ * \param[out]    *fragmentLength   The max total length (blocks included) of the first fragment
+ *                                  if the bundle has to be proactively fragmented, 0 otherwise
+ * \param[in]     inBatch           Set to true if the bundle belongs to a batch started
+ *                                  by startBestRoutesBatch, false otherwise
+ *
+ * \par Notes:
+ *          1.  The routes of a destination are kept by CGR between two calls,
+ *              so the bundles after the first one to the same destination
+ *              only go through phase two and three.
+ *****************************************************************************/
+static int route_one_bundle(time_t time, dtn::Bundle *bundle, std::string *res,
+		long unsigned int *fragmentLength, bool inBatch)
+{
+	int result;
+	List cgrRoutes = NULL;
+	Route *bestRoute;
+	double volume;
+
+	*fragmentLength = 0;
+
+	// the bundle is going to be rerouted, the old routes are no longer booked
+	credit_bundle_reservation(bundle->bundleid());
+
+	// INPUT CONVERSION: learn the bundle's characteristics and store them into the CGR's bundle struct
+	result = convert_bundle_from_dtn2_to_cgr(time - reference_time, bundle, cgrBundle);
+	if (result == 0)
+	{
+		debug_printf("Go to CGR.");
+		// Call Unibo-CGR
+		if (inBatch)
+		{
+			result = getBestRoutesInBatch(cgrBundle, excludedNeighbors, &cgrRoutes);
+		}
+		else
+		{
+			result = getBestRoutes(time - reference_time, cgrBundle, excludedNeighbors,
+					&cgrRoutes);
+		}
+
+		if (result > 0 && cgrRoutes != NULL)
+		{
+			record_reservation(bundle->bundleid(), cgrBundle, cgrRoutes);
+
+			// PROACTIVE FRAGMENTATION: the first route can carry only a part of the bundle.
+			// DTN2 wants the max total length of the first fragment (blocks included),
+			// so we give the largest size whose EVC fits in the route's volume.
+			bestRoute = (Route*) cgrRoutes->first->data;
+			volume = get_route_volume(cgrBundle, bestRoute);
+			if (volume < (double) cgrBundle->evc)
+			{
+				*fragmentLength = get_max_fragment_size(volume, cgrBundle->size);
+				if (*fragmentLength <= NOMINAL_PRIMARY_BLKSIZE || *fragmentLength >= cgrBundle->size)
+				{
+					// not even the blocks fit, or no need to fragment
+					*fragmentLength = 0;
+				}
+			}
+
+			// OUTPUT CONVERSION: convert the best routes into DTN2's CgrRoute and
+			// put them into ION's Lyst
+			result = convert_routes_from_cgr_to_dtn2(
+					cgrBundle->evc, cgrRoutes, res);
+			// ION's contacts MTVs are decreased by ipnfw
+
+			if (result == -1)
+			{
+				result = -8;
+			}
+		}
+	}
+	else
+	{
+		result = -7;
+	}
+	reset_bundle(cgrBundle);
+
+	return result;
+}
+
 /******************************************************************************
  *
  * \par Function Name:
@@ -880,6 +1284,8 @@ static int exclude_neighbors()
  * \param[in]     time              The current time
  * \param[in]     *bundle           The DTN2's bundle that has to be forwarded
  * \param[out]    *matches          The list of best routes found
+ * \param[out]    *fragmentLength   The max total length (blocks included) of the first fragment
+ *                                  if the bundle has to be proactively fragmented, 0 otherwise
  *
  *
  * \par Revision History:
@@ -888,57 +1294,118 @@ static int exclude_neighbors()
  *  -------- | --------------- | -----------------------------------------------
  *  05/07/20 | G. Gori		    |  Initial Implementation and documentation.
  *****************************************************************************/
-int callUniboCGR(time_t time, dtn::Bundle *bundle, std::string *res)
+int callUniboCGR(time_t time, dtn::Bundle *bundle, std::string *res,
+		long unsigned int *fragmentLength)
 {
 
 	int result = -5;
-	List cgrRoutes = NULL;
+
+	if (fragmentLength != NULL)
+	{
+		*fragmentLength = 0;
+	}
 
 	start_call_log(time - reference_time);
 
 	debug_printf("Entry point interface.");
 
-	if (initialized && bundle != NULL)
+	if (initialized && bundle != NULL && fragmentLength != NULL)
 	{
 		// INPUT CONVERSION: check if the contact plan has been changed, in affermative case update it
 		result = update_contact_plan("", false);
 		if (result != -2)
 		{
-			// INPUT CONVERSION: learn the bundle's characteristics and store them into the CGR's bundle struct
-			result = convert_bundle_from_dtn2_to_cgr(time - reference_time, bundle, cgrBundle);
-			if (result == 0)
-			{
-				debug_printf("Go to CGR.");
-				// Call Unibo-CGR
-				result = getBestRoutes(time - reference_time, cgrBundle, excludedNeighbors,
-						&cgrRoutes);
+			result = route_one_bundle(time, bundle, res, fragmentLength, false);
+		}
+	}
 
-				if (result > 0 && cgrRoutes != NULL)
-				{
-					// OUTPUT CONVERSION: convert the best routes into DTN2's CgrRoute and
-					// put them into ION's Lyst
-					result = convert_routes_from_cgr_to_dtn2(
-							cgrBundle->evc, cgrRoutes, res);
-					// ION's contacts MTVs are decreased by ipnfw
+	debug_printf("result -> %d\n", result);
 
-					if (result == -1)
-					{
-						result = -8;
-					}
-				}
-			}
-			else
+#if (LOG == 1)
+	if (result < -1)
+	{
+		writeLog("Fatal error (interface): %d.", result);
+	}
+	end_call_log();
+	// Log interactivity...
+	log_fflush();
+#endif
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      callUniboCGRBatch
+ *
+ * \brief  Entry point to call the CGR from DTN2 for a batch of bundles,
+ *         get the best routes for each bundle.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval  ">= 0"  Number of bundles for which routes have been found
+ * \retval   -2     MWITHDRAW error
+ * \retval   -5     callUniboCGRBatch arguments error, or time in the past
+ *
+ * \param[in]     time              The current time
+ * \param[in]     **bundles         The DTN2's bundles that have to be forwarded
+ * \param[in]     count             The number of bundles
+ * \param[out]    *res              Array of count elements, the best routes found
+ *                                  for each bundle (empty if no route)
+ * \param[out]    *fragmentLength   Array of count elements, the max total length of the
+ *                                  first fragment of each bundle (0 if not fragmented)
+ *
+ * \par Notes:
+ *          1.  The bundles are routed in the given order, so the MTVs booked by
+ *              a bundle are seen by the next ones. Give the bundles grouped by
+ *              destination and priority: each group computes the routes of phase one
+ *              once, then each bundle only runs phase two and three.
+ *          2.  The contact plan is checked, the expired contacts are removed
+ *              and the call is logged once per batch.
+ *****************************************************************************/
+int callUniboCGRBatch(time_t time, dtn::Bundle **bundles, unsigned int count, std::string *res,
+		long unsigned int *fragmentLength)
+{
+	int result = -5, temp;
+	unsigned int i;
+
+	start_call_log(time - reference_time);
+
+	debug_printf("Entry point interface (batch of %u bundles).", count);
+
+	if (initialized && bundles != NULL && res != NULL && fragmentLength != NULL)
+	{
+		// INPUT CONVERSION: check if the contact plan has been changed, in affermative case update it
+		result = update_contact_plan("", false);
+		if (result != -2)
+		{
+			result = startBestRoutesBatch(time - reference_time);
+		}
+		if (result == 0)
+		{
+			for (i = 0; i < count && result != -2; i++)
 			{
-				result = -7;
+				temp = route_one_bundle(time, bundles[i], &(res[i]), &(fragmentLength[i]), true);
+				if (temp == 0)
+				{
+					result++;
+				}
+				else if (temp == -2)
+				{
+					result = -2;
+				}
 			}
-			reset_bundle(cgrBundle);
 		}
 	}
 
 	debug_printf("result -> %d\n", result);
 
 #if (LOG == 1)
-	if (result < -1)
+	if (result < 0)
 	{
 		writeLog("Fatal error (interface): %d.", result);
 	}
@@ -1086,6 +1553,283 @@ int computeApplicableBacklog(unsigned long long neighbor, int priority, unsigned
 	return result;*/
 }
 
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      get_local_contacts
+ *
+ * \brief  Get the contacts from the own node to its neighbors that are
+ *         running or that start within the horizon.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval  ">= 0"  The number of contacts copied in contacts
+ * \retval   -5     Arguments error or CGR not initialized
+ *
+ * \param[in]     time       The current unix time
+ * \param[in]     horizon    The seconds after time in which a contact has to start
+ * \param[in]     max        The number of elements of contacts
+ * \param[out]    *contacts  The contacts found, in order of neighbor and start time
+ *
+ * \par Notes:
+ *          1.  Used by the router to open the links just before the contacts start.
+ *****************************************************************************/
+int get_local_contacts(time_t time, time_t horizon, unsigned int max, LocalContact *contacts)
+{
+	int result = -5;
+	unsigned int count = 0;
+	time_t cgrTime;
+	RbtNode *node = NULL;
+	Contact *contact;
+
+	if (initialized && contacts != NULL && horizon >= 0)
+	{
+		cgrTime = time - reference_time;
+
+		for (contact = get_first_contact_from_node(localNode, &node);
+				contact != NULL && contact->fromNode == localNode && count < max;
+				contact = get_next_contact(&node))
+		{
+			if (contact->toNode != localNode && contact->toTime > cgrTime
+					&& contact->fromTime <= cgrTime + horizon)
+			{
+				contacts[count].neighbor = contact->toNode;
+				contacts[count].fromTime = contact->fromTime + reference_time;
+				contacts[count].toTime = contact->toTime + reference_time;
+				count++;
+			}
+		}
+
+		result = (int) count;
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      get_running_contact
+ *
+ * \brief  Get the contact from the own node to a neighbor that is running.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval    0     Success case: contact found
+ * \retval   -1     There isn't a running contact to the neighbor
+ * \retval   -5     Arguments error or CGR not initialized
+ *
+ * \param[in]     time        The current unix time
+ * \param[in]     neighbor    The neighbor (ipn node number)
+ * \param[out]    *contact    The contact found
+ * \param[out]    *xmitRate   The transmit rate of the contact, in bytes per second
+ *
+ * \par Notes:
+ *          1.  Used by the router to know how many bytes can still be sent
+ *              to the neighbor before the contact ends.
+ *****************************************************************************/
+int get_running_contact(time_t time, unsigned long long neighbor, LocalContact *contact,
+		long unsigned int *xmitRate)
+{
+	int result = -5;
+	time_t cgrTime;
+	RbtNode *node = NULL;
+	Contact *current;
+
+	if (initialized && neighbor != 0 && neighbor != localNode && contact != NULL && xmitRate != NULL)
+	{
+		result = -1;
+		cgrTime = time - reference_time;
+
+		for (current = get_first_contact_from_node_to_node(localNode, neighbor, &node);
+				current != NULL && current->fromNode == localNode && current->toNode == neighbor
+				&& current->fromTime <= cgrTime && result == -1;
+				current = get_next_contact(&node))
+		{
+			if (current->toTime > cgrTime)
+			{
+				contact->neighbor = neighbor;
+				contact->fromTime = current->fromTime + reference_time;
+				contact->toTime = current->toTime + reference_time;
+				*xmitRate = current->xmitRate;
+				result = 0;
+			}
+		}
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      revise_neighbor_xmit_rate
+ *
+ * \brief  Revise the transmit rate of the contacts from the own node to a neighbor
+ *         that are running or that start within the horizon.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval  ">= 0"  The number of contacts revised
+ * \retval   -5     Arguments error or CGR not initialized
+ *
+ * \param[in]     time       The current unix time
+ * \param[in]     neighbor   The neighbor (ipn node number)
+ * \param[in]     horizon    The seconds after time in which a contact has to start
+ * \param[in]     xmitRate   The transmit rate measured toward the neighbor, in bytes per second
+ *
+ * \par Notes:
+ *          1.  The MTVs are scaled by the same factor of the transmit rate,
+ *              so the volume already booked keeps its share of the contact.
+ *              The volumes of the ledger are scaled too, otherwise a credit
+ *              would give back the volume booked at the old rate.
+ *          2.  The routes don't have to be discarded: phase two computes
+ *              the ETO with the contacts' current transmit rate.
+ *****************************************************************************/
+int revise_neighbor_xmit_rate(time_t time, unsigned long long neighbor, time_t horizon,
+		long unsigned int xmitRate)
+{
+	int result = -5, i;
+	time_t cgrTime;
+	RbtNode *node = NULL;
+	Contact *contact;
+	double mtv[3], factor;
+	std::map<time_t, double> factors;
+
+#if (REVISABLE_XMIT_RATE)
+	if (initialized && neighbor != 0 && neighbor != localNode && horizon >= 0 && xmitRate > 0)
+	{
+		result = 0;
+		cgrTime = time - reference_time;
+
+		for (contact = get_first_contact_from_node_to_node(localNode, neighbor, &node);
+				contact != NULL && contact->fromNode == localNode && contact->toNode == neighbor
+				&& contact->fromTime <= cgrTime + horizon;
+				contact = get_next_contact(&node))
+		{
+			if (contact->toTime > cgrTime && contact->xmitRate != xmitRate)
+			{
+				factor = (contact->xmitRate > 0) ?
+						((double) xmitRate) / ((double) contact->xmitRate) : 1.0;
+
+				for (i = 0; i < 3; i++)
+				{
+					mtv[i] = contact->mtv[i] * factor;
+				}
+
+				if (revise_xmit_rate(contact->fromNode, contact->toNode, contact->fromTime,
+						xmitRate, 1, mtv) == 0)
+				{
+					factors[contact->fromTime] = factor;
+					result++;
+				}
+			}
+		}
+
+		rescale_reservations(localNode, neighbor, factors);
+
+		debug_printf("Revised xmitRate of %d contacts to %llu: %lu bytes/s.", result,
+				neighbor, xmitRate);
+	}
+#endif
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      add_predicted_contacts
+ *
+ * \brief  Add to the contact plan the contacts from the own node to a neighbor
+ *         predicted from the history of the link, with a confidence below 1.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return int
+ *
+ * \retval  ">= 0"  The number of contacts added
+ * \retval   -5     Arguments error or CGR not initialized
+ *
+ * \param[in]     time        The current unix time
+ * \param[in]     neighbor    The neighbor (ipn node number)
+ * \param[in]     count       The number of contacts
+ * \param[in]     *contacts   The predicted contacts, times in unix time
+ * \param[in]     xmitRate    The transmit rate toward the neighbor, in bytes per second
+ * \param[in]     confidence  The confidence of the prediction, in (0, 1)
+ *
+ * \par Notes:
+ *          1.  Contacts already over or that overlap with a contact of the plan
+ *              (e.g. a scheduled one, or one predicted before) are not added.
+ *          2.  If there is no range to the neighbor at the start of the contact
+ *              a range of PREDICTED_CONTACT_OWLT is added with it, since
+ *              phase one doesn't use the contacts without a range.
+ *          3.  If any contact is added the contact plan's edit time is updated,
+ *              so that the next call discards the routes computed before.
+ *****************************************************************************/
+int add_predicted_contacts(time_t time, unsigned long long neighbor, unsigned int count,
+		LocalContact *contacts, long unsigned int xmitRate, float confidence)
+{
+	int result = -5;
+	unsigned int i, owlt;
+	time_t fromTime, toTime;
+
+	if (initialized && contacts != NULL && neighbor != 0 && neighbor != localNode
+			&& xmitRate > 0 && confidence > 0.0F && confidence < 1.0F)
+	{
+		result = 0;
+
+		for (i = 0; i < count; i++)
+		{
+			if (contacts[i].toTime <= time || contacts[i].fromTime >= contacts[i].toTime)
+			{
+				continue;
+			}
+
+			fromTime = contacts[i].fromTime - reference_time;
+			toTime = contacts[i].toTime - reference_time;
+
+			// an existing contact with the same start would have its xmitRate revised
+			if (get_contact(localNode, neighbor, fromTime, NULL) == NULL
+					&& addContact(localNode, neighbor, fromTime, toTime, xmitRate,
+							confidence, 0, NULL) == 1)
+			{
+				result++;
+
+				if (get_applicable_range(localNode, neighbor, fromTime, &owlt) < 0)
+				{
+					addRange(localNode, neighbor, fromTime, toTime, PREDICTED_CONTACT_OWLT);
+				}
+			}
+		}
+
+		if (result > 0)
+		{
+			// the routes computed before don't know the new contacts
+			gettimeofday(&contactPlanEditTime, NULL);
+		}
+
+		debug_printf("Added %d predicted contacts to %llu, confidence %.2f.", result,
+				neighbor, confidence);
+	}
+
+	return result;
+}
+
 /******************************************************************************
  *
  * \par Function Name:
@@ -1115,6 +1859,7 @@ void destroy_contact_graph_routing(time_t time)
 	bundle_destroy(cgrBundle);
 	cgrBundle = NULL;
 	destroy_cgr(time - reference_time);
+	reservations.clear();
 	initialized = 0;
 	//IonBundle = NULL;
 
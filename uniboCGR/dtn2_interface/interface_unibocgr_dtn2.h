@@ -44,13 +44,44 @@
 #include "../msr/msr.h"
 #include <sys/time.h>
 
+/**
+ * \brief A contact from the own node to a neighbor, times in unix time.
+ */
+typedef struct
+{
+	/**
+	 * \brief Receiver node (ipn node number)
+	 */
+	unsigned long long neighbor;
+	/**
+	 * \brief Start transmit time
+	 */
+	time_t fromTime;
+	/**
+	 * \brief Stop transmit time
+	 */
+	time_t toTime;
+} LocalContact;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 extern int callUniboCGR(time_t time, dtn::Bundle *bundle,
-		 std::string *res);
+		 std::string *res, long unsigned int *fragmentLength);
+extern int callUniboCGRBatch(time_t time, dtn::Bundle **bundles,
+		 unsigned int count, std::string *res, long unsigned int *fragmentLength);
+extern int credit_bundle_reservation(u_int64_t id);
+extern int confirm_bundle_reservation(u_int64_t id);
+extern int get_local_contacts(time_t time, time_t horizon,
+		unsigned int max, LocalContact *contacts);
+extern int get_running_contact(time_t time, unsigned long long neighbor,
+		LocalContact *contact, long unsigned int *xmitRate);
+extern int revise_neighbor_xmit_rate(time_t time, unsigned long long neighbor,
+		time_t horizon, long unsigned int xmitRate);
+extern int add_predicted_contacts(time_t time, unsigned long long neighbor, unsigned int count,
+		LocalContact *contacts, long unsigned int xmitRate, float confidence);
 extern void destroy_contact_graph_routing(time_t time);
 extern int initialize_contact_graph_routing(unsigned long long ownNode, time_t time);
 
@@ -967,17 +967,17 @@ static int convert_scalar_from_cgr_to_ion(CgrScalar *cgr_scalar, Scalar *ion_sca
  *
  * \param[in]   ionwm      The partition of the ION's contacts graph
  * \param[in]   *ionvdb    The ion's volatile database
- * \param[in]   CgrHops    The list of contacts of this CGR's implementation
+ * \param[in]   *route     The route of this CGR's implementation with the hops to convert
  * \param[out]  IonHops    The list of contact in ION's format.
  *
  * \warning ionvdb doesn't have to be NULL
- * \warning CgrHops doesn't have to be NULL
+ * \warning route doesn't have to be NULL
  * \warning IonHops doesn't have to be 0
  *
  * \par	Notes:
  *                1.    All the contacts will be searched in the ION's contacts graph, and
  *                      then the contact found will be added in the list.
- *                2.    The ION's list mantains the same order of the CGR's list.
+ *                2.    The ION's list mantains the same order of the CGR's hops.
  *                3.    To the ION's contact this function adds the citations to the
  *                      hop of the list where is the contact.
  *
@@ -987,17 +987,17 @@ static int convert_scalar_from_cgr_to_ion(CgrScalar *cgr_scalar, Scalar *ion_sca
  *  -------- | --------------- | -----------------------------------------------
  *  19/02/20 | L. Persampieri  |  Initial Implementation and documentation.
  *****************************************************************************/
-static int convert_hops_list_from_cgr_to_ion(PsmPartition ionwm, IonVdb *ionvdb, List CgrHops,
+static int convert_hops_list_from_cgr_to_ion(PsmPartition ionwm, IonVdb *ionvdb, Route *route,
 		PsmAddress IonHops)
 {
-	ListElt *elt;
+	unsigned int hop;
 	IonCXref IonContact, *IonTreeContact;
 	PsmAddress tree_node, citation, contactAddr;
 	int result = 0;
 
-	for (elt = CgrHops->first; elt != NULL && result >= 0; elt = elt->next)
+	for (hop = 0; hop < route->hopsCount && result >= 0; hop++)
 	{
-		if (convert_contact_from_cgr_to_ion((Contact*) elt->data, &IonContact) == 0)
+		if (convert_contact_from_cgr_to_ion(ROUTE_HOP(route, hop), &IonContact) == 0)
 		{
 			tree_node = sm_rbt_search(ionwm, ionvdb->contactIndex, rfx_order_contacts, &IonContact,
 					0);
@@ -1094,7 +1094,7 @@ static int search_route_in_ion_selected_routes(PsmPartition ionwm, Route *route,
 {
 	int result = -1, found, stop;
 	PsmAddress selElt, hopEltSelected, addr;
-	ListElt *hopEltCgr;
+	unsigned int hop;
 	CgrRoute *selectedRoute;
 	IonCXref *contactSelected;
 	Contact *contactCgr;
@@ -1110,14 +1110,13 @@ static int search_route_in_ion_selected_routes(PsmPartition ionwm, Route *route,
 			{
 				if (route->neighbor == selectedRoute->toNodeNbr)
 				{
-					if (route->hops->length == sm_list_length(ionwm, selectedRoute->hops))
+					if (route->hopsCount == sm_list_length(ionwm, selectedRoute->hops))
 					{
 						hopEltSelected = sm_list_first(ionwm, selectedRoute->hops);
 						stop = 0;
-						for (hopEltCgr = route->hops->first; hopEltCgr != NULL && !stop; hopEltCgr =
-								hopEltCgr->next)
+						for (hop = 0; hop < route->hopsCount && !stop; hop++)
 						{
-							contactCgr = (Contact*) hopEltCgr->data;
+							contactCgr = ROUTE_HOP(route, hop);
 							addr = sm_list_data(ionwm, hopEltSelected);
 							if (addr != 0)
 							{
@@ -1264,7 +1263,7 @@ static int convert_routes_from_cgr_to_ion(PsmPartition ionwm, IonVdb *ionvdb, Io
 								&(IonRoute->committed));
 						convert_scalar_from_cgr_to_ion(&(current->overbooked),
 								&(IonRoute->overbooked));
-						if (convert_hops_list_from_cgr_to_ion(ionwm, ionvdb, current->hops, hops)
+						if (convert_hops_list_from_cgr_to_ion(ionwm, ionvdb, current, hops)
 								>= 0)
 						{
 							IonRoute->hops = hops;
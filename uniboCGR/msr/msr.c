@@ -212,7 +212,7 @@ int tryMSR(CgrBundle *bundle, List excludedNeighbors, FILE* file_call, List *bes
  *****************************************************************************/
 static void print_msr_proposed_route(FILE *file, Route *route, unsigned int num)
 {
-	ListElt *elt;
+	unsigned int hop;
 	Contact *contact;
 
 	/* If you have to work with very large numbers change all fields in %-20 */
@@ -234,21 +234,18 @@ static void print_msr_proposed_route(FILE *file, Route *route, unsigned int num)
 		}
 		else if (route->hops != NULL)
 		{
-			fprintf(file, "%lu\n%-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %s\n",
-					route->hops->length, "FromNode", "ToNode", "FromTime", "ToTime", "XmitRate",
+			fprintf(file, "%u\n%-15s %-15s %-15s %-15s %-15s %-15s %-15s %-15s %s\n",
+					route->hopsCount, "FromNode", "ToNode", "FromTime", "ToTime", "XmitRate",
 					"Confidence", "MTV[Bulk]", "MTV[Normal]", "MTV[Expedited]");
-			for (elt = route->hops->first; elt != NULL; elt = elt->next)
+			for (hop = 0; hop < route->hopsCount; hop++)
 			{
-				if (elt->data != NULL)
-				{
-					contact = (Contact*) elt->data;
-					fprintf(file,
-							"%-15llu %-15llu %-15ld %-15ld %-15lu %-10.2f%-5s %-15g %-15g %g\n",
-							contact->fromNode, contact->toNode, (long int) contact->fromTime,
-							(long int) contact->toTime, contact->xmitRate, contact->confidence,
-							(elt == route->rootOfSpur) ? " x" : "", contact->mtv[0],
-							contact->mtv[1], contact->mtv[2]);
-				}
+				contact = ROUTE_HOP(route, hop);
+				fprintf(file,
+						"%-15llu %-15llu %-15ld %-15ld %-15lu %-10.2f%-5s %-15g %-15g %g\n",
+						contact->fromNode, contact->toNode, (long int) contact->fromTime,
+						(long int) contact->toTime, contact->xmitRate, contact->confidence,
+						((int) hop == route->rootOfSpur) ? " x" : "", contact->mtv[0],
+						contact->mtv[1], contact->mtv[2]);
 			}
 		}
 
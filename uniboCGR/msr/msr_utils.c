@@ -54,9 +54,8 @@ int populate_msr_route(Contact *finalContact, Route *resultRoute)
 {
 	int result = -1;
 	time_t earliestEndTime;
-	Contact *contact, *firstContact = NULL;
-	ContactNote *current_work;
-	ListElt *elt;
+	Contact *contact;
+	unsigned int hop;
 
 	if(finalContact != NULL && resultRoute != NULL)
 	{
@@ -65,35 +64,33 @@ int populate_msr_route(Contact *finalContact, Route *resultRoute)
 		resultRoute->arrivalConfidence = finalContact->routingObject->arrivalConfidence;
 		resultRoute->computedAtTime = current_time;
 
-		earliestEndTime = MAX_POSIX_TIME;
-		contact = finalContact;
-
-		while (contact != NULL)
+		hop = 0;
+		for (contact = finalContact; contact != NULL; contact = contact->routingObject->predecessor)
 		{
-			current_work = contact->routingObject;
-			if (contact->toTime < earliestEndTime)
-			{
-				earliestEndTime = contact->toTime;
-			}
+			hop++;
+		}
 
-			elt = list_insert_first(resultRoute->hops, contact);
+		if (allocate_route_hops(resultRoute, hop) < 0)
+		{
+			result = -2;
+		}
+		else
+		{
+			earliestEndTime = MAX_POSIX_TIME;
 
-			if (elt == NULL)
+			for (contact = finalContact; contact != NULL; contact = contact->routingObject->predecessor)
 			{
-				result = -2;
-				contact = NULL; //I leave the loop
-			}
-			else
-			{
-				firstContact = contact;
-				contact = current_work->predecessor;
+				hop--;
+				if (contact->toTime < earliestEndTime)
+				{
+					earliestEndTime = contact->toTime;
+				}
+
+				resultRoute->hops[hop].contact = contact;
 			}
-		}
 
-		if (result == 0)
-		{
-			resultRoute->neighbor = firstContact->toNode;
-			resultRoute->fromTime = firstContact->fromTime;
+			resultRoute->neighbor = ROUTE_HOP(resultRoute, 0)->toNode;
+			resultRoute->fromTime = ROUTE_HOP(resultRoute, 0)->fromTime;
 			resultRoute->toTime = earliestEndTime;
 		}
 	}
@@ -400,12 +397,7 @@ void delete_msr_route(Route *route)
 {
 	if(route != NULL)
 	{
-		if(route->hops != NULL)
-		{
-			route->hops->delete_data_elt = NULL;
-			route->hops->delete_userData = NULL;
-			free_list(route->hops);
-		}
+		release_route_hops(route); //MSR routes aren't cited by the contacts
 		if(route->children != NULL)
 		{
 			route->children->delete_data_elt = NULL;
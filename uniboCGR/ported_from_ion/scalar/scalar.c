@@ -47,13 +47,8 @@ void loadCgrScalar(CgrScalar *s, long int i)
 			i = 0 - i;
 		}
 
-		s->gigs = 0;
-		s->units = i;
-		while (s->units >= ONE_GIG)
-		{
-			s->gigs++;
-			s->units -= ONE_GIG;
-		}
+		s->gigs = i / ONE_GIG;
+		s->units = i % ONE_GIG;
 	}
 }
 
@@ -89,17 +84,12 @@ void increaseCgrScalar(CgrScalar *s, long int i)
 			i = 0 - i;
 		}
 
-		while (i >= ONE_GIG)
-		{
-			i -= ONE_GIG;
-			s->gigs++;
-		}
-
-		s->units += i;
-		while (s->units >= ONE_GIG)
+		s->gigs += i / ONE_GIG;
+		s->units += i % ONE_GIG;
+		if (s->units >= ONE_GIG)
 		{
-			s->gigs++;
-			s->units -= ONE_GIG;
+			s->gigs += s->units / ONE_GIG;
+			s->units = s->units % ONE_GIG;
 		}
 	}
 }
@@ -129,6 +119,8 @@ void increaseCgrScalar(CgrScalar *s, long int i)
  *******************************************************************************/
 void reduceCgrScalar(CgrScalar *s, long int i)
 {
+	long int borrow;
+
 	if (s != NULL)
 	{
 		if (i < 0)
@@ -136,16 +128,15 @@ void reduceCgrScalar(CgrScalar *s, long int i)
 			i = 0 - i;
 		}
 
-		while (i >= ONE_GIG)
-		{
-			i -= ONE_GIG;
-			s->gigs--;
-		}
+		s->gigs -= i / ONE_GIG;
+		i = i % ONE_GIG;
 
-		while (i > s->units)
+		if (i > s->units)
 		{
-			s->units += ONE_GIG;
-			s->gigs--;
+			// the number of gigs to borrow to get units >= i
+			borrow = (i - s->units + ONE_GIG - 1) / ONE_GIG;
+			s->units += borrow * ONE_GIG;
+			s->gigs -= borrow;
 		}
 
 		s->units -= i;
@@ -177,7 +168,7 @@ void reduceCgrScalar(CgrScalar *s, long int i)
  *******************************************************************************/
 void multiplyCgrScalar(CgrScalar *s, long int i)
 {
-	double product;
+	long int product;
 
 	if (s != NULL)
 	{
@@ -186,9 +177,9 @@ void multiplyCgrScalar(CgrScalar *s, long int i)
 			i = 0 - i;
 		}
 
-		product = (double) (((s->gigs * ONE_GIG) + (s->units)) * i);
-		s->gigs = (long int) (product / ONE_GIG);
-		s->units = (long int) (product - ((double) (s->gigs * ONE_GIG)));
+		product = ((s->gigs * ONE_GIG) + (s->units)) * i;
+		s->gigs = product / ONE_GIG;
+		s->units = product % ONE_GIG;
 	}
 }
 
@@ -217,7 +208,7 @@ void multiplyCgrScalar(CgrScalar *s, long int i)
  *******************************************************************************/
 void divideCgrScalar(CgrScalar *s, long int i)
 {
-	double quotient;
+	long int quotient;
 
 	if (s != NULL && i != 0)
 	{
@@ -226,9 +217,9 @@ void divideCgrScalar(CgrScalar *s, long int i)
 			i = 0 - i;
 		}
 
-		quotient = (double) (((s->gigs * ONE_GIG) + s->units) / i);
-		s->gigs = (int) (quotient / ONE_GIG);
-		s->units = (int) (quotient - (((double) (s->gigs)) * ONE_GIG));
+		quotient = ((s->gigs * ONE_GIG) + s->units) / i;
+		s->gigs = quotient / ONE_GIG;
+		s->units = quotient % ONE_GIG;
 	}
 }
 
@@ -364,3 +355,37 @@ int CgrScalarIsValid(CgrScalar *s)
 
 	return result;
 }
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ *      CgrScalarToLong
+ *
+ * \brief Get the quantity contained in a CgrScalar as a native integer.
+ *
+ *
+ * \par Date Written:
+ *      18/10/26
+ *
+ * \return long int
+ *
+ * \retval "long int"  The quantity gigs * ONE_GIG + units
+ * \retval 0           s is NULL
+ *
+ * \param[in]  *s   The CgrScalar for which we want the quantity
+ *
+ * \par Notes:
+ *          1.  Use this function to do the arithmetic directly on 64-bit integers,
+ *              the gigs/units fields are kept for the compatibility with ION's Scalar.
+ *******************************************************************************/
+long int CgrScalarToLong(CgrScalar *s)
+{
+	long int result = 0;
+
+	if (s != NULL)
+	{
+		result = (s->gigs * ONE_GIG) + s->units;
+	}
+
+	return result;
+}
@@ -36,6 +36,7 @@ extern void copyCgrScalar(CgrScalar *to, CgrScalar *from);
 extern void addToCgrScalar(CgrScalar*, CgrScalar*);
 extern void subtractFromCgrScalar(CgrScalar*, CgrScalar*);
 extern int CgrScalarIsValid(CgrScalar*);
+extern long int CgrScalarToLong(CgrScalar*);
 
 #ifdef __cplusplus
 }
@@ -46,64 +46,6 @@ static void erase_cgr_route(Route *route)
 	memset(route, 0, sizeof(Route));
 }
 
-/******************************************************************************
- *
- * \par Function Name:
- * 		remove_citation
- *
- * \brief Remove the citation "target" from the citations list of the contact
- *
- *
- * \par Date Written:
- * 		21/01/20
- *
- * \return void
- *
- * \param[in]	*contact		The Contact for which we want to delete the citation "target"
- * \param[in]	*target			The citation to remove from the contact
- *
- * \warning We have to remove only the citation from the contact: no chain events
- *
- * \par Revision History:
- *
- *  DD/MM/YY |  AUTHOR         |   DESCRIPTION
- *  -------- | --------------- | -----------------------------------------------
- *  21/01/20 | L. Persampieri  |  Initial Implementation and documentation.
- *****************************************************************************/
-static void remove_citation(Contact *contact, ListElt *target)
-{
-	ListElt *current;
-	int deleted = 0;
-
-	if (contact != NULL && target != NULL)
-	{
-		if (contact->citations != NULL)
-		{
-			current = contact->citations->first;
-			while (current != NULL)
-			{
-				if (current->data == target) //if they point to the same address
-				{
-					list_remove_elt(current);
-					current = NULL; //I leave the loop
-					deleted = 1;
-				}
-				else
-				{
-					current = current->next;
-				}
-			}
-		}
-	}
-
-	if (deleted == 0)
-	{
-		flush_verbose_debug_printf("Error!!!");
-	}
-
-	return;
-}
-
 /******************************************************************************
  *
  * \par Function Name:
@@ -231,8 +173,6 @@ static void update_references(Route *route)
  *****************************************************************************/
 void delete_cgr_route(void *data)
 {
-	ListElt *elt, *nextElt;
-	Contact *contact;
 	Route *route;
 	delete_function temp;
 	List list;
@@ -240,20 +180,7 @@ void delete_cgr_route(void *data)
 	{
 		route = (Route*) data;
 
-		if (route->hops != NULL)
-		{
-			elt = route->hops->first;
-			while (elt != NULL)
-			{
-				nextElt = elt->next;
-				contact = elt->data;
-				remove_citation(contact, elt); //delete citation from the contact
-				MDEPOSIT(elt);
-				elt = nextElt;
-			}
-
-			MDEPOSIT(route->hops);
-		}
+		release_route_hops(route); //delete the citations from the contacts
 
 		update_references(route); //manage the references with other routes
 
@@ -385,7 +312,7 @@ void destroy_routes_list(List routes)
  *
  * \par Notes:
  * 			1. You must check that the return value of this function is not NULL.
- * 			2. The hops list will be allocated
+ * 			2. The hops array is empty, see allocate_route_hops()
  * 			3. The children list will be allocated
  *
  * \par Revision History:
@@ -401,13 +328,11 @@ Route* create_cgr_route()
 	if (result != NULL)
 	{
 		erase_cgr_route(result);
-		result->hops = list_create(result, NULL, NULL, NULL);
+		result->rootOfSpur = NO_ROOT_OF_SPUR;
 		result->children = list_create(result, NULL, NULL, remove_reference_from_son);
 
-		if (result->hops == NULL || result->children == NULL)
+		if (result->children == NULL)
 		{
-			MDEPOSIT(result->hops);
-			MDEPOSIT(result->children);
 			MDEPOSIT(result);
 			result = NULL;
 		}
@@ -583,3 +508,138 @@ Route * get_route_father(Route *son)
 
 	return father;
 }
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		allocate_route_hops
+ *
+ * \brief Make room for the hops of the route.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval   0   Success case
+ * \retval  -1   Arguments error
+ * \retval  -2   MWITHDRAW error
+ *
+ * \param[in,out]   *route      The route without hops
+ * \param[in]       hopsCount   The number of hops of the route
+ *
+ * \par Notes:
+ *          1.  The hops are stored inside the route if they are at most ROUTE_INLINE_HOPS.
+ *          2.  The caller has to set the contact of every hop, the citations
+ *              are added by cite_route_hops().
+ *****************************************************************************/
+int allocate_route_hops(Route *route, unsigned int hopsCount)
+{
+	int result = -1;
+
+	if (route != NULL && route->hops == NULL && hopsCount > 0)
+	{
+		result = 0;
+		if (hopsCount <= ROUTE_INLINE_HOPS)
+		{
+			route->hops = route->inlineHops;
+		}
+		else
+		{
+			route->hops = (RouteHop*) MWITHDRAW(sizeof(RouteHop) * hopsCount);
+		}
+
+		if (route->hops == NULL)
+		{
+			result = -2;
+		}
+		else
+		{
+			memset(route->hops, 0, sizeof(RouteHop) * hopsCount);
+			route->hopsCount = hopsCount;
+		}
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		cite_route_hops
+ *
+ * \brief Add the route to the citations list of every contact of its hops.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return int
+ *
+ * \retval   0   Success case
+ * \retval  -2   MWITHDRAW error
+ *
+ * \param[in,out]   *route   The route with all the hops setted
+ *
+ * \par Notes:
+ *          1.  Each hop keeps its element of the citations list, so that
+ *              release_route_hops() removes it without any search.
+ *****************************************************************************/
+int cite_route_hops(Route *route)
+{
+	int result = 0;
+	unsigned int i;
+	RouteHop *hop;
+
+	for (i = 0; i < route->hopsCount && result == 0; i++)
+	{
+		hop = &(route->hops[i]);
+		hop->citation = list_insert_last(hop->contact->citations, route);
+		if (hop->citation == NULL)
+		{
+			result = -2;
+		}
+	}
+
+	return result;
+}
+
+/******************************************************************************
+ *
+ * \par Function Name:
+ * 		release_route_hops
+ *
+ * \brief Remove the citations of the route from its contacts and
+ *        free the hops array.
+ *
+ *
+ * \par Date Written:
+ * 		18/10/26
+ *
+ * \return void
+ *
+ * \param[in,out]   *route   The route
+ *****************************************************************************/
+void release_route_hops(Route *route)
+{
+	unsigned int i;
+
+	for (i = 0; i < route->hopsCount; i++)
+	{
+		if (route->hops[i].citation != NULL)
+		{
+			list_remove_elt(route->hops[i].citation);
+		}
+	}
+
+	if (route->hops != NULL && route->hops != route->inlineHops)
+	{
+		MDEPOSIT(route->hops);
+	}
+
+	route->hops = NULL;
+	route->hopsCount = 0;
+
+	return;
+}
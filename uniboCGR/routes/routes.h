@@ -18,17 +18,58 @@
 
 #include "../library/list/list_type.h"
 #include "../contact_plan/nodes/nodes.h"
+#include "../contact_plan/contacts/contacts.h"
 #include "../library/commonDefines.h"
 #include "../ported_from_ion/scalar/scalar.h"
 #include <sys/time.h>
 
+#ifndef ROUTE_INLINE_HOPS
+/**
+ * \brief Number of hops stored inside the Route itself.
+ *
+ * \details Only the routes with more hops allocate their hops array.
+ *
+ * \hideinitializer
+ */
+#define ROUTE_INLINE_HOPS 8
+#endif
+
+/**
+ * \brief The rootOfSpur of a route computed from the graph root.
+ *
+ * \hideinitializer
+ */
+#define NO_ROOT_OF_SPUR -1
+
+/**
+ * \brief The contact of the i-th hop of the route.
+ *
+ * \hideinitializer
+ */
+#define ROUTE_HOP(route, i) ((route)->hops[(i)].contact)
+
+typedef struct
+{
+	/**
+	 * \brief The contact of this hop
+	 */
+	Contact *contact;
+	/**
+	 * \brief The element of the contact's citations list that points to the route,
+	 *        NULL if the contact doesn't cite the route for this hop.
+	 */
+	ListElt *citation;
+} RouteHop;
+
 typedef struct cgrRoute
 {
 	/**************** Yen's k-th shortest path algorithm ****************/
 	/**
-	 * \brief Lawler's modification to Yen's algorithm: the hop from which this route was born
+	 * \brief Lawler's modification to Yen's algorithm: the index in the hops array
+	 *        of the hop from which this route was born, NO_ROOT_OF_SPUR if
+	 *        the route has been computed from the graph root.
 	 */
-	ListElt *rootOfSpur;
+	int rootOfSpur;
 	/**
 	 * \brief boolean: 0 if the route hasn't a selectedChild, 1 otherwise
 	 */
@@ -124,8 +165,19 @@ typedef struct cgrRoute
 	time_t toTime;
 	/**
 	 * \brief Hops of the route, from the first contact to the last contact
+	 *
+	 * \details It points to inlineHops if the route has at most ROUTE_INLINE_HOPS hops,
+	 *          otherwise to an allocated array. See allocate_route_hops().
+	 */
+	RouteHop *hops;
+	/**
+	 * \brief Number of elements in the hops array
+	 */
+	unsigned int hopsCount;
+	/**
+	 * \brief Storage for the hops of the short routes
 	 */
-	List hops;
+	RouteHop inlineHops[ROUTE_INLINE_HOPS];
 
 	/************ Overbooking management ************/
 	/**
@@ -153,6 +205,9 @@ extern int move_route_from_known_to_selected(Route *route);
 extern int insert_selected_route(RtgObject *rtgObj, Route *route);
 extern int insert_known_route(RtgObject *rtgObj, Route *route);
 extern Route * get_route_father(Route *son);
+extern int allocate_route_hops(Route *route, unsigned int hopsCount);
+extern int cite_route_hops(Route *route);
+extern void release_route_hops(Route *route);
 
 #ifdef __cplusplus
 }